@@ -0,0 +1,32 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 colour;
+layout(location = 2) in vec3 normal;
+layout(location = 3) in vec2 tex_coord;
+
+layout(location = 0) out vec3 out_colour;
+layout(location = 1) out vec2 out_tex_coord;
+layout(location = 2) flat out uint out_texture_index;
+
+layout(set = 0, binding = 0) uniform Ubo {
+    mat4 projection;
+    mat4 view;
+} ubo;
+
+struct Instance {
+    mat4 model;
+    uint texture_index;
+};
+
+layout(set = 1, binding = 0) readonly buffer Instances {
+    Instance instances[];
+} instances;
+
+void main() {
+    Instance instance = instances.instances[gl_InstanceIndex];
+    gl_Position = ubo.projection * ubo.view * instance.model * vec4(position, 1.0);
+    out_colour = colour;
+    out_tex_coord = tex_coord;
+    out_texture_index = instance.texture_index;
+}
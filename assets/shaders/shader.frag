@@ -1,7 +1,9 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 colour;
 layout(location = 1) in vec2 tex_coord;
+layout(location = 2) flat in uint texture_index;
 
 layout(location = 0) out vec4 frag_colour;
 
@@ -10,14 +12,11 @@ layout(set = 0, binding = 0) uniform Ubo {
     mat4 view;
 } ubo;
 
-layout(binding = 1) uniform sampler2D image;
-
-layout(push_constant) uniform Push {
-    mat4 model;
-} push;
+/* Bindless table, indexed per draw */
+layout(set = 2, binding = 0) uniform sampler2D textures[];
 
 void main() {
     // frag_colour = texture(tex, tex_coord);
-    vec3 image_colour = texture(image, tex_coord).rgb;
+    vec3 image_colour = texture(textures[nonuniformEXT(texture_index)], tex_coord).rgb;
     frag_colour = vec4(image_colour, 1.0);
 }
@@ -7,6 +7,7 @@ layout(location = 3) in vec2 tex_coord;
 
 layout(location = 0) out vec3 out_colour;
 layout(location = 1) out vec2 out_tex_coord;
+layout(location = 2) flat out uint out_texture_index;
 
 layout(set = 0, binding = 0) uniform Ubo {
     mat4 projection;
@@ -15,10 +16,12 @@ layout(set = 0, binding = 0) uniform Ubo {
 
 layout(push_constant) uniform Push {
     mat4 model;
+    uint texture_index;
 } push;
 
 void main() {
     gl_Position = ubo.projection * ubo.view * push.model * vec4(position, 1.0);
     out_colour = colour;
     out_tex_coord = tex_coord;
+    out_texture_index = push.texture_index;
 }
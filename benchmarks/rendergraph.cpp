@@ -0,0 +1,93 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#include <vulkan/vulkan.hpp>
+
+#include "engine/rendering/rendergraph.hpp"
+#include "engine/vulkan/deletionqueue.hpp"
+#include "engine/vulkan/device.hpp"
+
+using namespace muon;
+
+namespace {
+
+    constexpr int ITERATIONS = 20;
+    constexpr vk::Extent2D EXTENT{1920, 1080};
+
+    /*
+        Each pass samples the image the one before it wrote, so only neighbouring
+        images are alive at once and the graph should fold the chain into two
+        allocations. Nothing is drawn, the clears and barriers are the whole work.
+    */
+    void buildPostChain(RenderGraph &graph, uint32_t pass_count) {
+        const RenderGraph::ImageDesc desc{EXTENT, vk::Format::eR8G8B8A8Unorm};
+
+        RenderGraphImage previous{};
+        for (uint32_t i = 0; i < pass_count; i++) {
+            const auto name = "post " + std::to_string(i);
+            const auto target = graph.createImage(name, desc);
+            const bool last = i + 1 == pass_count;
+
+            graph.addPass(name, [&](RenderGraph::PassBuilder &builder) {
+                if (previous.isValid()) {
+                    builder.readTexture(previous);
+                }
+                builder.writeColor(target);
+                if (last) {
+                    builder.setSideEffect();
+                }
+            }, [](RenderGraph::PassContext &) {});
+
+            previous = target;
+        }
+    }
+
+}
+
+/* Fails when aliasing does not fit a chain in less memory than one allocation per image */
+int main() {
+    Device device{};
+    int exit_code = 0;
+
+    std::printf("%8s %10s %14s %16s %14s\n", "passes", "barriers", "aliased (KiB)", "unaliased (KiB)", "compile (us)");
+
+    for (uint32_t pass_count : {2, 6, 16}) {
+        RenderGraph graph{device};
+
+        double total = 0.0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            /* Nothing is in flight, the previous iteration's images can go straight away */
+            graph.reset();
+            device.getDeletionQueue().flush();
+            buildPostChain(graph, pass_count);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            graph.compile();
+            auto end = std::chrono::high_resolution_clock::now();
+            total += std::chrono::duration<double, std::micro>(end - start).count();
+        }
+
+        /* Once, so the compiled barriers and render passes also run on the GPU */
+        const auto command_buffer = device.beginSingleTimeCommands();
+        graph.execute(command_buffer);
+        device.endSingleTimeCommands(command_buffer);
+
+        const auto &stats = graph.getStats();
+        std::printf(
+            "%8u %10u %14llu %16llu %14.1f\n",
+            stats.passes, stats.barriers,
+            static_cast<unsigned long long>(stats.transient_memory / 1024),
+            static_cast<unsigned long long>(stats.transient_memory_unaliased / 1024),
+            total / ITERATIONS
+        );
+
+        if (pass_count > 2 && stats.transient_memory >= stats.transient_memory_unaliased) {
+            std::printf("Aliasing saved no memory over %u passes\n", pass_count);
+            exit_code = 1;
+        }
+    }
+
+    return exit_code;
+}
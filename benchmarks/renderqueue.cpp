@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "engine/rendering/renderqueue.hpp"
+
+using namespace muon;
+
+namespace {
+
+    constexpr int ITERATIONS = 20;
+
+    /* Scene-like keys, few pipelines and materials, many meshes, random depths */
+    std::vector<uint64_t> makeKeys(size_t count, std::mt19937 &rng) {
+        std::uniform_int_distribution<uint32_t> pipeline(0, 3);
+        std::uniform_int_distribution<uint32_t> material(0, 63);
+        std::uniform_int_distribution<uint32_t> mesh(0, 1023);
+        std::uniform_real_distribution<float> depth(0.1f, 1000.0f);
+        std::uniform_int_distribution<uint32_t> transparent(0, 9);
+
+        std::vector<uint64_t> keys(count);
+        for (auto &key : keys) {
+            key = transparent(rng) == 0
+                ? RenderQueue::transparentKey(0, pipeline(rng), material(rng), mesh(rng), depth(rng))
+                : RenderQueue::opaqueKey(0, pipeline(rng), material(rng), mesh(rng), depth(rng));
+        }
+        return keys;
+    }
+
+    template <typename Func>
+    double averageMicroseconds(Func &&func) {
+        double total = 0.0;
+        for (int i = 0; i < ITERATIONS; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            func();
+            auto end = std::chrono::high_resolution_clock::now();
+            total += std::chrono::duration<double, std::micro>(end - start).count();
+        }
+        return total / ITERATIONS;
+    }
+
+}
+
+int main() {
+    std::mt19937 rng{1234};
+
+    std::printf("%10s %14s %14s %10s\n", "packets", "radix (us)", "std::sort (us)", "ns/packet");
+
+    for (size_t count : {1'000, 10'000, 100'000, 1'000'000}) {
+        auto keys = makeKeys(count, rng);
+
+        RenderQueue queue{};
+        queue.reserve(count);
+        double radix = averageMicroseconds([&]() {
+            queue.clear();
+            for (uint32_t i = 0; i < keys.size(); i++) {
+                queue.push(keys[i], i);
+            }
+            queue.sort();
+        });
+
+        std::vector<RenderQueue::Packet> packets(count);
+        double comparison = averageMicroseconds([&]() {
+            for (uint32_t i = 0; i < keys.size(); i++) {
+                packets[i] = {keys[i], i};
+            }
+            std::sort(packets.begin(), packets.end(), [](const auto &a, const auto &b) { return a.key < b.key; });
+        });
+
+        std::printf("%10zu %14.1f %14.1f %10.2f\n", count, radix, comparison, radix * 1000.0 / count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+namespace muon {
+
+    /**
+        *  Typed reference into a ResourcePool
+        *
+        *  The index picks the slot and the generation must match the slot's
+        *  current one, so a handle to a destroyed resource never resolves to
+        *  whatever reused its slot. Generation 0 is never issued.
+    */
+    template <typename T>
+    struct Handle {
+        static constexpr uint32_t INVALID_INDEX = std::numeric_limits<uint32_t>::max();
+
+        uint32_t index{INVALID_INDEX};
+        uint32_t generation{0};
+
+        bool isValid() const { return generation != 0; }
+
+        bool operator==(const Handle &other) const {
+            return index == other.index && generation == other.generation;
+        }
+
+        bool operator!=(const Handle &other) const {
+            return !(*this == other);
+        }
+    };
+
+}
+
+template <typename T>
+struct std::hash<muon::Handle<T>> {
+    size_t operator()(const muon::Handle<T> &handle) const noexcept {
+        return std::hash<uint64_t>{}(static_cast<uint64_t>(handle.generation) << 32 | handle.index);
+    }
+};
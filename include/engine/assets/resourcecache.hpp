@@ -2,18 +2,46 @@
 
 #include <unordered_map>
 #include <string>
-#include <memory>
 
+#include "engine/assets/handle.hpp"
+#include "engine/assets/resourcepool.hpp"
+#include "engine/vulkan/device.hpp"
 #include "engine/vulkan/model.hpp"
 #include "engine/vulkan/texture.hpp"
 
 namespace muon {
     class ResourceCache {
     public:
+        ResourceCache(Device &device);
+        ~ResourceCache();
+
+        ResourceCache(const ResourceCache &) = delete;
+        ResourceCache& operator=(const ResourceCache &) = delete;
+
+        /* Files are loaded once, later calls return the same handle */
+        Handle<Model> loadModel(const std::string &path);
+        Handle<Texture> loadTexture(const std::string &path);
+
+        /* Generated geometry, owned by the caller until released */
+        Handle<Model> createModel(const Model::Builder &builder);
+
+        void releaseModel(Handle<Model> handle);
+        void releaseTexture(Handle<Texture> handle);
+
+        Model *getModel(Handle<Model> handle) { return models.get(handle); }
+        Texture *getTexture(Handle<Texture> handle) { return textures.get(handle); }
+
+        ResourcePool<Model> &getModels() { return models; }
+        ResourcePool<Texture> &getTextures() { return textures; }
 
     private:
-        std::unordered_map<std::string, std::shared_ptr<Texture>> textures;
-        std::unordered_map<std::string, std::shared_ptr<Model>> models;
+        Device &device;
+
+        ResourcePool<Texture> textures;
+        ResourcePool<Model> models;
+
+        std::unordered_map<std::string, Handle<Texture>> texture_paths;
+        std::unordered_map<std::string, Handle<Model>> model_paths;
 
     };
 }
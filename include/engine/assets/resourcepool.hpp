@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "engine/assets/handle.hpp"
+
+namespace muon {
+
+    /**
+        *  Slot pool addressed by generational handles
+        *
+        *  Resources are constructed in place inside chunked storage and never
+        *  move, so anything that registered their address stays valid. Lookup
+        *  is one index and one generation compare, and iteration walks the
+        *  slots in order.
+    */
+    template <typename T>
+    class ResourcePool {
+    public:
+        ResourcePool() = default;
+
+        ResourcePool(const ResourcePool &) = delete;
+        ResourcePool& operator=(const ResourcePool &) = delete;
+
+        template <typename... Args>
+        Handle<T> create(Args &&...args) {
+            uint32_t index;
+            if (!free_indices.empty()) {
+                index = free_indices.back();
+                free_indices.pop_back();
+            } else {
+                index = static_cast<uint32_t>(slots.size());
+                slots.emplace_back();
+            }
+
+            Slot &slot = slots[index];
+            slot.value.emplace(std::forward<Args>(args)...);
+            live_count++;
+
+            return {index, slot.generation};
+        }
+
+        void destroy(Handle<T> handle) {
+            if (!contains(handle)) {
+                return;
+            }
+
+            Slot &slot = slots[handle.index];
+            slot.value.reset();
+            /* Skip 0 on wrap around so default handles stay invalid */
+            if (++slot.generation == 0) {
+                slot.generation = 1;
+            }
+            free_indices.push_back(handle.index);
+            live_count--;
+        }
+
+        bool contains(Handle<T> handle) const {
+            return handle.index < slots.size()
+                && slots[handle.index].generation == handle.generation
+                && slots[handle.index].value.has_value();
+        }
+
+        T *get(Handle<T> handle) {
+            return contains(handle) ? &*slots[handle.index].value : nullptr;
+        }
+
+        const T *get(Handle<T> handle) const {
+            return contains(handle) ? &*slots[handle.index].value : nullptr;
+        }
+
+        template <typename Func>
+        void forEach(Func &&func) {
+            for (uint32_t i = 0; i < slots.size(); i++) {
+                Slot &slot = slots[i];
+                if (slot.value) {
+                    func(Handle<T>{i, slot.generation}, *slot.value);
+                }
+            }
+        }
+
+        void clear() {
+            for (uint32_t i = 0; i < slots.size(); i++) {
+                if (slots[i].value) {
+                    destroy({i, slots[i].generation});
+                }
+            }
+        }
+
+        size_t size() const { return live_count; }
+
+    private:
+        struct Slot {
+            std::optional<T> value{};
+            uint32_t generation{1};
+        };
+
+        /* Deque so growth never relocates live resources */
+        std::deque<Slot> slots{};
+        std::vector<uint32_t> free_indices{};
+        size_t live_count{0};
+    };
+
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.h>
+
+#include "engine/vulkan/device.hpp"
+
+namespace muon {
+
+    class RenderGraph;
+
+    struct RenderGraphImage {
+        static constexpr uint32_t INVALID = UINT32_MAX;
+        uint32_t index{INVALID};
+
+        bool isValid() const { return index != INVALID; }
+    };
+
+    struct RenderGraphBuffer {
+        static constexpr uint32_t INVALID = UINT32_MAX;
+        uint32_t index{INVALID};
+
+        bool isValid() const { return index != INVALID; }
+    };
+
+    /**
+        *  Frame graph over images and buffers
+        *
+        *  Passes declare what they read and write in a setup callback. compile()
+        *  culls passes whose results are never consumed, precomputes the
+        *  barriers between the remaining ones and places transient images with
+        *  disjoint lifetimes in the same memory. execute() then only replays
+        *  the plan, so the graph is built once and recompiled when its inputs
+        *  change, such as on resize.
+        *
+        *  Passes with attachments get a render pass and framebuffer from the
+        *  graph. All layout transitions happen in the graph's barriers, so the
+        *  render passes keep their attachments in one layout throughout.
+    */
+    class RenderGraph {
+    public:
+        enum class LoadOp {
+            Load,
+            Clear,
+            DontCare,
+        };
+
+        struct ImageDesc {
+            vk::Extent2D extent{};
+            vk::Format format{vk::Format::eUndefined};
+            /* Added to the usage derived from the passes, e.g. eTransferSrc for readbacks */
+            vk::ImageUsageFlags usage{};
+        };
+
+        struct Stats {
+            uint32_t passes{0};
+            uint32_t culled_passes{0};
+            uint32_t barriers{0};
+            uint32_t barrier_batches{0};
+            vk::DeviceSize transient_memory{0};
+            vk::DeviceSize transient_memory_unaliased{0};
+        };
+
+        class PassBuilder {
+        public:
+            void writeColor(RenderGraphImage image, LoadOp load_op = LoadOp::Clear, vk::ClearColorValue clear_value = {});
+            void writeDepth(RenderGraphImage image, LoadOp load_op = LoadOp::Clear, vk::ClearDepthStencilValue clear_value = {1.0f, 0});
+            void readTexture(RenderGraphImage image, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eFragmentShader);
+            void readStorageImage(RenderGraphImage image, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eComputeShader);
+            void writeStorageImage(RenderGraphImage image, vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eComputeShader);
+            void readBuffer(RenderGraphBuffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access);
+            void writeBuffer(RenderGraphBuffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access);
+            /* Keeps the pass even if nothing in the graph consumes its output */
+            void setSideEffect() { side_effect = true; }
+
+        private:
+            friend class RenderGraph;
+
+            RenderGraph &graph;
+            uint32_t pass_index;
+            bool side_effect{false};
+
+            PassBuilder(RenderGraph &graph, uint32_t pass_index) : graph{graph}, pass_index{pass_index} {}
+        };
+
+        struct PassContext {
+            vk::CommandBuffer command_buffer;
+            vk::RenderPass render_pass;
+            vk::Extent2D extent;
+            const RenderGraph &graph;
+        };
+
+        using SetupFunction = std::function<void(PassBuilder &builder)>;
+        using ExecuteFunction = std::function<void(PassContext &context)>;
+
+        explicit RenderGraph(Device &device) : device{device} {}
+        ~RenderGraph();
+
+        RenderGraph(const RenderGraph &) = delete;
+        RenderGraph& operator=(const RenderGraph &) = delete;
+
+        RenderGraphImage createImage(const std::string &name, const ImageDesc &desc);
+        /* Transitions to final_layout at the end of execute() when the last pass left it elsewhere */
+        RenderGraphImage importImage(const std::string &name, vk::Image image, vk::ImageView view, const ImageDesc &desc, vk::ImageLayout initial_layout, vk::ImageLayout final_layout);
+        RenderGraphBuffer importBuffer(const std::string &name, vk::Buffer buffer);
+        /* For imports that change every frame, such as the acquired swapchain image */
+        void setImportedImage(RenderGraphImage image, vk::Image handle, vk::ImageView view);
+
+        void addPass(const std::string &name, const SetupFunction &setup, ExecuteFunction &&execute);
+
+        void compile();
+        void execute(vk::CommandBuffer command_buffer);
+        /* Drops passes and resources, GPU objects are released through the deletion queue */
+        void reset();
+
+        vk::Image getImage(RenderGraphImage image) const { return images[image.index].image; }
+        vk::ImageView getImageView(RenderGraphImage image) const { return images[image.index].view; }
+        vk::Buffer getBuffer(RenderGraphBuffer buffer) const { return buffers[buffer.index].buffer; }
+        const Stats &getStats() const { return stats; }
+
+    private:
+        enum class ResourceKind {
+            Image,
+            Buffer,
+        };
+
+        enum class UsageType {
+            ColorAttachment,
+            DepthAttachment,
+            Texture,
+            StorageRead,
+            StorageWrite,
+            BufferRead,
+            BufferWrite,
+        };
+
+        struct Usage {
+            ResourceKind kind;
+            uint32_t index;
+            UsageType type;
+            vk::PipelineStageFlags stages;
+            vk::AccessFlags access;
+            vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+            bool read;
+            bool write;
+            LoadOp load_op{LoadOp::DontCare};
+            vk::ClearValue clear_value{};
+        };
+
+        struct ImageResource {
+            std::string name;
+            ImageDesc desc;
+            vk::Image image{};
+            vk::ImageView view{};
+            bool imported{false};
+            vk::ImageLayout initial_layout{vk::ImageLayout::eUndefined};
+            vk::ImageLayout final_layout{vk::ImageLayout::eUndefined};
+
+            /* Filled by compile() */
+            vk::ImageUsageFlags usage{};
+            uint32_t first_pass{UINT32_MAX};
+            uint32_t last_pass{0};
+            std::optional<uint32_t> alias_slot{};
+        };
+
+        struct BufferResource {
+            std::string name;
+            vk::Buffer buffer{};
+        };
+
+        struct ImageBarrier {
+            uint32_t image;
+            vk::ImageLayout old_layout;
+            vk::ImageLayout new_layout;
+            vk::PipelineStageFlags src_stages;
+            vk::AccessFlags src_access;
+            vk::PipelineStageFlags dst_stages;
+            vk::AccessFlags dst_access;
+        };
+
+        struct BufferBarrier {
+            uint32_t buffer;
+            vk::PipelineStageFlags src_stages;
+            vk::AccessFlags src_access;
+            vk::PipelineStageFlags dst_stages;
+            vk::AccessFlags dst_access;
+        };
+
+        struct BarrierBatch {
+            std::vector<ImageBarrier> image_barriers{};
+            std::vector<BufferBarrier> buffer_barriers{};
+
+            bool empty() const { return image_barriers.empty() && buffer_barriers.empty(); }
+        };
+
+        struct Pass {
+            std::string name;
+            ExecuteFunction execute;
+            std::vector<Usage> usages{};
+            bool side_effect{false};
+
+            /* Filled by compile() */
+            bool culled{false};
+            BarrierBatch barriers{};
+            vk::RenderPass render_pass{};
+            std::map<std::vector<VkImageView>, vk::Framebuffer> framebuffers{};
+            std::vector<vk::ClearValue> clear_values{};
+            vk::Extent2D extent{};
+        };
+
+        /* Several transient images with disjoint lifetimes bound to one allocation */
+        struct AliasSlot {
+            VmaAllocation allocation{};
+            vk::MemoryRequirements requirements{};
+            std::vector<uint32_t> images{};
+        };
+
+        /* Access since the last write, tracked per resource while planning barriers */
+        struct ResourceState {
+            vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+            vk::PipelineStageFlags write_stages{};
+            vk::AccessFlags write_access{};
+            vk::PipelineStageFlags read_stages{};
+            vk::AccessFlags read_access{};
+        };
+
+        Device &device;
+
+        std::vector<ImageResource> images{};
+        std::vector<BufferResource> buffers{};
+        std::vector<Pass> passes{};
+        std::vector<AliasSlot> alias_slots{};
+        BarrierBatch final_barriers{};
+        bool compiled{false};
+        Stats stats{};
+
+        void addUsage(uint32_t pass_index, Usage &&usage);
+
+        void cullPasses();
+        void computeLifetimes();
+        void createTransientImages();
+        void planBarriers();
+        void createRenderPasses();
+
+        /* frame_end_images, when given, is what the previous frame left in each image's memory */
+        void planPasses(std::vector<ResourceState> &image_states, std::vector<ResourceState> &buffer_states, const std::vector<ResourceState> *frame_end_images);
+        void planUsage(BarrierBatch &batch, std::vector<ResourceState> &image_states, std::vector<ResourceState> &buffer_states, const Usage &usage);
+        void recordBarriers(vk::CommandBuffer command_buffer, const BarrierBatch &batch) const;
+        vk::Framebuffer getFramebuffer(Pass &pass);
+        void releaseResources();
+
+        static bool isDepthFormat(vk::Format format);
+        vk::ImageAspectFlags aspectMask(uint32_t image) const;
+    };
+
+}
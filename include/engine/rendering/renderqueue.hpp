@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace muon {
+
+    /**
+        *  Draw packets ordered by a 64 bit sort key
+        *
+        *  Opaque keys put state above depth, so draws group by pipeline,
+        *  material and mesh and go front to back within a group. Transparent
+        *  keys put inverted depth first so they go back to front.
+        *
+        *  Opaque:      pass:4 | 0 | pipeline:8 | material:12 | mesh:16 | depth:23
+        *  Transparent: pass:4 | 1 | ~depth:23 | pipeline:8 | material:12 | mesh:16
+    */
+    class RenderQueue {
+    public:
+        struct Packet {
+            uint64_t key;
+            /* Index into the caller's draw data */
+            uint32_t payload;
+        };
+
+        static constexpr uint32_t PASS_BITS = 4;
+        static constexpr uint32_t PIPELINE_BITS = 8;
+        static constexpr uint32_t MATERIAL_BITS = 12;
+        static constexpr uint32_t MESH_BITS = 16;
+        static constexpr uint32_t DEPTH_BITS = 23;
+
+        static uint64_t opaqueKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+        static uint64_t transparentKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth);
+        static bool isTransparent(uint64_t key);
+        /* Key with the depth bits masked off, equal for packets that share all state */
+        static uint64_t stateKey(uint64_t key);
+        static uint32_t quantizeDepth(float depth);
+
+        void push(uint64_t key, uint32_t payload) { packets.push_back({key, payload}); }
+        void reserve(size_t count) { packets.reserve(count); }
+        void clear() { packets.clear(); }
+        void sort();
+
+        std::span<const Packet> getPackets() const { return packets; }
+        size_t size() const { return packets.size(); }
+        bool empty() const { return packets.empty(); }
+
+    private:
+        std::vector<Packet> packets{};
+        std::vector<Packet> scratch{};
+    };
+
+}
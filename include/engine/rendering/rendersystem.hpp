@@ -1,16 +1,34 @@
 #pragma once
 
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <vulkan/vulkan.hpp>
 
+#include "engine/vulkan/descriptorcache.hpp"
 #include "engine/vulkan/device.hpp"
+#include "engine/vulkan/descriptors.hpp"
+#include "engine/vulkan/frameallocator.hpp"
 #include "engine/vulkan/pipeline.hpp"
+#include "engine/vulkan/pipelineregistry.hpp"
 #include "engine/vulkan/model.hpp"
 #include "engine/vulkan/frameinfo.hpp"
+#include "engine/rendering/renderqueue.hpp"
+#include "engine/rendering/textrenderer.hpp"
 
 namespace muon {
+    enum class BlendMode {
+        Opaque,
+        Transparent,
+    };
+
     class RenderSystem3D {
     public:
-        RenderSystem3D(Device &device, vk::RenderPass render_pass, vk::DescriptorSetLayout descriptor_set_layout);
+        /* Instance matrices are uploaded in chunks of up to this many, one storage buffer bind each */
+        static constexpr uint32_t MAX_INSTANCES_PER_BATCH = 1024;
+
+        RenderSystem3D(Device &device, PipelineRegistry &pipeline_registry, const PipelineTarget &target, vk::DescriptorSetLayout descriptor_set_layout, FrameAllocator &frame_allocator, DescriptorCache &descriptor_cache, DescriptorAllocator &descriptor_allocator);
         ~RenderSystem3D();
 
         RenderSystem3D(const RenderSystem3D&) = delete;
@@ -19,15 +37,114 @@ namespace muon {
 
         // void render_game_objects(FrameInfo &frame_info, std::vector<GameObject>& game_objects);
         void renderModel(FrameInfo &frame_info, Model &model);
-        void renderModel(FrameInfo &frame_info, Model &model, glm::mat4 transform);
+        void renderModel(FrameInfo &frame_info, Model &model, glm::mat4 transform, uint32_t texture_index = 0);
+
+        /*
+            Queues an instance, everything sharing a model is drawn with one call in renderInstances.
+            Textures are bindless table indices carried per instance, so they never split a group.
+        */
+        void addInstance(Model &model, const glm::mat4 &transform, uint32_t texture_index = 0);
+        void renderInstances(FrameInfo &frame_info);
+
+        /*
+            Queues a draw for flush(), which sorts everything submitted this frame.
+            Opaque draws are instanced front to back, transparent ones drawn back to front.
+        */
+        void submit(FrameInfo &frame_info, Model &model, const glm::mat4 &transform, BlendMode blend_mode = BlendMode::Opaque, uint32_t texture_index = 0);
+        void flush(FrameInfo &frame_info);
+
+        /*
+            flush() split in two for parallel recording. prepare() sorts and uploads
+            instance data on the calling thread, record() only reads the prepared
+            draws and may run concurrently for disjoint ranges on separate recorders.
+        */
+        void prepare(FrameInfo &frame_info);
+        void record(const FrameInfo &frame_info, CommandRecorder &recorder, uint32_t begin, uint32_t end) const;
+        uint32_t getDrawCount() const { return static_cast<uint32_t>(draw_ops.size()); }
+
+        uint32_t getInstancedDrawCount() const { return instanced_draw_count; }
+
+        /* Every label with the default pipeline, after the scene since text is blended */
+        void renderText(const FrameInfo &frame_info, CommandRecorder &recorder, const TextRenderer &text_renderer) const;
 
     private:
+        struct InstanceGroup {
+            Model *model;
+            uint32_t count;
+            uint32_t first;
+        };
+
+        struct Instance {
+            uint32_t group;
+            glm::mat4 transform;
+            uint32_t texture_index;
+        };
+
+        /* Matches Instance in instanced.vert, std430 pads it to a multiple of 16 bytes */
+        struct InstanceData {
+            glm::mat4 model;
+            uint32_t texture_index;
+            uint32_t padding[3];
+        };
+        static_assert(sizeof(InstanceData) == 80, "InstanceData must match the std430 layout in instanced.vert");
+
+        struct QueuedDraw {
+            Model *model;
+            glm::mat4 transform;
+            uint32_t texture_index;
+        };
+
+        struct DrawOp {
+            Model *model;
+            glm::mat4 transform;
+            uint32_t texture_index;
+            uint32_t instance_count;
+            uint32_t first_instance;
+            uint32_t dynamic_offset;
+            bool instanced;
+            /* Instanced only, the set for the frame allocator buffer the batch landed in */
+            vk::DescriptorSet instance_set{};
+        };
+
+        /* Pipeline ids in sort keys */
+        static constexpr uint32_t PIPELINE_DEFAULT = 0;
+        static constexpr uint32_t PIPELINE_INSTANCED = 1;
+
         Device &device;
+        PipelineRegistry &pipeline_registry;
+        FrameAllocator &frame_allocator;
+        DescriptorCache &descriptor_cache;
+        DescriptorAllocator &descriptor_allocator;
 
-        std::unique_ptr<Pipeline> pipeline;
+        /* Compiled in the background, draws are skipped until they are ready */
+        PipelineHandle pipeline;
+        /* Shared by both pipelines, built from shader reflection and owned by the device's layout cache */
         vk::PipelineLayout pipeline_layout;
+        vk::ShaderStageFlags push_constant_stages{};
+
+        PipelineHandle instanced_pipeline;
+        std::unique_ptr<DescriptorSetLayout> instance_set_layout;
+        vk::DescriptorSet instance_descriptor_set;
+        /* Transient sets for the overflow blocks this frame's batches landed in */
+        std::vector<std::pair<vk::Buffer, vk::DescriptorSet>> overflow_sets{};
+
+        std::unordered_map<Model *, uint32_t> group_lookup{};
+        std::vector<InstanceGroup> instance_groups{};
+        std::vector<Instance> instances{};
+        std::vector<InstanceData> sorted_instances{};
+        uint32_t instanced_draw_count{0};
+
+        RenderQueue render_queue{};
+        std::vector<QueuedDraw> queued_draws{};
+        std::unordered_map<Model *, uint32_t> mesh_ids{};
+        std::vector<DrawOp> draw_ops{};
 
-        void createPipelineLayout(vk::DescriptorSetLayout descriptor_set_layout);
-        void createPipeline(vk::RenderPass render_pass);
+        void prepareInstances();
+        vk::DescriptorSet instanceSet(vk::Buffer buffer);
+        void recordDraw(const FrameInfo &frame_info, CommandRecorder &recorder, const DrawOp &op) const;
+        void bindGlobalState(const FrameInfo &frame_info, CommandRecorder &recorder, vk::Pipeline pipeline, vk::PipelineLayout layout) const;
+        void createPipelineLayout(vk::DescriptorSetLayout global_set_layout);
+        void createInstanceDescriptors(const std::vector<vk::DescriptorSetLayoutBinding> &instance_bindings);
+        void createPipelines(const PipelineTarget &target);
     };
 }
@@ -1 +1,91 @@
 #pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "engine/vulkan/buffer.hpp"
+#include "engine/vulkan/device.hpp"
+#include "engine/vulkan/font.hpp"
+#include "engine/vulkan/model.hpp"
+
+namespace muon {
+
+    /**
+        *  Text labels in persistently mapped vertex buffers, one per frame in flight
+        *
+        *  Each label owns a fixed range of glyph slots in every frame's buffer.
+        *  setText() lays the string out only when it changed and writes it
+        *  straight into the current frame's buffer, the other frames pick the
+        *  copy up in their own beginFrame(). Every slot draws from one shared
+        *  index buffer of quads, so changing text never touches indices and
+        *  never waits on the GPU.
+    */
+    class TextRenderer {
+    public:
+        using LabelId = uint32_t;
+
+        /* Glyph slots shared by every label */
+        static constexpr uint32_t MAX_GLYPHS = 4096;
+
+        struct Label {
+            glm::mat4 transform{1.0f};
+            uint32_t first_glyph;
+            uint32_t max_glyphs;
+            uint32_t glyph_count{0};
+            std::string text{};
+            /* Kept so stale frames are a copy rather than a fresh layout */
+            std::vector<Model::Vertex> vertices{};
+            uint64_t version{0};
+        };
+
+        TextRenderer(Device &device, Font &font, uint32_t frame_count);
+        ~TextRenderer() = default;
+
+        TextRenderer(const TextRenderer &) = delete;
+        TextRenderer& operator=(const TextRenderer &) = delete;
+
+        LabelId createLabel(uint32_t max_glyphs, const glm::mat4 &transform = glm::mat4{1.0f});
+        /* Text past the label's glyph slots is cut off */
+        void setText(LabelId label, std::string_view text);
+        void setTransform(LabelId label, const glm::mat4 &transform);
+
+        /* Call after the renderer's beginFrame and before any setText that frame */
+        void beginFrame(uint32_t frame_index);
+
+        /* Distance between baselines in label space, for stacking labels as lines */
+        float getLineHeight() const;
+
+        const std::vector<Label> &getLabels() const { return labels; }
+        vk::Buffer getVertexBuffer() const { return frames[current_frame].vertex_buffer->getBuffer(); }
+        vk::Buffer getIndexBuffer() const { return index_buffer->getBuffer(); }
+        uint32_t getTextureIndex() const { return font.getAtlas()->getBindlessIndex(); }
+
+    private:
+        struct FrameBuffers {
+            std::unique_ptr<Buffer> vertex_buffer;
+            /* Label version last written into this buffer */
+            std::vector<uint64_t> label_versions{};
+        };
+
+        Device &device;
+        Font &font;
+
+        std::unique_ptr<Buffer> index_buffer;
+        std::vector<FrameBuffers> frames;
+        uint32_t current_frame{0};
+
+        std::vector<Label> labels{};
+        uint32_t next_glyph{0};
+
+        void createIndexBuffer();
+        void layoutText(Label &label) const;
+        void upload(FrameBuffers &frame, LabelId id);
+    };
+
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace muon {
+
+    class Device;
+
+    /**
+        *  One global descriptor set holding every texture in a sampler array
+        *
+        *  Textures register themselves and get back an index that draws pass
+        *  along in their per-draw data, so switching textures never binds a
+        *  set. The binding is UPDATE_AFTER_BIND and PARTIALLY_BOUND, which lets
+        *  slots be written while the set is bound in frames still in flight,
+        *  as long as those frames never sample them. Freed slots are reused,
+        *  callers release an index only after the frames using it retire.
+    */
+    class BindlessTable {
+    public:
+        static constexpr uint32_t MAX_TEXTURES = 4096;
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        explicit BindlessTable(Device &device);
+        ~BindlessTable();
+
+        BindlessTable(const BindlessTable &) = delete;
+        BindlessTable& operator=(const BindlessTable &) = delete;
+
+        uint32_t addTexture(const vk::DescriptorImageInfo &image_info);
+        void removeTexture(uint32_t index);
+
+        vk::DescriptorSetLayout getDescriptorSetLayout() const { return descriptor_set_layout; }
+        vk::DescriptorSet getDescriptorSet() const { return descriptor_set; }
+        uint32_t getCapacity() const { return capacity; }
+        uint32_t getTextureCount() const;
+
+    private:
+        Device &device;
+
+        /* Created here rather than in the layout cache, which has no binding flags */
+        vk::DescriptorSetLayout descriptor_set_layout{};
+        vk::DescriptorPool descriptor_pool{};
+        vk::DescriptorSet descriptor_set{};
+        uint32_t capacity{0};
+
+        mutable std::mutex mutex{};
+        uint32_t next_index{0};
+        std::vector<uint32_t> free_indices{};
+
+        void createDescriptorSetLayout();
+        void createDescriptorSet();
+    };
+
+}
@@ -9,7 +9,7 @@ namespace muon {
     class Buffer {
     public:
         Buffer(Device &device, vk::DeviceSize instance_size, uint32_t instance_count,
-            vk::BufferUsageFlags usage_flags, vk::MemoryPropertyFlags memory_property_flags, vk::DeviceSize min_offset_alignment = 1);
+            vk::BufferUsageFlags usage_flags, vk::MemoryPropertyFlags memory_property_flags, vk::DeviceSize min_offset_alignment = 1, bool shared = false);
         ~Buffer();
 
         Buffer(const Buffer &) = delete;
@@ -36,19 +36,23 @@ namespace muon {
         vk::DeviceSize getAlignmentSize() const { return alignment_size; }
         vk::BufferUsageFlags getUsageFlags() const { return usage_flags; }
         vk::MemoryPropertyFlags getMemoryPropertyFlags() const { return memory_property_flags; }
+        /* Usable from the transfer family without an ownership transfer */
+        bool isShared() const { return shared; }
 
     private:
         Device &device;
-        vk::DeviceMemory memory = nullptr;
+        VmaAllocation allocation = nullptr;
 
         vk::Buffer buffer = nullptr;
         vk::DeviceSize buffer_size;
         void *mapped = nullptr;
+        bool persistently_mapped = false;
         uint32_t instance_count;
         vk::DeviceSize instance_size;
         vk::DeviceSize alignment_size;
         vk::BufferUsageFlags usage_flags;
         vk::MemoryPropertyFlags memory_property_flags;
+        bool shared;
     };
 
     vk::DeviceSize getAlignment(vk::DeviceSize instance_size, vk::DeviceSize min_offset_alignment);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <span>
+
+#include <vulkan/vulkan.hpp>
+
+namespace muon {
+
+    /**
+        *  Thin wrapper over a command buffer that drops redundant state changes
+        *
+        *  Tracks the bound pipeline, descriptor sets per set index, vertex and
+        *  index buffers, viewport and scissor. Calls that would not change the
+        *  bound state are skipped and counted, the rest are forwarded as is.
+    */
+    class CommandRecorder {
+    public:
+        static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+        static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 4;
+
+        struct Stats {
+            uint32_t pipeline_binds{0};
+            uint32_t pipeline_binds_skipped{0};
+            uint32_t descriptor_binds{0};
+            uint32_t descriptor_binds_skipped{0};
+            uint32_t buffer_binds{0};
+            uint32_t buffer_binds_skipped{0};
+            uint32_t dynamic_state_sets{0};
+            uint32_t dynamic_state_sets_skipped{0};
+            uint32_t draws{0};
+
+            uint32_t issued() const { return pipeline_binds + descriptor_binds + buffer_binds + dynamic_state_sets; }
+            uint32_t skipped() const { return pipeline_binds_skipped + descriptor_binds_skipped + buffer_binds_skipped + dynamic_state_sets_skipped; }
+
+            Stats &operator+=(const Stats &other);
+        };
+
+        CommandRecorder() = default;
+        explicit CommandRecorder(vk::CommandBuffer command_buffer) { begin(command_buffer); }
+
+        /* Starts tracking a freshly begun command buffer, clears state and stats */
+        void begin(vk::CommandBuffer command_buffer);
+        /* Forget bound state, e.g. after state was changed behind the recorder's back */
+        void invalidate();
+
+        void bindPipeline(vk::Pipeline pipeline);
+        void bindDescriptorSet(vk::PipelineLayout layout, uint32_t set_index, vk::DescriptorSet set, std::span<const uint32_t> dynamic_offsets = {});
+        void bindVertexBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0);
+        void bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::IndexType index_type = vk::IndexType::eUint32);
+        void setViewport(const vk::Viewport &viewport);
+        void setScissor(const vk::Rect2D &scissor);
+
+        void pushConstants(vk::PipelineLayout layout, vk::ShaderStageFlags stages, uint32_t offset, uint32_t size, const void *data);
+        void draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance);
+        void drawIndexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance);
+
+        vk::CommandBuffer getCommandBuffer() const { return command_buffer; }
+        const Stats &getStats() const { return stats; }
+
+    private:
+        struct BoundSet {
+            vk::PipelineLayout layout{};
+            vk::DescriptorSet set{};
+            uint32_t dynamic_offset_count{0};
+            std::array<uint32_t, MAX_DYNAMIC_OFFSETS> dynamic_offsets{};
+        };
+
+        vk::CommandBuffer command_buffer{};
+        Stats stats{};
+
+        vk::Pipeline pipeline{};
+        std::array<BoundSet, MAX_DESCRIPTOR_SETS> sets{};
+        vk::Buffer vertex_buffer{};
+        vk::DeviceSize vertex_offset{0};
+        vk::Buffer index_buffer{};
+        vk::DeviceSize index_offset{0};
+        vk::IndexType index_type{vk::IndexType::eUint32};
+        std::optional<vk::Viewport> viewport{};
+        std::optional<vk::Rect2D> scissor{};
+    };
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+
+namespace muon {
+
+    /**
+        *  Defers destruction of GPU objects until the frames using them retire
+        *
+        *  Deleters are tagged with the frame being recorded when they were
+        *  enqueued. The renderer advances the frame and collects every tag
+        *  whose fence has been waited on, so nothing is freed while a command
+        *  buffer in flight may still reference it.
+    */
+    class DeletionQueue {
+    public:
+        DeletionQueue() = default;
+        ~DeletionQueue();
+
+        DeletionQueue(const DeletionQueue &) = delete;
+        DeletionQueue& operator=(const DeletionQueue &) = delete;
+
+        void enqueue(std::function<void()> &&deleter);
+
+        void setCurrentFrame(uint64_t frame) { current_frame = frame; }
+        void collect(uint64_t completed_frame);
+        /* Only safe once the device is idle */
+        void flush();
+
+        uint64_t getCurrentFrame() const { return current_frame; }
+        size_t size() const { return deleters.size(); }
+
+    private:
+        uint64_t current_frame{0};
+        std::deque<std::pair<uint64_t, std::function<void()>>> deleters{};
+    };
+
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "engine/vulkan/device.hpp"
+
+namespace muon {
+
+    /**
+        *  Descriptor sets from lists of pools that grow instead of failing
+        *
+        *  Persistent sets live as long as the allocator. Transient sets come
+        *  from one pool list per frame in flight that is reset wholesale in
+        *  beginFrame(), so per-draw sets are a bump allocation and nothing is
+        *  freed set by set. An exhausted pool is retired for a new, larger one.
+        *  A frame that spilled over several pools gets them replaced with one
+        *  sized to its observed usage on its next reset. Not thread safe,
+        *  allocate on the thread that owns the frame.
+    */
+    class DescriptorAllocator {
+    public:
+        /* Descriptors of a type per set in a pool */
+        struct PoolSizeRatio {
+            vk::DescriptorType descriptor_type;
+            float ratio;
+        };
+
+        static constexpr uint32_t INITIAL_SETS_PER_POOL = 64;
+        static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+        DescriptorAllocator(Device &device, uint32_t frame_count);
+        ~DescriptorAllocator();
+
+        DescriptorAllocator(const DescriptorAllocator &) = delete;
+        DescriptorAllocator& operator=(const DescriptorAllocator &) = delete;
+
+        /* Must only be called once the fence of the frame that last used frame_index has signalled */
+        void beginFrame(uint32_t frame_index);
+
+        vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+        /* Valid until the current frame slot comes round again */
+        vk::DescriptorSet allocateTransient(vk::DescriptorSetLayout layout);
+
+        size_t getPoolCount() const;
+
+    private:
+        struct PoolList {
+            std::vector<vk::DescriptorPool> full{};
+            std::vector<vk::DescriptorPool> ready{};
+            uint32_t sets_per_pool{INITIAL_SETS_PER_POOL};
+            /* Sets handed out since the last reset, across every pool */
+            uint32_t allocated_sets{0};
+        };
+
+        Device &device;
+        std::vector<PoolSizeRatio> ratios;
+
+        PoolList persistent{};
+        std::vector<PoolList> frames;
+        uint32_t current_frame{0};
+
+        vk::DescriptorSet allocate(PoolList &list, vk::DescriptorSetLayout layout);
+        vk::DescriptorPool acquirePool(PoolList &list);
+        vk::DescriptorPool createPool(uint32_t set_count);
+        void resetPools(PoolList &list);
+        void destroyPools(PoolList &list);
+    };
+
+}
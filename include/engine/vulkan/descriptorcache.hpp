@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "engine/vulkan/descriptorallocator.hpp"
+
+namespace muon {
+
+    /**
+        *  Descriptor sets keyed by what is written into them
+        *
+        *  The key is the set layout followed by every binding's type and
+        *  resource handles, so building a set that matches one built before
+        *  returns the existing set without allocating or writing anything.
+        *  Sets are persistent allocations and live as long as the allocator.
+        *  A key names handles, not objects, callers must not look up sets
+        *  for resources that have been destroyed.
+    */
+    class DescriptorCache {
+    public:
+        using Key = std::vector<uint64_t>;
+
+        explicit DescriptorCache(DescriptorAllocator &allocator) : allocator{allocator} {}
+
+        DescriptorCache(const DescriptorCache &) = delete;
+        DescriptorCache& operator=(const DescriptorCache &) = delete;
+
+        /* On a miss a set is allocated and handed to write before anyone else can see it */
+        vk::DescriptorSet get(const Key &key, vk::DescriptorSetLayout layout, const std::function<void(vk::DescriptorSet)> &write);
+
+        size_t getSetCount() const;
+        uint64_t getHitCount() const;
+        uint64_t getMissCount() const;
+
+    private:
+        struct KeyHash {
+            size_t operator()(const Key &key) const;
+        };
+
+        DescriptorAllocator &allocator;
+
+        /* Also serialises the cache's use of the allocator */
+        mutable std::mutex mutex{};
+        std::unordered_map<Key, vk::DescriptorSet, KeyHash> sets{};
+        uint64_t hits{0};
+        uint64_t misses{0};
+    };
+
+}
@@ -5,6 +5,8 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "engine/vulkan/descriptorallocator.hpp"
+#include "engine/vulkan/descriptorcache.hpp"
 #include "engine/vulkan/device.hpp"
 
 namespace muon {
@@ -16,6 +18,13 @@ namespace muon {
         uint32_t count{1};
     };
 
+    /* One slot of update template data, every descriptor takes the same stride */
+    union DescriptorData {
+        VkDescriptorImageInfo image;
+        VkDescriptorBufferInfo buffer;
+        VkBufferView texel_buffer_view;
+    };
+
     class DescriptorSetLayout {
     public:
         class Builder {
@@ -37,53 +46,29 @@ namespace muon {
         DescriptorSetLayout &operator=(const DescriptorSetLayout &) = delete;
 
         vk::DescriptorSetLayout getDescriptorSetLayout() const { return descriptor_set_layout; }
+        vk::DescriptorUpdateTemplate getUpdateTemplate() const { return update_template; }
 
     private:
         Device &device;
         vk::DescriptorSetLayout descriptor_set_layout;
         std::unordered_map<uint32_t, vk::DescriptorSetLayoutBinding> bindings;
 
-        friend class DescriptorWriter;
-    };
+        /* Writes every binding in one call, from DescriptorData laid out binding by binding */
+        vk::DescriptorUpdateTemplate update_template{};
+        std::unordered_map<uint32_t, uint32_t> template_slots{};
+        uint32_t template_slot_count{0};
 
-    class DescriptorPool {
-    public:
-        class Builder {
-        public:
-            Builder(Device &device) : device{device} {}
-
-            Builder &addPoolSize(vk::DescriptorType descriptor_type, uint32_t count);
-            Builder &setPoolFlags(vk::DescriptorPoolCreateFlags flags);
-            Builder &setMaxSets(uint32_t count);
-            std::unique_ptr<DescriptorPool> build() const;
-
-        private:
-            Device &device;
-            std::vector<vk::DescriptorPoolSize> pool_sizes{};
-            uint32_t max_sets = 1000;
-            vk::DescriptorPoolCreateFlags pool_flags = vk::DescriptorPoolCreateFlags{};
-        };
-
-        DescriptorPool(Device &device, uint32_t max_sets, vk::DescriptorPoolCreateFlags pool_flags, const std::vector<vk::DescriptorPoolSize> &pool_sizes);
-        ~DescriptorPool();
-
-        DescriptorPool(const DescriptorPool &) = delete;
-        DescriptorPool &operator=(const DescriptorPool &) = delete;
-
-        bool allocateDescriptor(const vk::DescriptorSetLayout descriptor_set_layout, vk::DescriptorSet &descriptor) const;
-        void freeDescriptors(std::vector<vk::DescriptorSet> &descriptors) const;
-        void resetPool();
-
-    private:
-        Device &device;
-        vk::DescriptorPool descriptor_pool;
+        void createUpdateTemplate();
 
         friend class DescriptorWriter;
     };
 
     class DescriptorWriter {
     public:
-        DescriptorWriter(DescriptorSetLayout &set_layout, DescriptorPool &pool);
+        /* Transient sets are only valid for the frame being recorded */
+        DescriptorWriter(DescriptorSetLayout &set_layout, DescriptorAllocator &allocator, bool transient = false);
+        /* Sets with the same contents are built once and shared */
+        DescriptorWriter(DescriptorSetLayout &set_layout, DescriptorCache &cache);
 
         DescriptorWriter &writeToBuffer(uint32_t binding, vk::DescriptorBufferInfo *buffer_info);
         DescriptorWriter &writeImage(uint32_t binding, vk::DescriptorImageInfo *image_info);
@@ -92,9 +77,16 @@ namespace muon {
         void overwrite(vk::DescriptorSet &set);
 
     private:
+        Device &device;
         DescriptorSetLayout &set_layout;
-        DescriptorPool &pool;
+        /* Exactly one of the two is set */
+        DescriptorAllocator *allocator{nullptr};
+        DescriptorCache *cache{nullptr};
+        bool transient{false};
         std::vector<vk::WriteDescriptorSet> writes;
+
+        DescriptorCache::Key makeKey();
+        bool writeWithTemplate(vk::DescriptorSet set) const;
     };
 
 }
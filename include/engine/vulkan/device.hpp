@@ -1,13 +1,24 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+
 #include <spdlog/spdlog.h>
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_handles.hpp>
+#include <vk_mem_alloc.h>
 
 #include "engine/window/window.hpp"
 
 namespace muon {
 
+    class BindlessTable;
+    class DeletionQueue;
+    class GeometryArena;
+    class LayoutCache;
+    class UploadQueue;
+
     struct SwapchainSupportDetails {
         vk::SurfaceCapabilitiesKHR capabilities;
         std::vector<vk::SurfaceFormatKHR> formats;
@@ -20,6 +31,11 @@ namespace muon {
         bool graphics_family_has_value{false};
         bool present_family_has_value{false};
 
+        /* Optional, either a transfer only family or a second queue in the graphics family */
+        uint32_t transfer_family{};
+        uint32_t transfer_queue_index{};
+        bool transfer_family_has_value{false};
+
         bool isComplete() const {
             return graphics_family_has_value && present_family_has_value;
         }
@@ -34,6 +50,8 @@ namespace muon {
     class Device {
     public:
         Device(Window &window);
+        /* Headless, no surface or swapchain support, rendering goes to offscreen targets */
+        Device();
         ~Device();
 
         Device(const Device &) = delete;
@@ -44,54 +62,117 @@ namespace muon {
         vk::Instance getInstance() const { return instance; }
         vk::PhysicalDevice getPhysicalDevice() const { return physical_device; }
         vk::CommandPool getCommandPool() const { return command_pool; }
+        vk::CommandPool getTransferCommandPool() const { return transfer_command_pool; }
         vk::Device getDevice() const { return device; }
         vk::SurfaceKHR getSurface() const { return surface; }
         vk::Queue getGraphicsQueue() const { return graphics_queue; }
         vk::Queue getPresentQueue() const { return present_queue; }
+        vk::Queue getTransferQueue() const { return transfer_queue; }
+        bool hasTransferQueue() const { return transfer_queue != nullptr; }
+        bool isHeadless() const { return window == nullptr; }
+        bool hasSynchronization2() const { return cmd_pipeline_barrier2 != nullptr; }
+        bool hasDynamicRendering() const { return cmd_begin_rendering != nullptr; }
+        const vk::PhysicalDeviceProperties &getProperties() const { return properties; }
+        const vk::PhysicalDeviceDescriptorIndexingPropertiesEXT &getDescriptorIndexingProperties() const { return descriptor_indexing_properties; }
+        VmaAllocator getAllocator() const { return allocator; }
+        DeletionQueue &getDeletionQueue() const { return *deletion_queue; }
+        UploadQueue &getUploadQueue() const { return *upload_queue; }
+        GeometryArena &getGeometryArena() const { return *geometry_arena; }
+        LayoutCache &getLayoutCache() const { return *layout_cache; }
+        BindlessTable &getBindlessTable() const { return *bindless_table; }
+        vk::PipelineCache getPipelineCache() const { return pipeline_cache; }
         SwapchainSupportDetails getSwapchainSupport() { return querySwapchainSupport(physical_device); }
         QueueFamilyIndices getPhysicalQueueFamilies() { return findQueueFamilies(physical_device); }
 
         uint32_t findMemoryType(uint32_t type_filter, vk::MemoryPropertyFlags properties);
         vk::Format findSupportedFormat(const std::vector<vk::Format> &candidates, vk::ImageTiling tiling, vk::FormatFeatureFlags features);
 
-        void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, vk::DeviceMemory &buffer_memory);
+        /* Shared buffers are concurrent between the graphics and transfer families when those differ */
+        void createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocation_info = nullptr, bool shared = false);
         vk::CommandBuffer beginSingleTimeCommands();
         void endSingleTimeCommands(vk::CommandBuffer command_buffer);
         void copyBuffer(vk::Buffer src_buffer, vk::Buffer dest_buffer, vk::DeviceSize size);
         void copyBufferToImage(vk::Buffer buffer, vk::Image image, uint32_t width, uint32_t height, uint32_t layer_count);
-        void createImageWithInfo(const vk::ImageCreateInfo &image_info, vk::MemoryPropertyFlags properties, vk::Image& image, vk::DeviceMemory& image_memory);
+        void createImageWithInfo(const vk::ImageCreateInfo &image_info, vk::MemoryPropertyFlags properties, vk::Image& image, VmaAllocation &allocation);
+        /* Only valid when hasSynchronization2() */
+        void pipelineBarrier2(vk::CommandBuffer command_buffer, const vk::DependencyInfoKHR &dependency_info) const;
+        /* Only valid when hasDynamicRendering() */
+        void beginRendering(vk::CommandBuffer command_buffer, const vk::RenderingInfoKHR &rendering_info) const;
+        void endRendering(vk::CommandBuffer command_buffer) const;
+
+        /*
+            Time spent in vkCreate*Pipelines, compared against the cold run when the cache is saved.
+            The fingerprints are summed, so the set of pipelines compiled is known whatever the order.
+        */
+        void addPipelineCompileTime(std::chrono::nanoseconds duration, uint64_t fingerprint) {
+            pipeline_compile_time += duration.count();
+            pipeline_set += fingerprint;
+        }
 
     private:
         vk::Instance instance{};
         vk::DebugUtilsMessengerEXT debug_messenger{};
         vk::PhysicalDevice physical_device = nullptr;
-        Window &window;
+        Window *window{nullptr};
         vk::CommandPool command_pool{};
+        vk::CommandPool transfer_command_pool{};
 
         vk::Device device{};
         vk::SurfaceKHR surface{};
         vk::Queue graphics_queue{};
         vk::Queue present_queue{};
+        vk::Queue transfer_queue{};
+
+        VmaAllocator allocator{};
+        std::unique_ptr<DeletionQueue> deletion_queue;
+        std::unique_ptr<UploadQueue> upload_queue;
+        std::unique_ptr<GeometryArena> geometry_arena;
+        std::unique_ptr<LayoutCache> layout_cache;
+        std::unique_ptr<BindlessTable> bindless_table;
 
         vk::PhysicalDeviceProperties properties{};
+        vk::PhysicalDeviceDescriptorIndexingPropertiesEXT descriptor_indexing_properties{};
+
+        /* VK_KHR_synchronization2 is optional, the instance targets Vulkan 1.1 */
+        PFN_vkCmdPipelineBarrier2KHR cmd_pipeline_barrier2{nullptr};
+        /* VK_KHR_dynamic_rendering, core only from 1.3 */
+        PFN_vkCmdBeginRenderingKHR cmd_begin_rendering{nullptr};
+        PFN_vkCmdEndRenderingKHR cmd_end_rendering{nullptr};
+
+        vk::PipelineCache pipeline_cache{};
+        /* Started from a cache file rather than empty */
+        bool pipeline_cache_loaded{false};
+        /* Compile time of the run that built the cache from scratch, zero if unknown or cold this run */
+        uint64_t cold_pipeline_compile_time{0};
+        /* Pipeline set the cold time was measured on, a different set makes the comparison meaningless */
+        uint64_t cold_pipeline_set{0};
+        std::atomic<uint64_t> pipeline_compile_time{0};
+        std::atomic<uint64_t> pipeline_set{0};
 
         const std::vector<const char *> validation_layers = {"VK_LAYER_KHRONOS_validation"};
         const std::vector<const char *> device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
+        void init();
         void createInstance();
         void setupDebugMessenger();
         void createSurface();
         void pickPhysicalDevice();
         void createLogicalDevice();
+        void createAllocator();
         void createCommandPool();
+        void createPipelineCache();
+        void savePipelineCache();
 
         bool isDeviceSuitable(vk::PhysicalDevice device);
+        bool supportsBindlessTextures(vk::PhysicalDevice device);
         std::vector<const char *> getRequiredExtensions();
+        std::vector<const char *> getRequiredDeviceExtensions() const;
         bool checkValidationLayerSupport();
         QueueFamilyIndices findQueueFamilies(vk::PhysicalDevice device);
         void populateDebugMessengerCreateInfo(vk::DebugUtilsMessengerCreateInfoEXT &create_info);
         void hasSdlRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(vk::PhysicalDevice device);
+        bool checkOptionalExtensionSupport(vk::PhysicalDevice device, const char *extension_name);
         SwapchainSupportDetails querySwapchainSupport(vk::PhysicalDevice device);
     };
 
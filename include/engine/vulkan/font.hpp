@@ -19,7 +19,7 @@ namespace muon {
         ~Font() = default;
 
         std::vector<msdf_atlas::GlyphGeometry> getGlyphs() { return glyphs; }
-        msdf_atlas::FontGeometry getFontGeometry() { return font_geometry; }
+        const msdf_atlas::FontGeometry &getFontGeometry() const { return font_geometry; }
         std::shared_ptr<Texture> getAtlas() const { return atlas; }
 
     private:
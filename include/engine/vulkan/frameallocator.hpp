@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "engine/vulkan/device.hpp"
+#include "engine/vulkan/buffer.hpp"
+
+namespace muon {
+
+    /**
+        *  Persistently mapped ring buffer split into one region per frame in flight
+        *
+        *  Hands out aligned slices for uniform, storage and dynamic vertex data.
+        *  A region is rewound in beginFrame(), which must only be called once
+        *  the fence of the frame that last used it has signalled.
+        *
+        *  A frame that outgrows its region chains overflow blocks, kept for
+        *  that frame's later overflows, so slices may come from a buffer
+        *  other than getBuffer(). Descriptors must use the slice's buffer.
+    */
+    class FrameAllocator {
+    public:
+        struct Slice {
+            vk::Buffer buffer;
+            vk::DeviceSize offset;
+            vk::DeviceSize size;
+            void *mapped;
+
+            vk::DescriptorBufferInfo descriptorInfo() const { return vk::DescriptorBufferInfo{buffer, offset, size}; }
+        };
+
+        FrameAllocator(Device &device, vk::DeviceSize frame_size, uint32_t frame_count);
+        ~FrameAllocator() = default;
+
+        FrameAllocator(const FrameAllocator &) = delete;
+        FrameAllocator& operator=(const FrameAllocator &) = delete;
+
+        void beginFrame(uint32_t frame_index);
+        void flush();
+
+        Slice allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+        Slice allocate(vk::DeviceSize size) { return allocate(size, min_alignment); }
+        /* For slices read through a dynamic descriptor of range bytes, which must not run past the slice's buffer */
+        Slice allocateDynamic(vk::DeviceSize size, vk::DeviceSize range);
+
+        template <typename T>
+        Slice push(const T &data) {
+            Slice slice = allocate(sizeof(T));
+            memcpy(slice.mapped, &data, sizeof(T));
+            return slice;
+        }
+
+        /* For sets written once against getBuffer(), must be the frame's first allocation */
+        template <typename T>
+        Slice pushGlobal(const T &data) {
+            Slice slice = allocateGlobal(sizeof(T));
+            memcpy(slice.mapped, &data, sizeof(T));
+            return slice;
+        }
+
+        vk::Buffer getBuffer() const { return buffer->getBuffer(); }
+        vk::DeviceSize getFrameSize() const { return frame_size; }
+        vk::DeviceSize getMinAlignment() const { return min_alignment; }
+        vk::DescriptorBufferInfo descriptorInfo(vk::DeviceSize range) const { return vk::DescriptorBufferInfo{buffer->getBuffer(), 0, range}; }
+
+    private:
+        struct OverflowBlock {
+            std::unique_ptr<Buffer> buffer;
+            vk::DeviceSize offset{0};
+        };
+
+        Device &device;
+        std::unique_ptr<Buffer> buffer;
+
+        vk::DeviceSize frame_size;
+        vk::DeviceSize min_alignment;
+
+        uint32_t current_frame{0};
+        vk::DeviceSize frame_begin{0};
+        vk::DeviceSize frame_offset{0};
+
+        /* Per frame in flight, the first overflow_count are in use this frame */
+        std::vector<std::vector<OverflowBlock>> overflow_blocks;
+        size_t overflow_count{0};
+
+        Slice allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize range);
+        Slice allocateGlobal(vk::DeviceSize size);
+        Slice allocateOverflow(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize range);
+        std::unique_ptr<Buffer> createBuffer(vk::DeviceSize size, uint32_t count) const;
+    };
+
+}
@@ -1,19 +1,64 @@
 #pragma once
 
 #include <vulkan/vulkan.hpp>
+#include <vk_mem_alloc.h>
 
 #include "engine/vulkan/device.hpp"
 
 namespace muon {
 
+    /**
+        *  Offscreen colour and depth target with its own render pass
+        *
+        *  Stands in for the swapchain when rendering headless. The render
+        *  pass matches the swapchain's attachment formats, so pipelines built
+        *  against either are interchangeable. Frames in flight share the one
+        *  target, each render pass waits for the previous one's writes. With
+        *  dynamic rendering there is no render pass or framebuffer, only the
+        *  images.
+    */
     class Framebuffer {
     public:
-        Framebuffer(Device &device, vk::RenderPass render_pass, vk::Extent2D extent);
+        Framebuffer(Device &device, vk::Extent2D extent);
         ~Framebuffer();
 
+        Framebuffer(const Framebuffer &) = delete;
+        Framebuffer& operator=(const Framebuffer &) = delete;
+
+        vk::Framebuffer getFramebuffer() const { return framebuffer; }
+        vk::RenderPass getRenderPass() const { return render_pass; }
+        vk::Extent2D getExtent() const { return extent; }
+        vk::Image getColorImage() const { return color_image; }
+        vk::ImageView getColorImageView() const { return color_image_view; }
+        vk::Format getColorFormat() const { return color_format; }
+        vk::Image getDepthImage() const { return depth_image; }
+        vk::ImageView getDepthImageView() const { return depth_image_view; }
+        vk::Format getDepthFormat() const { return depth_format; }
+        float extentAspectRatio() const { return static_cast<float>(extent.width) / static_cast<float>(extent.height); }
+
     private:
-        vk::Framebuffer framebuffer;
+        Device &device;
+        vk::Extent2D extent;
+
+        vk::Format color_format{vk::Format::eB8G8R8A8Srgb};
+        vk::Format depth_format{};
+
+        vk::Image color_image{};
+        VmaAllocation color_image_allocation{};
+        vk::ImageView color_image_view{};
+
+        vk::Image depth_image{};
+        VmaAllocation depth_image_allocation{};
+        vk::ImageView depth_image_view{};
+
+        vk::RenderPass render_pass{};
+        vk::Framebuffer framebuffer{};
+
+        void createImages();
+        void createRenderPass();
+        void createFramebuffer();
 
+        void createImage(vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect, vk::Image &image, VmaAllocation &allocation, vk::ImageView &view);
     };
 
 }
@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "engine/vulkan/commandrecorder.hpp"
 #include "scene/camera.hpp"
 
 namespace muon {
@@ -10,8 +11,10 @@ namespace muon {
         int32_t frame_index;
         float frame_time;
         vk::CommandBuffer command_buffer;
+        CommandRecorder &recorder;
         Camera &camera;
         vk::DescriptorSet descriptor_set;
+        uint32_t global_ubo_offset;
     };
 
 }
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <unordered_set>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "engine/vulkan/device.hpp"
+#include "engine/vulkan/buffer.hpp"
+#include "engine/vulkan/commandrecorder.hpp"
+
+namespace muon {
+
+    struct GeometryAllocation {
+        uint32_t first_index{0};
+        int32_t vertex_offset{0};
+        uint32_t index_count{0};
+        uint32_t vertex_count{0};
+    };
+
+    /**
+        *  Device local vertex and index mega-buffers shared by every model
+        *
+        *  Models sub-allocate ranges out of two free lists, so all draws bind
+        *  the same pair of buffers. When a request does not fit, live ranges
+        *  are compacted (and the buffers grown if needed) with GPU copies and
+        *  the registered allocations are patched in place.
+        *
+        *  Uploads write from the transfer queue while compaction copies on
+        *  the graphics queue, so both buffers are shared between the two.
+        *
+        *  Freed ranges go back to the free list through the deletion queue,
+        *  so they are not reused while a frame in flight still reads them.
+    */
+    class GeometryArena {
+    public:
+        static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 256 * 1024;
+        static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 1024 * 1024;
+
+        GeometryArena(Device &device, vk::DeviceSize vertex_stride,
+            uint32_t vertex_capacity = DEFAULT_VERTEX_CAPACITY, uint32_t index_capacity = DEFAULT_INDEX_CAPACITY);
+        ~GeometryArena();
+
+        GeometryArena(const GeometryArena &) = delete;
+        GeometryArena& operator=(const GeometryArena &) = delete;
+
+        void allocate(GeometryAllocation &allocation, const void *vertices, uint32_t vertex_count, const uint32_t *indices, uint32_t index_count);
+        void free(GeometryAllocation &allocation);
+        void compact();
+
+        void bind(CommandRecorder &recorder);
+
+        vk::Buffer getVertexBuffer() const { return vertex_buffer->getBuffer(); }
+        vk::Buffer getIndexBuffer() const { return index_buffer->getBuffer(); }
+        uint32_t getVertexCapacity() const { return vertex_free_list.capacity; }
+        uint32_t getIndexCapacity() const { return index_free_list.capacity; }
+
+    private:
+        /* First fit free list over element ranges, neighbours coalesce on free */
+        struct FreeList {
+            uint32_t capacity{0};
+            std::map<uint32_t, uint32_t> free_ranges{};
+
+            std::optional<uint32_t> allocate(uint32_t count);
+            void free(uint32_t offset, uint32_t count);
+            void reset(uint32_t used, uint32_t new_capacity);
+        };
+
+        Device &device;
+        vk::DeviceSize vertex_stride;
+
+        std::unique_ptr<Buffer> vertex_buffer;
+        std::unique_ptr<Buffer> index_buffer;
+        FreeList vertex_free_list{};
+        FreeList index_free_list{};
+
+        std::unordered_set<GeometryAllocation *> allocations{};
+        /* Bumped on every rebuild, deferred frees from before one are stale */
+        uint64_t generation{0};
+
+        std::unique_ptr<Buffer> createVertexBuffer(uint32_t capacity);
+        std::unique_ptr<Buffer> createIndexBuffer(uint32_t capacity);
+        void rebuild(uint32_t new_vertex_capacity, uint32_t new_index_capacity);
+    };
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace muon {
+
+    class Device;
+
+    /**
+        *  GPU time of named scopes from timestamp queries
+        *
+        *  Each frame in flight has its own query pool. A frame's results are
+        *  read back when its slot comes round again, after the renderer has
+        *  waited on that slot's fence, so the read never blocks and the
+        *  numbers are frames_in_flight frames old. Scopes are recorded on the
+        *  primary command buffer from the thread that owns the frame. Devices
+        *  whose graphics queue has no timestamp support get a profiler that
+        *  records nothing.
+    */
+    class GpuProfiler {
+    public:
+        static constexpr uint32_t MAX_SCOPES_PER_FRAME = 32;
+        /* Samples per scope behind the rolling stats */
+        static constexpr uint32_t HISTORY_SIZE = 120;
+
+        struct ScopeStats {
+            std::string name;
+            double min_ms;
+            double avg_ms;
+            double max_ms;
+        };
+
+        /* Writes a timestamp on construction and destruction, names must outlive the frame */
+        class Scope {
+        public:
+            Scope(GpuProfiler &profiler, vk::CommandBuffer command_buffer, const char *name);
+            ~Scope();
+
+            Scope(const Scope &) = delete;
+            Scope& operator=(const Scope &) = delete;
+
+        private:
+            GpuProfiler &profiler;
+            vk::CommandBuffer command_buffer;
+            uint32_t index;
+        };
+
+        GpuProfiler(Device &device, uint32_t frame_count);
+        ~GpuProfiler();
+
+        GpuProfiler(const GpuProfiler &) = delete;
+        GpuProfiler& operator=(const GpuProfiler &) = delete;
+
+        /* Call once the slot's fence has signalled, outside a render pass */
+        void beginFrame(vk::CommandBuffer command_buffer, uint32_t frame_index);
+
+        bool isEnabled() const { return enabled; }
+        /* Ordered by name */
+        std::vector<ScopeStats> getStats() const;
+
+    private:
+        static constexpr uint32_t INVALID_SCOPE = UINT32_MAX;
+
+        /* A scope owns queries 2 * i and 2 * i + 1 */
+        struct FrameQueries {
+            vk::QueryPool query_pool{};
+            std::vector<const char *> scopes{};
+        };
+
+        struct History {
+            std::array<double, HISTORY_SIZE> samples{};
+            uint32_t count{0};
+            uint32_t next{0};
+        };
+
+        Device &device;
+        bool enabled{false};
+        double timestamp_period_ns{1.0};
+        uint64_t timestamp_mask{~0ull};
+
+        std::vector<FrameQueries> frames;
+        uint32_t current_frame{0};
+        std::map<std::string, History> histories{};
+
+        uint32_t beginScope(vk::CommandBuffer command_buffer, const char *name);
+        void endScope(vk::CommandBuffer command_buffer, uint32_t index);
+        void collect(FrameQueries &frame);
+    };
+
+}
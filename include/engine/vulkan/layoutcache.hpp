@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+namespace muon {
+
+    class Device;
+
+    /**
+        *  Owns every descriptor set layout and pipeline layout on the device
+        *
+        *  Layouts are keyed by their full description, so identically defined
+        *  layouts resolve to one handle. That keeps pipelines built from the
+        *  same shaders layout compatible and bound sets undisturbed across
+        *  pipeline switches. Handles live until the device is destroyed.
+    */
+    class LayoutCache {
+    public:
+        explicit LayoutCache(Device &device) : device{device} {}
+        ~LayoutCache();
+
+        LayoutCache(const LayoutCache &) = delete;
+        LayoutCache& operator=(const LayoutCache &) = delete;
+
+        vk::DescriptorSetLayout getDescriptorSetLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings);
+        vk::PipelineLayout getPipelineLayout(const std::vector<vk::DescriptorSetLayout> &set_layouts, const std::vector<vk::PushConstantRange> &push_constant_ranges);
+
+        size_t getDescriptorSetLayoutCount() const;
+        size_t getPipelineLayoutCount() const;
+
+    private:
+        using Key = std::vector<uint64_t>;
+
+        Device &device;
+
+        mutable std::mutex mutex{};
+        std::map<Key, vk::DescriptorSetLayout> set_layouts{};
+        std::map<Key, vk::PipelineLayout> pipeline_layouts{};
+    };
+
+}
@@ -10,7 +10,7 @@
 #include <glm/glm.hpp>
 
 #include "engine/vulkan/device.hpp"
-#include "engine/vulkan/buffer.hpp"
+#include "engine/vulkan/geometryarena.hpp"
 
 namespace muon {
 
@@ -43,21 +43,16 @@ namespace muon {
 
         static std::unique_ptr<Model> fromFile(Device &device, const std::string &path);
 
-        void bind(vk::CommandBuffer command_buffer);
-        void draw(vk::CommandBuffer command_buffer);
+        /* Binds the shared geometry arena, identical for every model */
+        void bind(CommandRecorder &recorder);
+        void draw(CommandRecorder &recorder, uint32_t instance_count = 1, uint32_t first_instance = 0);
+
+        const GeometryAllocation &getGeometry() const { return geometry; }
 
     private:
         Device &device;
 
-        std::unique_ptr<Buffer> vertex_buffer;
-        uint32_t vertex_count;
-
-        bool has_index_buffer = false;
-        std::unique_ptr<Buffer> index_buffer;
-        uint32_t index_count;
-
-        void createVertexBuffer(const std::vector<Vertex> &vertices);
-        void createIndexBuffer(const std::vector<uint32_t> &indices);
+        GeometryAllocation geometry{};
     };
 
 }
@@ -28,6 +28,27 @@ namespace muon {
         vk::PipelineLayout pipeline_layout = nullptr;
         vk::RenderPass render_pass = nullptr;
         uint32_t subpass = 0;
+        /* Used instead of the render pass when it is null, for dynamic rendering */
+        std::vector<vk::Format> colour_attachment_formats;
+        vk::Format depth_attachment_format = vk::Format::eUndefined;
+    };
+
+    /*
+        What pipelines for a target are built against: its render pass, or with
+        dynamic rendering only its attachment formats, which survive a resize
+    */
+    struct PipelineTarget {
+        vk::RenderPass render_pass = nullptr;
+        uint32_t subpass = 0;
+        std::vector<vk::Format> colour_attachment_formats{};
+        vk::Format depth_attachment_format = vk::Format::eUndefined;
+
+        void apply(PipelineConfigInfo &config_info) const {
+            config_info.render_pass = render_pass;
+            config_info.subpass = subpass;
+            config_info.colour_attachment_formats = colour_attachment_formats;
+            config_info.depth_attachment_format = depth_attachment_format;
+        }
     };
 
     struct DescriptorSetLayoutData {
@@ -44,6 +65,7 @@ namespace muon {
         Pipeline& operator=(const Pipeline&) = delete;
 
         void bind(vk::CommandBuffer command_buffer);
+        vk::Pipeline getPipeline() const { return graphics_pipeline; }
 
         static void defaultPipelineConfigInfo(PipelineConfigInfo &config_info);
     private:
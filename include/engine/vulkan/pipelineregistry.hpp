@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <vulkan/vulkan.hpp>
+
+#include "engine/vulkan/device.hpp"
+#include "engine/vulkan/pipeline.hpp"
+#include "utils/threadpool.hpp"
+
+namespace muon {
+
+    class PipelineRegistry;
+
+    /**
+        *  Shared reference to a pipeline that may still be compiling
+        *
+        *  get() never blocks and returns nullptr until the pipeline is
+        *  ready, so draws can be skipped instead of stalling the frame.
+    */
+    class PipelineHandle {
+    public:
+        PipelineHandle() = default;
+
+        bool isValid() const { return entry != nullptr; }
+        bool isReady() const { return entry && entry->ready.load(std::memory_order_acquire); }
+        const Pipeline *get() const { return isReady() ? entry->pipeline.get() : nullptr; }
+        void wait() const { if (entry) { entry->done.wait(); } }
+
+    private:
+        friend class PipelineRegistry;
+
+        struct Entry {
+            std::string vert_path;
+            std::string frag_path;
+            PipelineConfigInfo config{};
+            std::unique_ptr<Pipeline> pipeline;
+            std::atomic<bool> ready{false};
+            std::shared_future<void> done;
+        };
+
+        std::shared_ptr<Entry> entry;
+
+        explicit PipelineHandle(std::shared_ptr<Entry> entry) : entry{std::move(entry)} {}
+    };
+
+    /**
+        *  Deduplicates and asynchronously compiles graphics pipelines
+        *
+        *  Pipelines are keyed by their shader paths and fixed function state,
+        *  so systems asking for the same combination share one pipeline.
+        *  Compilation runs on a pool of its own, a long compile never holds up
+        *  per frame work queued on the renderer's pool.
+    */
+    class PipelineRegistry {
+    public:
+        explicit PipelineRegistry(Device &device);
+        ~PipelineRegistry();
+
+        PipelineRegistry(const PipelineRegistry &) = delete;
+        PipelineRegistry& operator=(const PipelineRegistry &) = delete;
+
+        PipelineHandle request(const std::string &vert_path, const std::string &frag_path, const PipelineConfigInfo &config_info);
+
+        /* Blocks until every requested pipeline has compiled */
+        void waitIdle();
+
+        size_t size() const;
+
+    private:
+        Device &device;
+        ThreadPool compile_pool;
+
+        /* Hashes the whole key, equal hashes still compare every byte so colliding pipelines stay apart */
+        struct KeyHash {
+            size_t operator()(const std::string &key) const;
+        };
+
+        mutable std::mutex mutex{};
+        /* Keyed by the shader paths and every hashed field of the config, serialised */
+        std::unordered_map<std::string, std::shared_ptr<PipelineHandle::Entry>, KeyHash> entries{};
+
+        static std::string pipelineKey(const std::string &vert_path, const std::string &frag_path, const PipelineConfigInfo &config_info);
+    };
+
+}
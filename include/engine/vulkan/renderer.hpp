@@ -1,19 +1,47 @@
 #pragma once
 
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
 
 #include "engine/window/window.hpp"
+#include "engine/vulkan/commandrecorder.hpp"
+#include "engine/vulkan/descriptorallocator.hpp"
+#include "engine/vulkan/descriptorcache.hpp"
 #include "engine/vulkan/device.hpp"
+#include "engine/vulkan/frameallocator.hpp"
+#include "engine/vulkan/framebuffer.hpp"
+#include "engine/vulkan/gpuprofiler.hpp"
+#include "engine/vulkan/pipeline.hpp"
 #include "engine/vulkan/swapchain.hpp"
+#include "utils/defaults.hpp"
+#include "utils/framelimiter.hpp"
+#include "utils/threadpool.hpp"
 
 namespace muon {
 
+    struct RendererProperties {
+        /* Preferred, the swapchain falls back to FIFO. Ignored when headless */
+        vk::PresentModeKHR present_mode{vk::PresentModeKHR::eFifo};
+        /* 1 to Swapchain::MAX_FRAMES_IN_FLIGHT, more hides CPU spikes at the cost of latency */
+        uint32_t frames_in_flight{defaults::renderer::FRAMES_IN_FLIGHT};
+        /* Paces beginFrame for the uncapped present modes, 0 disables */
+        uint32_t max_fps{defaults::renderer::MAX_FPS};
+        /* Below this many draws the fork and join costs more than recording inline, measure with --stress-draws */
+        uint32_t parallel_record_threshold{defaults::renderer::PARALLEL_RECORD_THRESHOLD};
+    };
+
     class Renderer {
     public:
-        Renderer(Window &window, Device &device);
+        static constexpr vk::DeviceSize FRAME_ALLOCATOR_SIZE = 4 * 1024 * 1024;
+        static constexpr uint32_t MIN_DRAWS_PER_SLICE = 256;
+
+        Renderer(Window &window, Device &device, const RendererProperties &properties = {});
+        /* Headless, frames render into an offscreen target of the given size and are never presented */
+        Renderer(Device &device, vk::Extent2D extent, const RendererProperties &properties = {});
         ~Renderer();
 
         Renderer(const Renderer &) = delete;
@@ -22,33 +50,122 @@ namespace muon {
         vk::CommandBuffer beginFrame();
         void endFrame();
 
-        void beginSwapchainRenderPass(vk::CommandBuffer command_buffer);
+        /*
+            Begins rendering to the current swapchain image, or the offscreen target
+            when headless. With dynamic rendering this records the attachment layout
+            transitions and vkCmdBeginRenderingKHR instead of beginning a render pass.
+        */
+        void beginSwapchainRenderPass(vk::CommandBuffer command_buffer, vk::SubpassContents contents = vk::SubpassContents::eInline);
         void endSwapchainRenderPass(vk::CommandBuffer command_buffer);
 
-        vk::RenderPass getSwapchainRenderPass() const { return swapchain->getRenderPass(); }
+        /*
+            Splits draw_count draws into slices recorded into secondary command buffers
+            on the thread pool, then executes them. The render pass must have been
+            begun with eSecondaryCommandBuffers. Called at most once per frame, the
+            slice pools are recycled on entry.
+        */
+        using RecordFunction = std::function<void(CommandRecorder &recorder, uint32_t begin, uint32_t end)>;
+        void recordParallel(uint32_t draw_count, const RecordFunction &record);
+        bool shouldRecordParallel(uint32_t draw_count) const { return draw_count >= properties.parallel_record_threshold && thread_pool->getThreadCount() > 0; }
+        uint32_t getParallelRecordThreshold() const { return properties.parallel_record_threshold; }
+
+        /* Null with dynamic rendering, build pipelines from getPipelineTarget() instead */
+        vk::RenderPass getSwapchainRenderPass() const { return swapchain ? swapchain->getRenderPass() : offscreen_target->getRenderPass(); }
+        PipelineTarget getPipelineTarget() const;
+        bool usesDynamicRendering() const { return device.hasDynamicRendering(); }
         vk::CommandBuffer getCurrentCommandBuffer() const { return command_buffers[current_frame_index]; }
+        CommandRecorder &getCommandRecorder() { return command_recorders[current_frame_index]; }
+        /* Bind counters of the last frame submitted, for overlays */
+        const CommandRecorder::Stats &getLastFrameStats() const { return last_frame_stats; }
         void setClearColor(vk::ClearColorValue new_color) { clear_color = new_color; }
         void setClearDepthStencil(vk::ClearDepthStencilValue new_depth) { clear_depth_stencil = new_depth; }
         int32_t getFrameIndex() const { return current_frame_index; }
+        uint32_t getFramesInFlight() const { return properties.frames_in_flight; }
+        /* CPU time the last submitted frame spent blocked in waitForFences */
+        std::chrono::nanoseconds getLastFenceWait() const { return last_fence_wait; }
         bool isFrameInProgress() const { return frame_in_progress; }
-        float getAspectRatio() const { return swapchain->extentAspectRatio(); }
+        vk::Extent2D getExtent() const { return swapchain ? swapchain->getSwapchainExtent() : offscreen_target->getExtent(); }
+        float getAspectRatio() const { return swapchain ? swapchain->extentAspectRatio() : offscreen_target->extentAspectRatio(); }
+        bool isHeadless() const { return window == nullptr; }
+        FrameAllocator &getFrameAllocator() const { return *frame_allocator; }
+        DescriptorAllocator &getDescriptorAllocator() const { return *descriptor_allocator; }
+        DescriptorCache &getDescriptorCache() const { return *descriptor_cache; }
+        GpuProfiler &getGpuProfiler() const { return *gpu_profiler; }
+        ThreadPool &getThreadPool() const { return *thread_pool; }
 
     private:
-        Window &window;
+        struct Attachments {
+            vk::Image colour_image;
+            vk::ImageView colour_view;
+            vk::Format colour_format;
+            vk::Image depth_image;
+            vk::ImageView depth_view;
+            vk::Format depth_format;
+        };
+
+        /* One transient pool per recording slice per frame in flight, never shared between threads */
+        struct WorkerFrame {
+            vk::CommandPool command_pool{};
+            vk::CommandBuffer command_buffer{};
+            CommandRecorder recorder{};
+        };
+
+        Window *window{nullptr};
         Device &device;
+        RendererProperties properties;
+        FrameLimiter frame_limiter;
         std::unique_ptr<Swapchain> swapchain;
+        /* Headless only */
+        std::unique_ptr<Framebuffer> offscreen_target;
+
+        /* Per frame in flight, indexed by current_frame_index, they outlive swapchain recreation */
+        std::vector<vk::Fence> in_flight_fences;
+        std::vector<vk::Semaphore> image_available_semaphores;
+        std::vector<vk::Semaphore> render_finished_semaphores;
+        /* Per swapchain image, the fence of the slot that last rendered to it */
+        std::vector<vk::Fence> images_in_flight;
         std::vector<vk::CommandBuffer> command_buffers;
+        std::vector<CommandRecorder> command_recorders;
+        CommandRecorder::Stats last_frame_stats{};
+        CommandRecorder::Stats secondary_stats{};
+        std::chrono::nanoseconds fence_wait{0};
+        std::chrono::nanoseconds last_fence_wait{0};
+
+        std::unique_ptr<ThreadPool> thread_pool;
+        std::vector<std::vector<WorkerFrame>> worker_frames;
+        std::unique_ptr<FrameAllocator> frame_allocator;
+        std::unique_ptr<DescriptorAllocator> descriptor_allocator;
+        std::unique_ptr<DescriptorCache> descriptor_cache;
+        std::unique_ptr<GpuProfiler> gpu_profiler;
 
         vk::ClearColorValue clear_color{0.0f, 0.0f, 0.0f, 1.0f};
         vk::ClearDepthStencilValue clear_depth_stencil{1.0f, 0};
 
+        /* Kept from the render pass begin for secondaries, which do not inherit dynamic state */
+        vk::Viewport viewport{};
+        vk::Rect2D scissor{};
+
         uint32_t current_image_index{};
         int32_t current_frame_index{0};
+        /* Monotonic count of frames begun, tags deferred deletions */
+        uint64_t frame_count{0};
         bool frame_in_progress{false};
 
+        void validateProperties();
+        void init();
         void createCommandBuffers();
         void freeCommandBuffers();
+        void createWorkerFrames();
+        void destroyWorkerFrames();
         void recreateSwapchain();
+        void createSyncObjects();
+        void destroySyncObjects();
+        std::chrono::nanoseconds waitForFence(vk::Fence fence);
+        void submitFrame(vk::CommandBuffer command_buffer);
+        vk::Framebuffer getCurrentFramebuffer() const;
+        Attachments getCurrentAttachments() const;
+        void beginDynamicRendering(vk::CommandBuffer command_buffer, vk::SubpassContents contents);
+        void endDynamicRendering(vk::CommandBuffer command_buffer);
     };
 
 }
@@ -1,13 +1,20 @@
 #pragma once
 
 #include <cstdint>
+#include <string>
 #include <vector>
 
 #include <vulkan/vulkan.hpp>
-#include <spirv_reflect.h>
 
 namespace muon {
 
+    /**
+        *  Interface of a SPIR-V module: vertex inputs, descriptor bindings,
+        *  push constant ranges and specialization constants
+        *
+        *  The description is cached beside the .spv as a .refl file keyed by
+        *  a hash of the SPIR-V, so unchanged shaders skip SPIRV-Reflect.
+    */
     class ShaderReflection {
     public:
         struct VertexInfo {
@@ -15,18 +22,41 @@ namespace muon {
             std::vector<vk::VertexInputBindingDescription> binding_descriptions{};
         };
 
-        ShaderReflection(std::vector<char> &data);
-        ~ShaderReflection();
+        struct DescriptorBinding {
+            uint32_t set;
+            uint32_t binding;
+            vk::DescriptorType descriptor_type;
+            uint32_t count;
+        };
 
-        void computeVertexInfo();
-        void computeDescriptorSetLayout();
+        struct SpecializationConstant {
+            uint32_t constant_id;
+        };
 
-        VertexInfo getVertexInfo() { return vertex_info; }
+        ShaderReflection(const std::string &spv_path, const std::vector<char> &data);
+        explicit ShaderReflection(const std::string &spv_path);
 
-    private:
-        SpvReflectShaderModule module;
+        vk::ShaderStageFlagBits getStage() const { return stage; }
+        const VertexInfo &getVertexInfo() const { return vertex_info; }
+        const std::vector<DescriptorBinding> &getDescriptorBindings() const { return descriptor_bindings; }
+        const std::vector<vk::PushConstantRange> &getPushConstantRanges() const { return push_constant_ranges; }
+        const std::vector<SpecializationConstant> &getSpecializationConstants() const { return specialization_constants; }
 
-        VertexInfo vertex_info;
+        /* Union of one set's bindings across the stages of a pipeline, stage flags combined */
+        static std::vector<vk::DescriptorSetLayoutBinding> mergeSetBindings(const std::vector<const ShaderReflection *> &shaders, uint32_t set);
+        static std::vector<vk::PushConstantRange> mergePushConstantRanges(const std::vector<const ShaderReflection *> &shaders);
+
+    private:
+        vk::ShaderStageFlagBits stage{};
+        VertexInfo vertex_info{};
+        std::vector<DescriptorBinding> descriptor_bindings{};
+        std::vector<vk::PushConstantRange> push_constant_ranges{};
+        std::vector<SpecializationConstant> specialization_constants{};
+
+        void load(const std::string &spv_path, const std::vector<char> &data);
+        void reflect(const std::vector<char> &data);
+        bool readCache(const std::string &cache_path, uint64_t spirv_hash);
+        void writeCache(const std::string &cache_path, uint64_t spirv_hash) const;
     };
 
 }
@@ -9,12 +9,21 @@
 
 namespace muon {
 
+    /**
+        *  Presentable images with their depth buffers, views and framebuffers
+        *
+        *  Holds no per-frame synchronisation, the renderer owns that so it
+        *  survives recreation. A replaced swapchain is passed to its successor
+        *  as oldSwapchain and has to outlive the frames that rendered to it.
+    */
     class Swapchain {
     public:
-        static constexpr int32_t MAX_FRAMES_IN_FLIGHT = 2;
+        /* Upper bound for the configured frames in flight */
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
 
-        Swapchain(Device &device, vk::Extent2D window_extent);
-        Swapchain(Device &device, vk::Extent2D window_extent, std::shared_ptr<Swapchain> previous);
+        /* present_mode is a preference, FIFO is used when the surface does not support it */
+        Swapchain(Device &device, vk::Extent2D window_extent, vk::PresentModeKHR present_mode);
+        Swapchain(Device &device, vk::Extent2D window_extent, vk::PresentModeKHR present_mode, std::shared_ptr<Swapchain> previous);
         ~Swapchain();
 
         Swapchain(const Swapchain &) = delete;
@@ -22,17 +31,24 @@ namespace muon {
 
         vk::Framebuffer getFramebuffer(int index) { return swapchain_framebuffers[index]; }
         vk::RenderPass getRenderPass() { return render_pass; }
+        vk::Image getImage(int index) { return swapchain_images[index]; }
         vk::ImageView getImageView(int index) { return swapchain_image_views[index]; }
+        vk::Image getDepthImage(int index) { return depth_images[index]; }
+        vk::ImageView getDepthImageView(int index) { return depth_image_views[index]; }
         size_t getImageCount() { return swapchain_images.size(); }
         vk::Format getSwapchainImageFormat() { return swapchain_image_format; }
+        vk::Format getSwapchainDepthFormat() { return swapchain_depth_format; }
         vk::Extent2D getSwapchainExtent() { return swapchain_extent; }
         uint32_t getWidth() { return swapchain_extent.width; }
         uint32_t getHeight() { return swapchain_extent.height; }
         float extentAspectRatio() { return static_cast<float>(swapchain_extent.width) / static_cast<float>(swapchain_extent.height); }
+        vk::PresentModeKHR getPresentMode() const { return present_mode; }
 
         vk::Format findDepthFormat();
-        vk::Result acquireNextImage(uint32_t *image_index);
-        vk::Result submitCommandBuffers(const vk::CommandBuffer *buffers, uint32_t *image_index);
+        /* Signals image_available once the image can be rendered to */
+        vk::Result acquireNextImage(vk::Semaphore image_available, uint32_t *image_index);
+        /* Queues the image for presentation once render_finished signals */
+        vk::Result present(vk::Semaphore render_finished, uint32_t image_index);
         bool compareSwapFormats(const Swapchain &swapchain) const;
 
     private:
@@ -44,30 +60,25 @@ namespace muon {
         vk::RenderPass render_pass;
 
         std::vector<vk::Image> depth_images;
-        std::vector<vk::DeviceMemory> depth_image_memories;
+        std::vector<VmaAllocation> depth_image_allocations;
         std::vector<vk::ImageView> depth_image_views;
         std::vector<vk::Image> swapchain_images;
         std::vector<vk::ImageView> swapchain_image_views;
 
         Device &device;
         vk::Extent2D window_extent;
+        vk::PresentModeKHR preferred_present_mode;
+        vk::PresentModeKHR present_mode{vk::PresentModeKHR::eFifo};
 
         vk::SwapchainKHR swapchain;
         std::shared_ptr<Swapchain> old_swapchain;
 
-        std::vector<vk::Semaphore> image_available_semaphores;
-        std::vector<vk::Semaphore> render_finished_semaphores;
-        std::vector<vk::Fence> in_flight_fences;
-        std::vector<vk::Fence> images_in_flight;
-        size_t current_frame = 0;
-
         void init();
         void createSwapchain();
         void createImageViews();
         void createDepthResources();
         void createRenderPass();
         void createFramebuffers();
-        void createSyncObjects();
 
         vk::SurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR> &available_formats);
         vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &available_present_modes);
@@ -4,6 +4,7 @@
 
 #include <vulkan/vulkan.hpp>
 
+#include "engine/vulkan/bindlesstable.hpp"
 #include "engine/vulkan/device.hpp"
 
 namespace muon {
@@ -33,6 +34,8 @@ namespace muon {
         vk::ImageLayout getImageLayout() const { return image_layout; }
 
         vk::DescriptorImageInfo descriptorInfo() const;
+        /* Slot in the device's bindless table, passed to shaders in per-draw data */
+        uint32_t getBindlessIndex() const { return bindless_index; }
 
     private:
         Device &device;
@@ -41,16 +44,15 @@ namespace muon {
         uint32_t height;
 
         vk::Image image;
-        vk::DeviceMemory image_memory;
+        VmaAllocation image_allocation;
         vk::Sampler sampler;
         vk::ImageView image_view;
         vk::ImageLayout image_layout;
         vk::Format image_format;
         uint32_t instance_size;
+        uint32_t bindless_index{BindlessTable::INVALID_INDEX};
 
         void createTexture(void *image_data);
-
-        void transitionImageLayout(vk::ImageLayout old_layout, vk::ImageLayout new_layout);
     };
 
 }
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+
+#include "engine/vulkan/device.hpp"
+
+namespace muon {
+
+    class Buffer;
+
+    using UploadToken = uint64_t;
+
+    /**
+        *  Batches buffer and image uploads into a single command buffer
+        *
+        *  Uploads are staged into pooled host visible blocks and recorded
+        *  until submit() is called, which happens once per frame. The returned
+        *  token can be polled or waited on to know when the data has landed.
+        *
+        *  When the device has a separate transfer queue the copies run there,
+        *  overlapping with rendering, and a small graphics command buffer
+        *  acquires ownership of the resources before the frame uses them.
+        *  Shared buffers skip the ownership transfer, the semaphore alone
+        *  orders the copies before the graphics queue reads them.
+    */
+    class UploadQueue {
+    public:
+        static constexpr vk::DeviceSize STAGING_BLOCK_SIZE = 8 * 1024 * 1024;
+
+        UploadQueue(Device &device);
+        ~UploadQueue();
+
+        UploadQueue(const UploadQueue &) = delete;
+        UploadQueue& operator=(const UploadQueue &) = delete;
+
+        UploadToken uploadBuffer(Buffer &dst_buffer, const void *data, vk::DeviceSize size, vk::DeviceSize dst_offset = 0);
+        UploadToken uploadImage(vk::Image image, const void *data, uint32_t width, uint32_t height, uint32_t texel_size, uint32_t layer_count = 1);
+        UploadToken copyBuffer(vk::Buffer src_buffer, vk::Buffer dst_buffer, const std::vector<vk::BufferCopy> &regions);
+
+        UploadToken submit();
+        bool isComplete(UploadToken token);
+        void wait(UploadToken token);
+
+    private:
+        struct StagingBlock {
+            std::unique_ptr<Buffer> buffer;
+            vk::DeviceSize used{0};
+        };
+
+        struct StagingAllocation {
+            vk::Buffer buffer;
+            vk::DeviceSize offset;
+            void *mapped;
+        };
+
+        struct Batch {
+            UploadToken token{0};
+            /* Graphics queue, records the copies or only the acquire barriers */
+            vk::CommandBuffer command_buffer{};
+            vk::CommandBuffer transfer_command_buffer{};
+            vk::Semaphore transfer_semaphore{};
+            vk::Fence fence{};
+            std::vector<StagingBlock> staging_blocks{};
+        };
+
+        Device &device;
+        vk::CommandPool command_pool{};
+
+        bool use_transfer_queue{false};
+        uint32_t graphics_family{};
+        uint32_t transfer_family{};
+
+        Batch recording{};
+        bool is_recording{false};
+        bool has_buffer_uploads{false};
+        bool has_graphics_copies{false};
+        std::vector<vk::ImageMemoryBarrier> pending_image_barriers{};
+        std::vector<vk::BufferMemoryBarrier> pending_buffer_barriers{};
+
+        std::deque<Batch> in_flight{};
+        std::vector<Batch> free_batches{};
+        std::vector<StagingBlock> free_blocks{};
+
+        UploadToken next_token{1};
+        UploadToken completed_token{0};
+
+        void createCommandPool();
+        void beginBatch();
+        void destroyBatch(Batch &batch);
+        void collect();
+        vk::CommandBuffer copyCommandBuffer() const;
+        bool transfersOwnership() const { return use_transfer_queue && transfer_family != graphics_family; }
+        StagingAllocation stage(const void *data, vk::DeviceSize size, vk::DeviceSize alignment);
+    };
+
+}
@@ -1,8 +1,8 @@
 #pragma once
 
-#include <memory>
 #include <glm/glm.hpp>
 
+#include "engine/assets/handle.hpp"
 #include "engine/vulkan/model.hpp"
 #include "engine/vulkan/texture.hpp"
 
@@ -13,11 +13,11 @@ namespace muon {
     };
 
     struct ModelComponent {
-        std::weak_ptr<Model> model;
+        Handle<Model> model;
     };
 
     struct TextureComponent {
-        std::weak_ptr<Texture> texture;
+        Handle<Texture> texture;
     };
 
 }
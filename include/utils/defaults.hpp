@@ -15,6 +15,34 @@ namespace muon {
 
         }
 
+        namespace renderer {
+
+            constexpr uint32_t FRAMES_IN_FLIGHT = 2;
+            /* 0 leaves the frame rate uncapped */
+            constexpr uint32_t MAX_FPS = 0;
+            /*
+                Draws at which recording moves to the thread pool, the smallest split is two full slices.
+                Not measured yet. Replace with the point where --headless 600 --stress-draws N
+                reports a speedup above 1, and note the inline and parallel times here.
+            */
+            constexpr uint32_t PARALLEL_RECORD_THRESHOLD = 512;
+
+        }
+
+        namespace profiler {
+
+            constexpr const char *TRACE_PATH = "trace.json";
+            /* Frames written by a trace dump */
+            constexpr uint32_t TRACE_FRAMES = 120;
+
+        }
+
+        namespace pipeline_cache {
+
+            constexpr const char *PATH = "pipeline_cache.bin";
+
+        }
+
     }
 
 }
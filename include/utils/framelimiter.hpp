@@ -0,0 +1,42 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace muon {
+
+    /**
+        *  Paces frames to a fixed rate without relying on the present mode
+        *
+        *  wait() sleeps for the bulk of the remaining frame time and spins
+        *  the last stretch, since the scheduler routinely oversleeps by a
+        *  millisecond or more. The spin margin tracks the observed sleep
+        *  accuracy. A frame that runs late starts a new cadence instead of
+        *  rushing the following frames to catch up.
+    */
+    class FrameLimiter {
+    public:
+        explicit FrameLimiter(uint32_t max_fps = 0);
+
+        /* 0 disables the limiter */
+        void setMaxFps(uint32_t max_fps);
+        bool isEnabled() const { return frame_period.count() > 0; }
+
+        void wait();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        std::chrono::nanoseconds frame_period{0};
+        Clock::time_point next_frame{};
+
+        /* Running mean and variance of how long a 1 ms sleep actually takes */
+        double sleep_mean_ns{1.5e6};
+        double sleep_m2{0.0};
+        uint64_t sleep_samples{1};
+
+        void sleepUntil(Clock::time_point deadline);
+        double sleepEstimate() const;
+    };
+
+}
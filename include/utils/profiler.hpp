@@ -0,0 +1,61 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+    *  CPU zones, compiled in with MUON_PROFILE
+    *
+    *  A zone records its name and start and end times into a ring buffer
+    *  owned by the calling thread, so recording takes no locks. Frame marks
+    *  let writeTrace() export the last N frames as Chrome trace_event JSON,
+    *  loadable in chrome://tracing or Perfetto. Without MUON_PROFILE the
+    *  macros expand to nothing.
+*/
+#ifdef MUON_PROFILE
+    #define MUON_PROFILE_CONCAT_IMPL(a, b) a##b
+    #define MUON_PROFILE_CONCAT(a, b) MUON_PROFILE_CONCAT_IMPL(a, b)
+    /* Names must be string literals or otherwise outlive the trace */
+    #define MUON_PROFILE_SCOPE(name) const ::muon::profiler::Zone MUON_PROFILE_CONCAT(muon_profile_zone_, __LINE__){name}
+    #define MUON_PROFILE_FRAME() ::muon::profiler::markFrame()
+    #define MUON_PROFILE_THREAD(name) ::muon::profiler::setThreadName(name)
+#else
+    #define MUON_PROFILE_SCOPE(name) ((void)0)
+    #define MUON_PROFILE_FRAME() ((void)0)
+    #define MUON_PROFILE_THREAD(name) ((void)0)
+#endif
+
+namespace muon::profiler {
+
+#ifdef MUON_PROFILE
+    constexpr bool ENABLED = true;
+#else
+    constexpr bool ENABLED = false;
+#endif
+
+    inline uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void record(const char *name, uint64_t start_ns, uint64_t end_ns);
+    void markFrame();
+    void setThreadName(const std::string &name);
+
+    /* Call between frames, while no other thread is recording */
+    bool writeTrace(const std::string &path, uint32_t frame_count);
+
+    class Zone {
+    public:
+        explicit Zone(const char *name) : name{name}, start_ns{now()} {}
+        ~Zone() { record(name, start_ns, now()); }
+
+        Zone(const Zone &) = delete;
+        Zone& operator=(const Zone &) = delete;
+
+    private:
+        const char *name;
+        uint64_t start_ns;
+    };
+
+}
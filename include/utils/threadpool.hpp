@@ -0,0 +1,61 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace muon {
+
+    /**
+        *  Fixed set of worker threads pulling tasks from a shared queue
+        *
+        *  submit() returns a future for the task's result. Tasks must not
+        *  block on other tasks in the same pool.
+    */
+    class ThreadPool {
+    public:
+        explicit ThreadPool(uint32_t thread_count = defaultThreadCount());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool& operator=(const ThreadPool &) = delete;
+
+        template <typename Func>
+        auto submit(Func &&func) -> std::future<std::invoke_result_t<Func>> {
+            using Result = std::invoke_result_t<Func>;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+            auto future = task->get_future();
+
+            {
+                std::lock_guard lock{mutex};
+                tasks.emplace([task]() { (*task)(); });
+            }
+            condition.notify_one();
+
+            return future;
+        }
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+        /* Leaves one hardware thread for the caller */
+        static uint32_t defaultThreadCount();
+
+    private:
+        std::vector<std::thread> workers{};
+        std::queue<std::function<void()>> tasks{};
+        std::mutex mutex{};
+        std::condition_variable condition{};
+        bool stopping{false};
+
+        void workerLoop();
+    };
+
+}
@@ -1,7 +1,11 @@
 #include "app.hpp"
 
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <limits>
 #include <memory>
+#include <vector>
 
 #include <spdlog/spdlog.h>
 #include <vulkan/vulkan.hpp>
@@ -9,158 +13,75 @@
 #include <glm/ext/matrix_transform.hpp>
 #include <SDL3/SDL_scancode.h>
 
-#include "engine/vulkan/buffer.hpp"
+#include "engine/vulkan/frameallocator.hpp"
 #include "engine/vulkan/descriptors.hpp"
 #include "engine/vulkan/frameinfo.hpp"
+#include "engine/vulkan/gpuprofiler.hpp"
 #include "engine/vulkan/model.hpp"
 #include "engine/vulkan/swapchain.hpp"
 #include "engine/vulkan/texture.hpp"
 #include "engine/rendering/rendersystem.hpp"
+#include "engine/rendering/textrenderer.hpp"
 #include "engine/vulkan/font.hpp"
 
 #include "scene/camera.hpp"
+#include "scene/components.hpp"
 #include "input/inputmanager.hpp"
 #include "utils/color.hpp"
+#include "utils/defaults.hpp"
+#include "utils/profiler.hpp"
 
 #include "entt.hpp"
 
 namespace muon {
 
-    struct GlobalUbo {
-        glm::mat4 projection{1.0f};
-        glm::mat4 view{1.0f};
-    };
-
-    std::unique_ptr<Model> generateText(Device &device, Font &font, std::string &text) {
-        const auto &font_geometry = font.getFontGeometry();
-        const auto &metrics = font_geometry.getMetrics();
-
-        auto atlas = font.getAtlas();
-
-        double x = 0.0;
-        double y = 0.0;
-        double fs_scale = 1.0 / (metrics.ascenderY - metrics.descenderY);
+    /* Glyph slots per overlay label, longer text is cut off */
+    constexpr uint32_t OVERLAY_LINE_GLYPHS = 64;
+    constexpr uint32_t OVERLAY_GPU_GLYPHS = 512;
 
-        const float space_glyph_advance = font_geometry.getGlyph(' ')->getAdvance();
+    namespace {
 
-        std::vector<Model::Vertex> vertices{};
-        std::vector<uint32_t> indices{};
-        uint32_t index_count{0};
+        /* Stress cubes per row, they fill the view as a grid */
+        constexpr uint32_t STRESS_GRID_WIDTH = 64;
 
-        for (size_t i = 0; i < text.size(); i++) {
-            char c = text[i];
-            if (c == '\r') {
-                continue;
-            }
-
-            if (c == '\n') {
-                x = 0;
-                y -= fs_scale * metrics.lineHeight;
-                continue;
-            }
-
-            if (c == ' ') {
-                float advance = space_glyph_advance;
-                if (i < text.size() - 1) {
-                    char next_c = text[i + 1];
-                    double d_advance;
-                    font_geometry.getAdvance(d_advance, c, next_c);
-                    advance = (float)d_advance;
-                }
+        std::vector<glm::mat4> makeStressTransforms(uint32_t count) {
+            std::vector<glm::mat4> transforms{};
+            transforms.reserve(count);
 
-                x += fs_scale * advance;
-                continue;
-            }
+            const float spacing = 2.0f / STRESS_GRID_WIDTH;
+            for (uint32_t i = 0; i < count; i++) {
+                const float x = -1.0f + spacing * (static_cast<float>(i % STRESS_GRID_WIDTH) + 0.5f);
+                const float y = -1.0f + spacing * (static_cast<float>(i / STRESS_GRID_WIDTH % STRESS_GRID_WIDTH) + 0.5f);
 
-            auto glyph = font_geometry.getGlyph(c);
-            if (!glyph) {
-                glyph = font_geometry.getGlyph('?');
-            }
-            if (!glyph) {
-                return nullptr;
+                glm::mat4 transform = glm::translate(glm::mat4{1.0f}, {x, y, -5.0f});
+                transforms.push_back(glm::scale(transform, glm::vec3{spacing * 0.25f}));
             }
 
-            double al, ab, ar, at;
-            glyph->getQuadAtlasBounds(al, ab, ar, at);
-            glm::vec2 tex_coord_min{(float)al, (float)ab};
-            glm::vec2 tex_coord_max{(float)ar, (float)at};
-
-            double pl, pb, pr, pt;
-            glyph->getQuadPlaneBounds(pl, pb, pr, pt);
-            glm::vec2 quad_min{(float)pl, (float)pb};
-            glm::vec2 quad_max{(float)pr, (float)pt};
-
-            quad_min *= fs_scale;
-            quad_max *= fs_scale;
-            quad_min += glm::vec2(x, y);
-            quad_max += glm::vec2(x, y);
-
-            /* Flip the Y for Vulkan! */
-            quad_min.y = -quad_min.y;
-            quad_max.y = -quad_max.y;
-
-            float texel_width = 1.0f / atlas->getWidth();
-            float texel_height = 1.0f / atlas->getHeight();
-            tex_coord_min *= glm::vec2{texel_width, texel_height};
-            tex_coord_max *= glm::vec2{texel_width, texel_height};
-
-            vertices.push_back({ // Top left
-                glm::vec3{quad_min.x, quad_max.y, 0.0f},
-                glm::vec3{1.0f, 1.0f, 1.0f},
-                glm::vec3{0.0f, 0.0f, 0.0f},
-                glm::vec2{tex_coord_min.x, tex_coord_max.y},
-            });
-
-            vertices.push_back({ // Bottom left
-                glm::vec3{quad_min, 0.0f},
-                glm::vec3{1.0f, 1.0f, 1.0f},
-                glm::vec3{0.0f, 0.0f, 0.0f},
-                glm::vec2{tex_coord_min.x, tex_coord_min.y},
-            });
-
-            vertices.push_back({ // Bottom right
-                glm::vec3{quad_max.x, quad_min.y, 0.0f},
-                glm::vec3{1.0f, 1.0f, 1.0f},
-                glm::vec3{0.0f, 0.0f, 0.0f},
-                glm::vec2{tex_coord_max.x, tex_coord_min.y},
-            });
-
-            vertices.push_back({ // Top right
-                glm::vec3{quad_max, 0.0f},
-                glm::vec3{1.0f, 1.0f, 1.0f},
-                glm::vec3{0.0f, 0.0f, 0.0f},
-                glm::vec2{tex_coord_max.x, tex_coord_max.y},
-            });
-
-            indices.push_back(index_count + 0);
-            indices.push_back(index_count + 1);
-            indices.push_back(index_count + 2);
-            indices.push_back(index_count + 2);
-            indices.push_back(index_count + 3);
-            indices.push_back(index_count + 0);
-
-            index_count += 4;
-
-            if (i < text.size() - 1) {
-                double advance = glyph->getAdvance();
-                char next_c = text[i + 1];
-                font_geometry.getAdvance(advance, c, next_c);
-                x += fs_scale * advance;
-            }
+            return transforms;
         }
 
-        Model::Builder builder{vertices, indices};
-        return std::make_unique<Model>(device, builder);
     }
 
-    App::App(WindowProperties &properties) : properties{properties} {
+    struct GlobalUbo {
+        glm::mat4 projection{1.0f};
+        glm::mat4 view{1.0f};
+    };
+
+    App::App(WindowProperties &properties, const RendererProperties &renderer_properties, uint32_t headless_frames, uint32_t stress_draws)
+        : properties{properties}, headless_frames{headless_frames}, stress_draws{stress_draws} {
         spdlog::info("Starting up");
 
-        global_pool = DescriptorPool::Builder(device)
-            .setMaxSets(Swapchain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(vk::DescriptorType::eUniformBuffer, Swapchain::MAX_FRAMES_IN_FLIGHT)
-            .addPoolSize(vk::DescriptorType::eCombinedImageSampler, Swapchain::MAX_FRAMES_IN_FLIGHT)
-            .build();
+        if (isHeadless()) {
+            spdlog::info("Running headless for {} frames", headless_frames);
+            device = std::make_unique<Device>();
+            renderer = std::make_unique<Renderer>(*device, vk::Extent2D{this->properties.width, this->properties.height}, renderer_properties);
+        } else {
+            window = std::make_unique<Window>(this->properties);
+            device = std::make_unique<Device>(*window);
+            renderer = std::make_unique<Renderer>(*window, *device, renderer_properties);
+        }
+        resource_cache = std::make_unique<ResourceCache>(*device);
+        pipeline_registry = std::make_unique<PipelineRegistry>(*device);
     }
 
     App::~App() {
@@ -169,124 +90,182 @@ namespace muon {
 
     void App::run() {
         std::string font_path = "assets/fonts/OpenSans-Regular.ttf";
-        Font font{font_path, device};
+        Font font{font_path, *device};
         auto atlas = font.getAtlas();
 
         InputManager input_manager;
-        window.bindInputManager(&input_manager);
-
-        std::vector<std::unique_ptr<Buffer>> ubo_buffers(Swapchain::MAX_FRAMES_IN_FLIGHT);
-        for (int i = 0; i < ubo_buffers.size(); i++) {
-            ubo_buffers[i] = std::make_unique<Buffer>(
-                device,
-                sizeof(GlobalUbo),
-                1,
-                vk::BufferUsageFlagBits::eUniformBuffer,
-                vk::MemoryPropertyFlagBits::eHostVisible
-            );
-            ubo_buffers[i]->map();
+        if (window) {
+            window->bindInputManager(&input_manager);
         }
 
-        auto global_set_layout = DescriptorSetLayout::Builder(device)
-            .addBinding(0, vk::DescriptorType::eUniformBuffer, vk::ShaderStageFlagBits::eAllGraphics)
-            .addBinding(1, vk::DescriptorType::eCombinedImageSampler, vk::ShaderStageFlagBits::eFragment)
+        auto &frame_allocator = renderer->getFrameAllocator();
+        auto &descriptor_cache = renderer->getDescriptorCache();
+        auto &gpu_profiler = renderer->getGpuProfiler();
+
+        auto global_set_layout = DescriptorSetLayout::Builder(*device)
+            .addBinding(0, vk::DescriptorType::eUniformBufferDynamic, vk::ShaderStageFlagBits::eAllGraphics)
             .build();
 
-        Texture texture{device, "assets/textures/icon.png"};
+        auto texture = resource_cache->loadTexture("assets/textures/icon.png");
 
-        std::vector<vk::DescriptorSet> global_descriptor_sets(Swapchain::MAX_FRAMES_IN_FLIGHT);
+        /* Textures are bound through the bindless table, draws carry their index */
+        std::vector<vk::DescriptorSet> global_descriptor_sets(renderer->getFramesInFlight());
         for (int i = 0; i < global_descriptor_sets.size(); i++) {
-            auto buffer_info = ubo_buffers[i]->descriptorInfo();
-            // auto image_info = texture.descriptorInfo();
-            auto image_info = atlas->descriptorInfo();
+            auto buffer_info = frame_allocator.descriptorInfo(sizeof(GlobalUbo));
 
-            DescriptorWriter(*global_set_layout, *global_pool)
+            DescriptorWriter(*global_set_layout, descriptor_cache)
                 .writeToBuffer(0, &buffer_info)
-                .writeImage(1, &image_info)
                 .build(global_descriptor_sets[i]);
         }
+        const uint32_t atlas_index = atlas->getBindlessIndex();
+
+        /* The overlay's glyphs are rewritten in place when its string changes, no model per frame */
+        TextRenderer text_renderer{*device, font, renderer->getFramesInFlight()};
 
-        RenderSystem3D render_system{device, renderer.getSwapchainRenderPass(), global_set_layout->getDescriptorSetLayout()};
+        RenderSystem3D render_system{*device, *pipeline_registry, renderer->getPipelineTarget(), global_set_layout->getDescriptorSetLayout(), frame_allocator, descriptor_cache, renderer->getDescriptorAllocator()};
 
         glm::vec3 camera_pos = {0.0f, 0.0f, 0.0f};
         Camera camera{};
         camera.lookAt(camera_pos, {0.0f, 0.0f, -1.0f});
 
-        std::shared_ptr model = Model::fromFile(device, "assets/models/cube.obj");
-
-        std::unique_ptr<Model> text_model = nullptr;
+        auto model = resource_cache->loadModel("assets/models/cube.obj");
 
         auto current_time = std::chrono::high_resolution_clock::now();
         float frame_time;
 
-        struct ModelComponent {
-            std::weak_ptr<Model> model;
-        };
-
-        struct TransformComponent {
-            glm::mat4 transform;
-        };
-
         struct TextComponent {
-            std::unique_ptr<Model> text;
+            TextRenderer::LabelId label;
         };
 
         entt::registry registry;
 
         entt::entity cube = registry.create();
-        entt::entity text = registry.create();
 
         registry.emplace<ModelComponent>(cube, model);
-        registry.emplace<TextComponent>(text, nullptr);
 
         glm::mat4 cube_transform = glm::translate(glm::mat4{1.0f}, {0.0f, 0.0f, -5.0f});
         cube_transform = glm::scale(cube_transform, {0.5f, 0.5f, 0.5f});
         registry.emplace<TransformComponent>(cube, cube_transform);
 
-
+        /* One label per overlay line, so a line that did not change costs nothing */
         glm::mat4 text_transform = glm::translate(glm::mat4{1.0f}, {0.5f, -0.5f, -5.0f});
         text_transform = glm::scale(text_transform, {0.1f, 0.1f, 0.1f});
-        registry.emplace<TransformComponent>(text, text_transform);
+        uint32_t overlay_lines = 0;
+        auto create_overlay_label = [&](uint32_t line_count, uint32_t max_glyphs) {
+            const entt::entity entity = registry.create();
+            const auto label = text_renderer.createLabel(max_glyphs);
+            const float y = static_cast<float>(overlay_lines) * text_renderer.getLineHeight();
+            registry.emplace<TextComponent>(entity, label);
+            registry.emplace<TransformComponent>(entity, glm::translate(text_transform, {0.0f, y, 0.0f}));
+            overlay_lines += line_count;
+            return label;
+        };
 
-        while (window.isOpen()) {
-            window.pollEvents();
+        const auto fps_label = create_overlay_label(1, OVERLAY_LINE_GLYPHS);
+        const auto mouse_label = create_overlay_label(2, OVERLAY_LINE_GLYPHS);
+        const auto draws_label = create_overlay_label(1, OVERLAY_LINE_GLYPHS);
+        const auto fence_label = create_overlay_label(1, OVERLAY_LINE_GLYPHS);
+        const auto gpu_label = create_overlay_label(1, OVERLAY_GPU_GLYPHS);
+        std::string gpu_text{};
+
+        /* Transparent draws are never instanced, so each of these is one draw to record */
+        const auto stress_transforms = makeStressTransforms(stress_draws);
+        const bool compare_recording = stress_draws > 0 && renderer->getThreadPool().getThreadCount() > 0;
+        if (stress_draws > 0 && !compare_recording) {
+            spdlog::warn("No worker threads, stress draws are recorded inline only");
+        }
 
-            if (input_manager.getKeyboard().isKeyDown(SDL_SCANCODE_ESCAPE)) {
-                window.setToClose();
-            }
+        /* Headless runs report the time from beginFrame to endFrame, fence waits included, and the wall time of the whole run */
+        uint32_t frames_rendered = 0;
+        double frame_time_total = 0.0;
+        double fence_wait_total = 0.0;
+        double frame_time_min = std::numeric_limits<double>::max();
+        double frame_time_max = 0.0;
+        double record_inline_total = 0.0;
+        double record_parallel_total = 0.0;
+        uint32_t record_inline_frames = 0;
+        uint32_t record_parallel_frames = 0;
+        uint32_t recorded_draws = 0;
+
+        /* Frames before the pipelines are ready skip their draws, they would flatter the numbers */
+        if (isHeadless()) {
+            pipeline_registry->waitIdle();
+        }
+        const auto run_start = std::chrono::high_resolution_clock::now();
+
+        auto running = [&]() {
+            return isHeadless() ? frames_rendered < headless_frames : window->isOpen();
+        };
+
+        MUON_PROFILE_THREAD("main");
 
-            if (input_manager.getMouse().isButtonDown(MouseButton::Mouse1)) {
-                window.setTitle("Hello");
-            } else if (input_manager.getMouse().isButtonDown(MouseButton::Mouse2)) {
-                window.setTitle("World");
+        while (running()) {
+            MUON_PROFILE_FRAME();
+
+            if (window) {
+                window->pollEvents();
+
+                if (input_manager.getKeyboard().isKeyDown(SDL_SCANCODE_ESCAPE)) {
+                    window->setToClose();
+                }
+
+                /* Between frames, so no worker is recording into its ring */
+                if (profiler::ENABLED && input_manager.getKeyboard().isKeyDown(SDL_SCANCODE_F12)) {
+                    profiler::writeTrace(defaults::profiler::TRACE_PATH, defaults::profiler::TRACE_FRAMES);
+                }
+
+                if (input_manager.getMouse().isButtonDown(MouseButton::Mouse1)) {
+                    window->setTitle("Hello");
+                } else if (input_manager.getMouse().isButtonDown(MouseButton::Mouse2)) {
+                    window->setTitle("World");
+                }
             }
 
             auto new_time = std::chrono::high_resolution_clock::now();
             frame_time = std::chrono::duration<float, std::chrono::seconds::period>(new_time - current_time).count();
             current_time = new_time;
 
-            // camera.setPerspectiveProjection(glm::radians(90.0f), renderer.getAspectRatio(), 0.01f, 1000.0f);
-            camera.setOrthographicProjection(-renderer.getAspectRatio(), renderer.getAspectRatio(), -1, 1);
+            // camera.setPerspectiveProjection(glm::radians(90.0f), renderer->getAspectRatio(), 0.01f, 1000.0f);
+            camera.setOrthographicProjection(-renderer->getAspectRatio(), renderer->getAspectRatio(), -1, 1);
 
-            renderer.setClearColor(color::hexToRgba<std::array<float, 4>>(0xFF1010FF));
-            if (const auto command_buffer = renderer.beginFrame()) {
-                const int frame_index = renderer.getFrameIndex();
+            renderer->setClearColor(color::hexToRgba<std::array<float, 4>>(0xFF1010FF));
+            const auto frame_start = std::chrono::high_resolution_clock::now();
+            if (const auto command_buffer = renderer->beginFrame()) {
+                const int frame_index = renderer->getFrameIndex();
+                text_renderer.beginFrame(frame_index);
 
                 GlobalUbo global_ubo{};
                 global_ubo.projection = camera.getProjection();
                 global_ubo.view = camera.getView();
-                ubo_buffers[frame_index]->writeToBuffer(&global_ubo);
-                ubo_buffers[frame_index]->flush();
-
-                renderer.beginSwapchainRenderPass(command_buffer);
-
-                auto mouse_pos = input_manager.getMouse().getCurrentPosition();
-                std::string pos_text = std::to_string(mouse_pos.x) + "\n" + std::to_string(mouse_pos.y);
-                std::string fps_text = std::to_string(static_cast<int>(1.0f / frame_time)) + " FPS";
-                std::string both_text = fps_text + '\n' + pos_text;
-                // text_model = generateText(device, font, both_text);
-                TextComponent &text_component = registry.get<TextComponent>(text);
-                text_component.text = generateText(device, font, both_text);
+                auto global_ubo_slice = frame_allocator.pushGlobal(global_ubo);
+
+                {
+                    MUON_PROFILE_SCOPE("update overlay");
+                    /* Formatted on the stack, setText only lays out and uploads the labels whose text changed */
+                    char line[128];
+
+                    std::snprintf(line, sizeof(line), "%d FPS", static_cast<int>(1.0f / frame_time));
+                    text_renderer.setText(fps_label, line);
+
+                    const auto mouse_pos = input_manager.getMouse().getCurrentPosition();
+                    std::snprintf(line, sizeof(line), "%.0f\n%.0f", mouse_pos.x, mouse_pos.y);
+                    text_renderer.setText(mouse_label, line);
+
+                    const auto &stats = renderer->getLastFrameStats();
+                    std::snprintf(line, sizeof(line), "%u draws, %u binds, %u skipped", stats.draws, stats.issued(), stats.skipped());
+                    text_renderer.setText(draws_label, line);
+
+                    const double fence_wait_ms = std::chrono::duration<double, std::milli>(renderer->getLastFenceWait()).count();
+                    std::snprintf(line, sizeof(line), "%.2f ms fence wait", fence_wait_ms);
+                    text_renderer.setText(fence_label, line);
+
+                    gpu_text.clear();
+                    for (const auto &scope : gpu_profiler.getStats()) {
+                        std::snprintf(line, sizeof(line), "%s%s %.2f ms GPU", gpu_text.empty() ? "" : "\n", scope.name.c_str(), scope.avg_ms);
+                        gpu_text += line;
+                    }
+                    text_renderer.setText(gpu_label, gpu_text);
+                }
 
                 TransformComponent &cube_transform = registry.get<TransformComponent>(cube);
                 cube_transform.transform = glm::rotate(cube_transform.transform, glm::radians(1.0f), {1.0f, 1.0f, 1.0f});
@@ -295,30 +274,114 @@ namespace muon {
                     frame_index,
                     frame_time,
                     command_buffer,
+                    renderer->getCommandRecorder(),
                     camera,
-                    global_descriptor_sets[frame_index]
+                    global_descriptor_sets[frame_index],
+                    static_cast<uint32_t>(global_ubo_slice.offset)
                 };
                 // render_system.renderModel(frame_info, *model);
                 // render_system.renderModel(frame_info, *text_model);
 
-                auto model_transform = registry.view<ModelComponent, TransformComponent>();
-                model_transform.each([&](ModelComponent &model, TransformComponent &transform) {
-                    render_system.renderModel(frame_info, *model.model.lock(), transform.transform);
-                });
+                {
+                    MUON_PROFILE_SCOPE("submit models");
+                    auto model_transform = registry.view<ModelComponent, TransformComponent>();
+                    model_transform.each([&](ModelComponent &model, TransformComponent &transform) {
+                        if (auto *mesh = resource_cache->getModel(model.model)) {
+                            render_system.submit(frame_info, *mesh, transform.transform, BlendMode::Opaque, atlas_index);
+                        }
+                    });
+
+                    if (auto *mesh = resource_cache->getModel(model)) {
+                        for (const auto &stress_transform : stress_transforms) {
+                            render_system.submit(frame_info, *mesh, stress_transform, BlendMode::Transparent, atlas_index);
+                        }
+                    }
+                }
+
+                {
+                    MUON_PROFILE_SCOPE("update labels");
+                    auto text_transform = registry.view<TextComponent, TransformComponent>();
+                    text_transform.each([&](TextComponent &text, TransformComponent &transform) {
+                        text_renderer.setTransform(text.label, transform.transform);
+                    });
+                }
 
-                auto text_transform = registry.view<TextComponent, TransformComponent>();
-                text_transform.each([&](TextComponent &text, TransformComponent &transform) {
-                    render_system.renderModel(frame_info, *text.text, transform.transform);
-                });
+                /* Sorting and instance uploads happen up front, recording only reads the prepared draws */
+                render_system.prepare(frame_info);
+                const uint32_t draw_count = render_system.getDrawCount();
+
+                /* Stress runs alternate the two paths so their recording times compare on the same scene */
+                const bool record_parallel = compare_recording ? frames_rendered % 2 == 1 : renderer->shouldRecordParallel(draw_count);
+                const auto record_start = std::chrono::high_resolution_clock::now();
+
+                {
+                    GpuProfiler::Scope pass_scope{gpu_profiler, command_buffer, "main pass"};
+
+                    /* Timestamps cannot go in a subpass that only executes secondaries, so both paths share the pass scope */
+                    if (record_parallel) {
+                        renderer->beginSwapchainRenderPass(command_buffer, vk::SubpassContents::eSecondaryCommandBuffers);
+                        renderer->recordParallel(draw_count, [&](CommandRecorder &recorder, uint32_t begin, uint32_t end) {
+                            render_system.record(frame_info, recorder, begin, end);
+                            /* Secondaries execute in slice order, the last one draws the text over everything */
+                            if (end == draw_count) {
+                                render_system.renderText(frame_info, recorder, text_renderer);
+                            }
+                        });
+                    } else {
+                        renderer->beginSwapchainRenderPass(command_buffer);
+                        render_system.record(frame_info, frame_info.recorder, 0, draw_count);
+                        render_system.renderText(frame_info, frame_info.recorder, text_renderer);
+                    }
+
+                    renderer->endSwapchainRenderPass(command_buffer);
+                }
 
-                renderer.endSwapchainRenderPass(command_buffer);
-                renderer.endFrame();
+                recorded_draws = draw_count;
+                const double record_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - record_start).count();
+                if (record_parallel) {
+                    record_parallel_total += record_ms;
+                    record_parallel_frames++;
+                } else {
+                    record_inline_total += record_ms;
+                    record_inline_frames++;
+                }
+
+                renderer->endFrame();
+
+                const double frame_time_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - frame_start).count();
+                frame_time_total += frame_time_ms;
+                frame_time_min = std::min(frame_time_min, frame_time_ms);
+                frame_time_max = std::max(frame_time_max, frame_time_ms);
+                fence_wait_total += std::chrono::duration<double, std::milli>(renderer->getLastFenceWait()).count();
+                frames_rendered++;
             }
 
             input_manager.update();
         }
 
-        vkDeviceWaitIdle(device.getDevice());
+        vkDeviceWaitIdle(device->getDevice());
+
+        if (isHeadless() && frames_rendered > 0) {
+            const double run_ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - run_start).count();
+            spdlog::info(
+                "Rendered {} frames in {:.2f} ms ({:.1f} FPS), frame time avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms, fence wait avg {:.3f} ms",
+                frames_rendered, run_ms, 1000.0 * frames_rendered / run_ms,
+                frame_time_total / frames_rendered, frame_time_min, frame_time_max,
+                fence_wait_total / frames_rendered
+            );
+            if (compare_recording && record_inline_frames > 0 && record_parallel_frames > 0) {
+                const double inline_ms = record_inline_total / record_inline_frames;
+                const double parallel_ms = record_parallel_total / record_parallel_frames;
+                spdlog::info(
+                    "Recording {} draws: inline avg {:.3f} ms, parallel avg {:.3f} ms on {} threads ({:.2f}x), threshold {}",
+                    recorded_draws, inline_ms, parallel_ms, renderer->getThreadPool().getThreadCount() + 1,
+                    inline_ms / parallel_ms, renderer->getParallelRecordThreshold()
+                );
+            }
+            for (const auto &scope : gpu_profiler.getStats()) {
+                spdlog::info("GPU {}: avg {:.3f} ms, min {:.3f} ms, max {:.3f} ms", scope.name, scope.avg_ms, scope.min_ms, scope.max_ms);
+            }
+        }
     }
 
 }
@@ -1,27 +1,40 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 
+#include "engine/assets/resourcecache.hpp"
 #include "engine/vulkan/descriptors.hpp"
 #include "engine/window/window.hpp"
 #include "engine/vulkan/device.hpp"
+#include "engine/vulkan/pipelineregistry.hpp"
 #include "engine/vulkan/renderer.hpp"
 
 namespace muon {
 
 class App {
 public:
-    App(WindowProperties &properties);
+    /*
+        With headless_frames set, renders that many frames offscreen at the window size, then exits.
+        stress_draws adds that many separately drawn cubes and alternates inline and parallel recording.
+    */
+    App(WindowProperties &properties, const RendererProperties &renderer_properties, uint32_t headless_frames = 0, uint32_t stress_draws = 0);
     ~App();
 
     void run();
 private:
     WindowProperties properties;
-    Window window{properties};
-    Device device{window};
-    Renderer renderer{window, device};
+    uint32_t headless_frames;
+    uint32_t stress_draws;
 
-    std::unique_ptr<DescriptorPool> global_pool;
+    /* Null when headless */
+    std::unique_ptr<Window> window;
+    std::unique_ptr<Device> device;
+    std::unique_ptr<Renderer> renderer;
+    std::unique_ptr<ResourceCache> resource_cache;
+    std::unique_ptr<PipelineRegistry> pipeline_registry;
+
+    bool isHeadless() const { return headless_frames > 0; }
 };
 
 }
@@ -0,0 +1,56 @@
+#include "engine/assets/resourcecache.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include "utils/profiler.hpp"
+
+namespace muon {
+
+    ResourceCache::ResourceCache(Device &device) : device{device} {}
+
+    ResourceCache::~ResourceCache() {
+        models.clear();
+        textures.clear();
+    }
+
+    Handle<Model> ResourceCache::loadModel(const std::string &path) {
+        if (auto it = model_paths.find(path); it != model_paths.end() && models.contains(it->second)) {
+            return it->second;
+        }
+
+        MUON_PROFILE_SCOPE("ResourceCache::loadModel");
+
+        Model::Builder builder{};
+        builder.loadModel(path);
+        spdlog::trace("Loaded model {}: {} vertices, {} indices", path, builder.vertices.size(), builder.indices.size());
+
+        auto handle = models.create(device, builder);
+        model_paths[path] = handle;
+        return handle;
+    }
+
+    Handle<Texture> ResourceCache::loadTexture(const std::string &path) {
+        if (auto it = texture_paths.find(path); it != texture_paths.end() && textures.contains(it->second)) {
+            return it->second;
+        }
+
+        MUON_PROFILE_SCOPE("ResourceCache::loadTexture");
+
+        auto handle = textures.create(device, path);
+        texture_paths[path] = handle;
+        return handle;
+    }
+
+    Handle<Model> ResourceCache::createModel(const Model::Builder &builder) {
+        return models.create(device, builder);
+    }
+
+    void ResourceCache::releaseModel(Handle<Model> handle) {
+        models.destroy(handle);
+    }
+
+    void ResourceCache::releaseTexture(Handle<Texture> handle) {
+        textures.destroy(handle);
+    }
+
+}
@@ -0,0 +1,952 @@
+#include "engine/rendering/rendergraph.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+#include <spdlog/spdlog.h>
+
+#include "engine/vulkan/deletionqueue.hpp"
+
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    namespace {
+
+        /* The original stage and access bits keep their values in the 64 bit synchronization2 flags */
+        vk::PipelineStageFlags2KHR toStageFlags2(vk::PipelineStageFlags stages) {
+            return vk::PipelineStageFlags2KHR{static_cast<VkFlags64>(static_cast<VkPipelineStageFlags>(stages))};
+        }
+
+        vk::AccessFlags2KHR toAccessFlags2(vk::AccessFlags access) {
+            return vk::AccessFlags2KHR{static_cast<VkFlags64>(static_cast<VkAccessFlags>(access))};
+        }
+
+    }
+
+    /* PassBuilder */
+    void RenderGraph::PassBuilder::writeColor(RenderGraphImage image, LoadOp load_op, vk::ClearColorValue clear_value) {
+        Usage usage{};
+        usage.kind = ResourceKind::Image;
+        usage.index = image.index;
+        usage.type = UsageType::ColorAttachment;
+        usage.stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        usage.access = vk::AccessFlagBits::eColorAttachmentWrite;
+        usage.layout = vk::ImageLayout::eColorAttachmentOptimal;
+        usage.read = load_op == LoadOp::Load;
+        usage.write = true;
+        usage.load_op = load_op;
+        usage.clear_value.color = clear_value;
+        if (usage.read) {
+            usage.access |= vk::AccessFlagBits::eColorAttachmentRead;
+        }
+
+        graph.addUsage(pass_index, std::move(usage));
+    }
+
+    void RenderGraph::PassBuilder::writeDepth(RenderGraphImage image, LoadOp load_op, vk::ClearDepthStencilValue clear_value) {
+        Usage usage{};
+        usage.kind = ResourceKind::Image;
+        usage.index = image.index;
+        usage.type = UsageType::DepthAttachment;
+        usage.stages = vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests;
+        /* Depth testing reads the attachment whatever the load op */
+        usage.access = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        usage.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+        usage.read = load_op == LoadOp::Load;
+        usage.write = true;
+        usage.load_op = load_op;
+        usage.clear_value.depthStencil = clear_value;
+
+        graph.addUsage(pass_index, std::move(usage));
+    }
+
+    void RenderGraph::PassBuilder::readTexture(RenderGraphImage image, vk::PipelineStageFlags stages) {
+        Usage usage{};
+        usage.kind = ResourceKind::Image;
+        usage.index = image.index;
+        usage.type = UsageType::Texture;
+        usage.stages = stages;
+        usage.access = vk::AccessFlagBits::eShaderRead;
+        usage.layout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        usage.read = true;
+        usage.write = false;
+
+        graph.addUsage(pass_index, std::move(usage));
+    }
+
+    void RenderGraph::PassBuilder::readStorageImage(RenderGraphImage image, vk::PipelineStageFlags stages) {
+        Usage usage{};
+        usage.kind = ResourceKind::Image;
+        usage.index = image.index;
+        usage.type = UsageType::StorageRead;
+        usage.stages = stages;
+        usage.access = vk::AccessFlagBits::eShaderRead;
+        usage.layout = vk::ImageLayout::eGeneral;
+        usage.read = true;
+        usage.write = false;
+
+        graph.addUsage(pass_index, std::move(usage));
+    }
+
+    void RenderGraph::PassBuilder::writeStorageImage(RenderGraphImage image, vk::PipelineStageFlags stages) {
+        Usage usage{};
+        usage.kind = ResourceKind::Image;
+        usage.index = image.index;
+        usage.type = UsageType::StorageWrite;
+        usage.stages = stages;
+        usage.access = vk::AccessFlagBits::eShaderWrite;
+        usage.layout = vk::ImageLayout::eGeneral;
+        usage.read = false;
+        usage.write = true;
+
+        graph.addUsage(pass_index, std::move(usage));
+    }
+
+    void RenderGraph::PassBuilder::readBuffer(RenderGraphBuffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access) {
+        Usage usage{};
+        usage.kind = ResourceKind::Buffer;
+        usage.index = buffer.index;
+        usage.type = UsageType::BufferRead;
+        usage.stages = stages;
+        usage.access = access;
+        usage.read = true;
+        usage.write = false;
+
+        graph.addUsage(pass_index, std::move(usage));
+    }
+
+    void RenderGraph::PassBuilder::writeBuffer(RenderGraphBuffer buffer, vk::PipelineStageFlags stages, vk::AccessFlags access) {
+        Usage usage{};
+        usage.kind = ResourceKind::Buffer;
+        usage.index = buffer.index;
+        usage.type = UsageType::BufferWrite;
+        usage.stages = stages;
+        usage.access = access;
+        usage.read = false;
+        usage.write = true;
+
+        graph.addUsage(pass_index, std::move(usage));
+    }
+
+    /* RenderGraph */
+    RenderGraph::~RenderGraph() {
+        releaseResources();
+    }
+
+    RenderGraphImage RenderGraph::createImage(const std::string &name, const ImageDesc &desc) {
+        ImageResource resource{};
+        resource.name = name;
+        resource.desc = desc;
+
+        images.push_back(std::move(resource));
+        compiled = false;
+
+        return RenderGraphImage{static_cast<uint32_t>(images.size() - 1)};
+    }
+
+    RenderGraphImage RenderGraph::importImage(const std::string &name, vk::Image image, vk::ImageView view, const ImageDesc &desc, vk::ImageLayout initial_layout, vk::ImageLayout final_layout) {
+        ImageResource resource{};
+        resource.name = name;
+        resource.desc = desc;
+        resource.image = image;
+        resource.view = view;
+        resource.imported = true;
+        resource.initial_layout = initial_layout;
+        resource.final_layout = final_layout;
+
+        images.push_back(std::move(resource));
+        compiled = false;
+
+        return RenderGraphImage{static_cast<uint32_t>(images.size() - 1)};
+    }
+
+    RenderGraphBuffer RenderGraph::importBuffer(const std::string &name, vk::Buffer buffer) {
+        buffers.push_back({name, buffer});
+        compiled = false;
+
+        return RenderGraphBuffer{static_cast<uint32_t>(buffers.size() - 1)};
+    }
+
+    void RenderGraph::setImportedImage(RenderGraphImage image, vk::Image handle, vk::ImageView view) {
+        auto &resource = images[image.index];
+        if (!resource.imported) {
+            spdlog::warn("Render graph image {} is transient and cannot be replaced", resource.name);
+            return;
+        }
+
+        resource.image = handle;
+        resource.view = view;
+    }
+
+    void RenderGraph::addPass(const std::string &name, const SetupFunction &setup, ExecuteFunction &&execute) {
+        const auto pass_index = static_cast<uint32_t>(passes.size());
+
+        Pass pass{};
+        pass.name = name;
+        pass.execute = std::move(execute);
+        passes.push_back(std::move(pass));
+
+        PassBuilder builder{*this, pass_index};
+        setup(builder);
+        passes[pass_index].side_effect = builder.side_effect;
+
+        compiled = false;
+    }
+
+    void RenderGraph::addUsage(uint32_t pass_index, Usage &&usage) {
+        const size_t resource_count = usage.kind == ResourceKind::Image ? images.size() : buffers.size();
+        if (usage.index >= resource_count) {
+            spdlog::error("Render graph pass {} uses an unknown resource", passes[pass_index].name);
+            exit(exitcode::FAILURE);
+        }
+
+        /* One usage per resource per pass, the barrier before the pass can only move it to one state */
+        auto &usages = passes[pass_index].usages;
+        const bool duplicate = std::any_of(usages.begin(), usages.end(), [&](const Usage &other) {
+            return other.kind == usage.kind && other.index == usage.index;
+        });
+        if (duplicate) {
+            spdlog::warn("Render graph pass {} uses a resource twice, ignoring the second use", passes[pass_index].name);
+            return;
+        }
+
+        usages.push_back(std::move(usage));
+    }
+
+    void RenderGraph::compile() {
+        releaseResources();
+        stats = {};
+
+        cullPasses();
+        computeLifetimes();
+        createTransientImages();
+        planBarriers();
+        createRenderPasses();
+
+        compiled = true;
+
+        spdlog::debug(
+            "Render graph compiled: {} passes ({} culled), {} barriers in {} batches, {} KiB transient memory ({} KiB unaliased)",
+            stats.passes, stats.culled_passes, stats.barriers, stats.barrier_batches,
+            stats.transient_memory / 1024, stats.transient_memory_unaliased / 1024
+        );
+    }
+
+    void RenderGraph::execute(vk::CommandBuffer command_buffer) {
+        if (!compiled) {
+            compile();
+        }
+
+        for (auto &pass : passes) {
+            if (pass.culled) {
+                continue;
+            }
+
+            recordBarriers(command_buffer, pass.barriers);
+
+            PassContext context{command_buffer, pass.render_pass, pass.extent, *this};
+
+            if (!pass.render_pass) {
+                pass.execute(context);
+                continue;
+            }
+
+            vk::RenderPassBeginInfo render_pass_info{};
+            render_pass_info.sType = vk::StructureType::eRenderPassBeginInfo;
+            render_pass_info.renderPass = pass.render_pass;
+            render_pass_info.framebuffer = getFramebuffer(pass);
+            render_pass_info.renderArea.setOffset({0, 0});
+            render_pass_info.renderArea.extent = pass.extent;
+            render_pass_info.clearValueCount = static_cast<uint32_t>(pass.clear_values.size());
+            render_pass_info.pClearValues = pass.clear_values.data();
+
+            command_buffer.beginRenderPass(&render_pass_info, vk::SubpassContents::eInline);
+            pass.execute(context);
+            command_buffer.endRenderPass();
+        }
+
+        recordBarriers(command_buffer, final_barriers);
+    }
+
+    void RenderGraph::reset() {
+        releaseResources();
+        images.clear();
+        buffers.clear();
+        passes.clear();
+        compiled = false;
+        stats = {};
+    }
+
+    void RenderGraph::cullPasses() {
+        /* Walk backwards from the graph outputs, a pass survives if something later consumes what it writes */
+        std::vector<bool> needed_images(images.size(), false);
+
+        for (auto it = passes.rbegin(); it != passes.rend(); ++it) {
+            auto &pass = *it;
+
+            bool keep = pass.side_effect;
+            for (const auto &usage : pass.usages) {
+                if (!usage.write) {
+                    continue;
+                }
+                /* Imports outlive the graph, so writing one is an output */
+                if (usage.kind == ResourceKind::Buffer || images[usage.index].imported || needed_images[usage.index]) {
+                    keep = true;
+                }
+            }
+
+            pass.culled = !keep;
+            stats.passes++;
+            if (!keep) {
+                stats.culled_passes++;
+                continue;
+            }
+
+            for (const auto &usage : pass.usages) {
+                if (usage.kind != ResourceKind::Image) {
+                    continue;
+                }
+
+                /* Cleared or discarded attachments are fully overwritten, earlier contents are dead */
+                const bool attachment = usage.type == UsageType::ColorAttachment || usage.type == UsageType::DepthAttachment;
+                if (usage.write && attachment && !usage.read) {
+                    needed_images[usage.index] = false;
+                }
+            }
+            for (const auto &usage : pass.usages) {
+                /* Storage writes may be partial, so whatever was there before stays live */
+                if (usage.kind == ResourceKind::Image && (usage.read || usage.type == UsageType::StorageWrite)) {
+                    needed_images[usage.index] = true;
+                }
+            }
+        }
+    }
+
+    void RenderGraph::computeLifetimes() {
+        for (auto &image : images) {
+            image.usage = image.desc.usage;
+            image.first_pass = UINT32_MAX;
+            image.last_pass = 0;
+        }
+
+        for (uint32_t pass_index = 0; pass_index < passes.size(); pass_index++) {
+            if (passes[pass_index].culled) {
+                continue;
+            }
+
+            for (const auto &usage : passes[pass_index].usages) {
+                if (usage.kind != ResourceKind::Image) {
+                    continue;
+                }
+
+                auto &image = images[usage.index];
+                image.first_pass = std::min(image.first_pass, pass_index);
+                image.last_pass = std::max(image.last_pass, pass_index);
+
+                switch (usage.type) {
+                    case UsageType::ColorAttachment:
+                        image.usage |= vk::ImageUsageFlagBits::eColorAttachment;
+                        break;
+                    case UsageType::DepthAttachment:
+                        image.usage |= vk::ImageUsageFlagBits::eDepthStencilAttachment;
+                        break;
+                    case UsageType::Texture:
+                        image.usage |= vk::ImageUsageFlagBits::eSampled;
+                        break;
+                    case UsageType::StorageRead:
+                    case UsageType::StorageWrite:
+                        image.usage |= vk::ImageUsageFlagBits::eStorage;
+                        break;
+                    default:
+                        break;
+                }
+            }
+        }
+    }
+
+    void RenderGraph::createTransientImages() {
+        std::vector<uint32_t> transients{};
+        std::vector<vk::MemoryRequirements> requirements(images.size());
+
+        for (uint32_t i = 0; i < images.size(); i++) {
+            auto &image = images[i];
+            if (image.imported || image.first_pass == UINT32_MAX) {
+                continue;
+            }
+
+            vk::ImageCreateInfo image_info{};
+            image_info.sType = vk::StructureType::eImageCreateInfo;
+            image_info.imageType = vk::ImageType::e2D;
+            image_info.extent = vk::Extent3D{image.desc.extent.width, image.desc.extent.height, 1};
+            image_info.format = image.desc.format;
+            image_info.mipLevels = 1;
+            image_info.arrayLayers = 1;
+            image_info.samples = vk::SampleCountFlagBits::e1;
+            image_info.tiling = vk::ImageTiling::eOptimal;
+            image_info.initialLayout = vk::ImageLayout::eUndefined;
+            image_info.usage = image.usage;
+            image_info.sharingMode = vk::SharingMode::eExclusive;
+
+            if (device.getDevice().createImage(&image_info, nullptr, &image.image) != vk::Result::eSuccess) {
+                spdlog::error("Failed to create render graph image {}", image.name);
+                exit(exitcode::FAILURE);
+            }
+
+            device.getDevice().getImageMemoryRequirements(image.image, &requirements[i]);
+            stats.transient_memory_unaliased += requirements[i].size;
+            transients.push_back(i);
+        }
+
+        /* Largest first, so smaller images fill the slots the big ones opened */
+        std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) {
+            return requirements[a].size > requirements[b].size;
+        });
+
+        for (const uint32_t i : transients) {
+            auto &image = images[i];
+
+            for (uint32_t slot_index = 0; slot_index < alias_slots.size() && !image.alias_slot; slot_index++) {
+                auto &slot = alias_slots[slot_index];
+                if ((slot.requirements.memoryTypeBits & requirements[i].memoryTypeBits) == 0) {
+                    continue;
+                }
+
+                const bool overlaps = std::any_of(slot.images.begin(), slot.images.end(), [&](uint32_t other) {
+                    return !(images[other].last_pass < image.first_pass || image.last_pass < images[other].first_pass);
+                });
+                if (overlaps) {
+                    continue;
+                }
+
+                slot.requirements.size = std::max(slot.requirements.size, requirements[i].size);
+                slot.requirements.alignment = std::max(slot.requirements.alignment, requirements[i].alignment);
+                slot.requirements.memoryTypeBits &= requirements[i].memoryTypeBits;
+                slot.images.push_back(i);
+                image.alias_slot = slot_index;
+            }
+
+            if (!image.alias_slot) {
+                alias_slots.push_back({nullptr, requirements[i], {i}});
+                image.alias_slot = static_cast<uint32_t>(alias_slots.size() - 1);
+            }
+        }
+
+        VmaAllocationCreateInfo allocation_create_info{};
+        allocation_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+        for (auto &slot : alias_slots) {
+            const auto vk_requirements = static_cast<VkMemoryRequirements>(slot.requirements);
+            if (vmaAllocateMemory(device.getAllocator(), &vk_requirements, &allocation_create_info, &slot.allocation, nullptr) != VK_SUCCESS) {
+                spdlog::error("Failed to allocate render graph memory");
+                exit(exitcode::FAILURE);
+            }
+            stats.transient_memory += slot.requirements.size;
+
+            for (const uint32_t i : slot.images) {
+                if (vmaBindImageMemory(device.getAllocator(), slot.allocation, images[i].image) != VK_SUCCESS) {
+                    spdlog::error("Failed to bind render graph image {}", images[i].name);
+                    exit(exitcode::FAILURE);
+                }
+            }
+        }
+
+        for (const uint32_t i : transients) {
+            auto &image = images[i];
+
+            vk::ImageViewCreateInfo view_info{};
+            view_info.sType = vk::StructureType::eImageViewCreateInfo;
+            view_info.image = image.image;
+            view_info.viewType = vk::ImageViewType::e2D;
+            view_info.format = image.desc.format;
+            view_info.subresourceRange.aspectMask = aspectMask(i);
+            view_info.subresourceRange.baseMipLevel = 0;
+            view_info.subresourceRange.levelCount = 1;
+            view_info.subresourceRange.baseArrayLayer = 0;
+            view_info.subresourceRange.layerCount = 1;
+
+            if (device.getDevice().createImageView(&view_info, nullptr, &image.view) != vk::Result::eSuccess) {
+                spdlog::error("Failed to create render graph image view {}", image.name);
+                exit(exitcode::FAILURE);
+            }
+        }
+    }
+
+    void RenderGraph::planBarriers() {
+        /*
+            Frames in flight share the transient memory and the imported resources, so
+            a frame's first use has to wait for whatever the previous frame left in them.
+            A dry run over the passes finds that end of frame state.
+        */
+        std::vector<ResourceState> frame_end_images(images.size());
+        std::vector<ResourceState> frame_end_buffers(buffers.size());
+        planPasses(frame_end_images, frame_end_buffers, nullptr);
+        for (auto &pass : passes) {
+            pass.barriers = {};
+        }
+
+        std::vector<ResourceState> image_states(images.size());
+        std::vector<ResourceState> buffer_states = frame_end_buffers;
+        planPasses(image_states, buffer_states, &frame_end_images);
+
+        for (const auto &pass : passes) {
+            stats.barriers += static_cast<uint32_t>(pass.barriers.image_barriers.size() + pass.barriers.buffer_barriers.size());
+            stats.barrier_batches += pass.barriers.empty() ? 0 : 1;
+        }
+
+        final_barriers = {};
+        for (uint32_t i = 0; i < images.size(); i++) {
+            const auto &image = images[i];
+            const auto &state = image_states[i];
+            if (!image.imported || image.first_pass == UINT32_MAX || image.final_layout == vk::ImageLayout::eUndefined || state.layout == image.final_layout) {
+                continue;
+            }
+
+            ImageBarrier barrier{};
+            barrier.image = i;
+            barrier.old_layout = state.layout;
+            barrier.new_layout = image.final_layout;
+            barrier.src_stages = state.write_stages | state.read_stages;
+            barrier.src_access = state.write_access;
+
+            /* Presentation waits on a semaphore, anything else may be used by later commands */
+            if (image.final_layout == vk::ImageLayout::ePresentSrcKHR) {
+                barrier.dst_stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+                barrier.dst_access = {};
+            } else {
+                barrier.dst_stages = vk::PipelineStageFlagBits::eAllCommands;
+                barrier.dst_access = vk::AccessFlagBits::eMemoryRead | vk::AccessFlagBits::eMemoryWrite;
+            }
+
+            final_barriers.image_barriers.push_back(barrier);
+        }
+
+        stats.barriers += static_cast<uint32_t>(final_barriers.image_barriers.size());
+        stats.barrier_batches += final_barriers.empty() ? 0 : 1;
+    }
+
+    void RenderGraph::planPasses(std::vector<ResourceState> &image_states, std::vector<ResourceState> &buffer_states, const std::vector<ResourceState> *frame_end_images) {
+        for (uint32_t i = 0; i < images.size(); i++) {
+            /* Imports keep their own memory, so their first use waits on the previous frame's last one */
+            if (images[i].imported && frame_end_images) {
+                image_states[i] = (*frame_end_images)[i];
+            }
+            image_states[i].layout = images[i].imported ? images[i].initial_layout : vk::ImageLayout::eUndefined;
+        }
+
+        for (uint32_t pass_index = 0; pass_index < passes.size(); pass_index++) {
+            auto &pass = passes[pass_index];
+            if (pass.culled) {
+                continue;
+            }
+
+            for (const auto &usage : pass.usages) {
+                /* A transient image must wait for the previous occupant of its memory to finish */
+                if (usage.kind == ResourceKind::Image && images[usage.index].alias_slot && images[usage.index].first_pass == pass_index) {
+                    const auto &slot = alias_slots[*images[usage.index].alias_slot];
+
+                    /* The occupant used last before this pass, or failing that the last one of the previous frame */
+                    std::optional<uint32_t> previous{};
+                    std::optional<uint32_t> frame_end{};
+                    for (const uint32_t other : slot.images) {
+                        if (images[other].last_pass < pass_index && (!previous || images[other].last_pass > images[*previous].last_pass)) {
+                            previous = other;
+                        }
+                        if (!frame_end || images[other].last_pass > images[*frame_end].last_pass) {
+                            frame_end = other;
+                        }
+                    }
+
+                    const ResourceState *previous_state = nullptr;
+                    if (previous) {
+                        previous_state = &image_states[*previous];
+                    } else if (frame_end_images) {
+                        previous_state = &(*frame_end_images)[*frame_end];
+                    }
+
+                    if (previous_state) {
+                        auto &state = image_states[usage.index];
+                        state.write_stages = previous_state->write_stages | previous_state->read_stages;
+                        state.write_access = previous_state->write_access;
+                    }
+                }
+
+                planUsage(pass.barriers, image_states, buffer_states, usage);
+            }
+        }
+    }
+
+    void RenderGraph::planUsage(BarrierBatch &batch, std::vector<ResourceState> &image_states, std::vector<ResourceState> &buffer_states, const Usage &usage) {
+        const bool is_image = usage.kind == ResourceKind::Image;
+        auto &state = is_image ? image_states[usage.index] : buffer_states[usage.index];
+
+        const bool layout_change = is_image && state.layout != usage.layout;
+        bool needed = layout_change;
+        vk::PipelineStageFlags src_stages{};
+        vk::AccessFlags src_access{};
+
+        if (usage.write) {
+            /* Write after write needs the earlier write made available, write after read only has to wait for the reads */
+            needed |= state.write_stages || state.read_stages;
+            src_stages = state.write_stages | state.read_stages;
+            src_access = state.write_access;
+        } else {
+            /* Readers already made visible to these stages and accesses need nothing more */
+            const bool covered = (state.read_stages & usage.stages) == usage.stages && (state.read_access & usage.access) == usage.access;
+            needed |= state.write_stages && !covered;
+            src_stages = state.write_stages;
+            src_access = state.write_access;
+            if (layout_change) {
+                src_stages |= state.read_stages;
+            }
+        }
+
+        if (needed) {
+            /* First use: waiting on its own stages chains with semaphore waits, e.g. on the acquired swapchain image */
+            if (!src_stages) {
+                src_stages = usage.stages;
+            }
+
+            if (is_image) {
+                batch.image_barriers.push_back({usage.index, state.layout, usage.layout, src_stages, src_access, usage.stages, usage.access});
+            } else {
+                batch.buffer_barriers.push_back({usage.index, src_stages, src_access, usage.stages, usage.access});
+            }
+        }
+
+        if (usage.write) {
+            state.write_stages = usage.stages;
+            state.write_access = usage.access;
+            state.read_stages = {};
+            state.read_access = {};
+        } else {
+            /* After a barrier the writes are available, later readers only chain from this reader's stages */
+            if (needed) {
+                state.write_stages = usage.stages;
+                state.write_access = {};
+            }
+            state.read_stages |= usage.stages;
+            state.read_access |= usage.access;
+        }
+
+        if (is_image) {
+            state.layout = usage.layout;
+        }
+    }
+
+    void RenderGraph::createRenderPasses() {
+        for (uint32_t pass_index = 0; pass_index < passes.size(); pass_index++) {
+            auto &pass = passes[pass_index];
+            if (pass.culled) {
+                continue;
+            }
+
+            std::vector<vk::AttachmentDescription> attachments{};
+            std::vector<vk::AttachmentReference> colour_references{};
+            std::optional<vk::AttachmentReference> depth_reference{};
+
+            for (const auto &usage : pass.usages) {
+                if (usage.type != UsageType::ColorAttachment && usage.type != UsageType::DepthAttachment) {
+                    continue;
+                }
+
+                const auto &image = images[usage.index];
+
+                /* Contents nobody reads afterwards are discarded, which spares tilers the write back */
+                const bool store = image.imported || image.last_pass > pass_index;
+
+                vk::AttachmentDescription attachment{};
+                attachment.format = image.desc.format;
+                attachment.samples = vk::SampleCountFlagBits::e1;
+                switch (usage.load_op) {
+                    case LoadOp::Load:
+                        attachment.loadOp = vk::AttachmentLoadOp::eLoad;
+                        break;
+                    case LoadOp::Clear:
+                        attachment.loadOp = vk::AttachmentLoadOp::eClear;
+                        break;
+                    case LoadOp::DontCare:
+                        attachment.loadOp = vk::AttachmentLoadOp::eDontCare;
+                        break;
+                }
+                attachment.storeOp = store ? vk::AttachmentStoreOp::eStore : vk::AttachmentStoreOp::eDontCare;
+                attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+                attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+                attachment.initialLayout = usage.layout;
+                attachment.finalLayout = usage.layout;
+
+                const auto attachment_index = static_cast<uint32_t>(attachments.size());
+                if (usage.type == UsageType::ColorAttachment) {
+                    colour_references.push_back({attachment_index, usage.layout});
+                } else {
+                    depth_reference = vk::AttachmentReference{attachment_index, usage.layout};
+                }
+
+                attachments.push_back(attachment);
+                pass.clear_values.push_back(usage.clear_value);
+                if (pass.extent.width == 0) {
+                    pass.extent = image.desc.extent;
+                }
+            }
+
+            if (attachments.empty()) {
+                continue;
+            }
+
+            vk::SubpassDescription subpass{};
+            subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+            subpass.colorAttachmentCount = static_cast<uint32_t>(colour_references.size());
+            subpass.pColorAttachments = colour_references.data();
+            subpass.pDepthStencilAttachment = depth_reference ? &*depth_reference : nullptr;
+
+            /* No subpass dependencies, the graph's barriers outside the pass order everything */
+            vk::RenderPassCreateInfo render_pass_info{};
+            render_pass_info.sType = vk::StructureType::eRenderPassCreateInfo;
+            render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+            render_pass_info.pAttachments = attachments.data();
+            render_pass_info.subpassCount = 1;
+            render_pass_info.pSubpasses = &subpass;
+
+            if (device.getDevice().createRenderPass(&render_pass_info, nullptr, &pass.render_pass) != vk::Result::eSuccess) {
+                spdlog::error("Failed to create render pass for render graph pass {}", pass.name);
+                exit(exitcode::FAILURE);
+            }
+        }
+    }
+
+    void RenderGraph::recordBarriers(vk::CommandBuffer command_buffer, const BarrierBatch &batch) const {
+        if (batch.empty()) {
+            return;
+        }
+
+        auto subresourceRange = [&](uint32_t image) {
+            return vk::ImageSubresourceRange{aspectMask(image), 0, 1, 0, 1};
+        };
+
+        if (device.hasSynchronization2()) {
+            std::vector<vk::ImageMemoryBarrier2KHR> image_barriers{};
+            image_barriers.reserve(batch.image_barriers.size());
+            for (const auto &barrier : batch.image_barriers) {
+                vk::ImageMemoryBarrier2KHR image_barrier{};
+                image_barrier.sType = vk::StructureType::eImageMemoryBarrier2KHR;
+                image_barrier.srcStageMask = toStageFlags2(barrier.src_stages);
+                image_barrier.srcAccessMask = toAccessFlags2(barrier.src_access);
+                image_barrier.dstStageMask = toStageFlags2(barrier.dst_stages);
+                image_barrier.dstAccessMask = toAccessFlags2(barrier.dst_access);
+                image_barrier.oldLayout = barrier.old_layout;
+                image_barrier.newLayout = barrier.new_layout;
+                image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                image_barrier.image = images[barrier.image].image;
+                image_barrier.subresourceRange = subresourceRange(barrier.image);
+                image_barriers.push_back(image_barrier);
+            }
+
+            std::vector<vk::BufferMemoryBarrier2KHR> buffer_barriers{};
+            buffer_barriers.reserve(batch.buffer_barriers.size());
+            for (const auto &barrier : batch.buffer_barriers) {
+                vk::BufferMemoryBarrier2KHR buffer_barrier{};
+                buffer_barrier.sType = vk::StructureType::eBufferMemoryBarrier2KHR;
+                buffer_barrier.srcStageMask = toStageFlags2(barrier.src_stages);
+                buffer_barrier.srcAccessMask = toAccessFlags2(barrier.src_access);
+                buffer_barrier.dstStageMask = toStageFlags2(barrier.dst_stages);
+                buffer_barrier.dstAccessMask = toAccessFlags2(barrier.dst_access);
+                buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                buffer_barrier.buffer = buffers[barrier.buffer].buffer;
+                buffer_barrier.offset = 0;
+                buffer_barrier.size = vk::WholeSize;
+                buffer_barriers.push_back(buffer_barrier);
+            }
+
+            vk::DependencyInfoKHR dependency_info{};
+            dependency_info.sType = vk::StructureType::eDependencyInfoKHR;
+            dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(image_barriers.size());
+            dependency_info.pImageMemoryBarriers = image_barriers.data();
+            dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(buffer_barriers.size());
+            dependency_info.pBufferMemoryBarriers = buffer_barriers.data();
+
+            device.pipelineBarrier2(command_buffer, dependency_info);
+            return;
+        }
+
+        /* Without synchronization2 one call has one stage mask pair, the union of the batch */
+        vk::PipelineStageFlags src_stages{};
+        vk::PipelineStageFlags dst_stages{};
+
+        std::vector<vk::ImageMemoryBarrier> image_barriers{};
+        image_barriers.reserve(batch.image_barriers.size());
+        for (const auto &barrier : batch.image_barriers) {
+            vk::ImageMemoryBarrier image_barrier{};
+            image_barrier.sType = vk::StructureType::eImageMemoryBarrier;
+            image_barrier.srcAccessMask = barrier.src_access;
+            image_barrier.dstAccessMask = barrier.dst_access;
+            image_barrier.oldLayout = barrier.old_layout;
+            image_barrier.newLayout = barrier.new_layout;
+            image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            image_barrier.image = images[barrier.image].image;
+            image_barrier.subresourceRange = subresourceRange(barrier.image);
+            image_barriers.push_back(image_barrier);
+
+            src_stages |= barrier.src_stages;
+            dst_stages |= barrier.dst_stages;
+        }
+
+        std::vector<vk::BufferMemoryBarrier> buffer_barriers{};
+        buffer_barriers.reserve(batch.buffer_barriers.size());
+        for (const auto &barrier : batch.buffer_barriers) {
+            vk::BufferMemoryBarrier buffer_barrier{};
+            buffer_barrier.sType = vk::StructureType::eBufferMemoryBarrier;
+            buffer_barrier.srcAccessMask = barrier.src_access;
+            buffer_barrier.dstAccessMask = barrier.dst_access;
+            buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            buffer_barrier.buffer = buffers[barrier.buffer].buffer;
+            buffer_barrier.offset = 0;
+            buffer_barrier.size = vk::WholeSize;
+            buffer_barriers.push_back(buffer_barrier);
+
+            src_stages |= barrier.src_stages;
+            dst_stages |= barrier.dst_stages;
+        }
+
+        command_buffer.pipelineBarrier(
+            src_stages,
+            dst_stages,
+            vk::DependencyFlags{},
+            0, nullptr,
+            static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+            static_cast<uint32_t>(image_barriers.size()), image_barriers.data()
+        );
+    }
+
+    vk::Framebuffer RenderGraph::getFramebuffer(Pass &pass) {
+        std::vector<VkImageView> views{};
+        for (const auto &usage : pass.usages) {
+            if (usage.type == UsageType::ColorAttachment || usage.type == UsageType::DepthAttachment) {
+                views.push_back(images[usage.index].view);
+            }
+        }
+
+        /* Imports such as the swapchain image change view each frame, one framebuffer per combination */
+        auto it = pass.framebuffers.find(views);
+        if (it != pass.framebuffers.end()) {
+            return it->second;
+        }
+
+        vk::FramebufferCreateInfo framebuffer_info{};
+        framebuffer_info.sType = vk::StructureType::eFramebufferCreateInfo;
+        framebuffer_info.renderPass = pass.render_pass;
+        framebuffer_info.attachmentCount = static_cast<uint32_t>(views.size());
+        framebuffer_info.pAttachments = reinterpret_cast<const vk::ImageView *>(views.data());
+        framebuffer_info.width = pass.extent.width;
+        framebuffer_info.height = pass.extent.height;
+        framebuffer_info.layers = 1;
+
+        vk::Framebuffer framebuffer{};
+        if (device.getDevice().createFramebuffer(&framebuffer_info, nullptr, &framebuffer) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create framebuffer for render graph pass {}", pass.name);
+            exit(exitcode::FAILURE);
+        }
+
+        pass.framebuffers.emplace(std::move(views), framebuffer);
+        return framebuffer;
+    }
+
+    void RenderGraph::releaseResources() {
+        std::vector<vk::ImageView> views{};
+        std::vector<vk::Image> transient_images{};
+        std::vector<VmaAllocation> allocations{};
+        std::vector<vk::RenderPass> render_passes{};
+        std::vector<vk::Framebuffer> framebuffers{};
+
+        for (auto &image : images) {
+            if (!image.imported) {
+                if (image.view) {
+                    views.push_back(image.view);
+                }
+                if (image.image) {
+                    transient_images.push_back(image.image);
+                }
+                image.image = nullptr;
+                image.view = nullptr;
+            }
+            image.alias_slot.reset();
+        }
+
+        for (auto &slot : alias_slots) {
+            allocations.push_back(slot.allocation);
+        }
+        alias_slots.clear();
+
+        for (auto &pass : passes) {
+            if (pass.render_pass) {
+                render_passes.push_back(pass.render_pass);
+            }
+            for (const auto &[key, framebuffer] : pass.framebuffers) {
+                framebuffers.push_back(framebuffer);
+            }
+
+            pass.culled = false;
+            pass.barriers = {};
+            pass.render_pass = nullptr;
+            pass.framebuffers.clear();
+            pass.clear_values.clear();
+            pass.extent = vk::Extent2D{};
+        }
+        final_barriers = {};
+        compiled = false;
+
+        if (views.empty() && transient_images.empty() && allocations.empty() && render_passes.empty() && framebuffers.empty()) {
+            return;
+        }
+
+        /* Frames in flight may still be executing the previous plan */
+        device.getDeletionQueue().enqueue([&device = device, views, transient_images, allocations, render_passes, framebuffers]() {
+            for (const auto framebuffer : framebuffers) {
+                device.getDevice().destroyFramebuffer(framebuffer, nullptr);
+            }
+            for (const auto render_pass : render_passes) {
+                device.getDevice().destroyRenderPass(render_pass, nullptr);
+            }
+            for (const auto view : views) {
+                device.getDevice().destroyImageView(view, nullptr);
+            }
+            for (const auto image : transient_images) {
+                device.getDevice().destroyImage(image, nullptr);
+            }
+            for (const auto allocation : allocations) {
+                vmaFreeMemory(device.getAllocator(), allocation);
+            }
+        });
+    }
+
+    bool RenderGraph::isDepthFormat(vk::Format format) {
+        switch (format) {
+            case vk::Format::eD16Unorm:
+            case vk::Format::eD16UnormS8Uint:
+            case vk::Format::eD24UnormS8Uint:
+            case vk::Format::eD32Sfloat:
+            case vk::Format::eD32SfloatS8Uint:
+            case vk::Format::eX8D24UnormPack32:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    vk::ImageAspectFlags RenderGraph::aspectMask(uint32_t image) const {
+        const auto format = images[image].desc.format;
+        if (!isDepthFormat(format)) {
+            return vk::ImageAspectFlagBits::eColor;
+        }
+
+        vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eDepth;
+        if (format == vk::Format::eD16UnormS8Uint || format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint) {
+            aspect |= vk::ImageAspectFlagBits::eStencil;
+        }
+        return aspect;
+    }
+
+}
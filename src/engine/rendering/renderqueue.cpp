@@ -0,0 +1,124 @@
+#include "engine/rendering/renderqueue.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace muon {
+
+    namespace {
+        constexpr uint32_t MESH_SHIFT = 0;
+        constexpr uint32_t MATERIAL_SHIFT = MESH_SHIFT + RenderQueue::MESH_BITS;
+        constexpr uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + RenderQueue::MATERIAL_BITS;
+        constexpr uint32_t STATE_BITS = PIPELINE_SHIFT + RenderQueue::PIPELINE_BITS;
+        constexpr uint32_t TRANSLUCENCY_SHIFT = STATE_BITS + RenderQueue::DEPTH_BITS;
+        constexpr uint32_t PASS_SHIFT = TRANSLUCENCY_SHIFT + 1;
+
+        static_assert(PASS_SHIFT + RenderQueue::PASS_BITS == 64, "Sort key fields must fill 64 bits");
+
+        /* 11 bit digits cover the key in six passes with cache sized histograms */
+        constexpr uint32_t RADIX_BITS = 11;
+        constexpr uint32_t RADIX_SIZE = 1 << RADIX_BITS;
+        constexpr uint32_t RADIX_MASK = RADIX_SIZE - 1;
+        constexpr uint32_t RADIX_PASSES = (64 + RADIX_BITS - 1) / RADIX_BITS;
+        constexpr size_t COMPARISON_SORT_THRESHOLD = 2048;
+
+        constexpr uint64_t mask(uint32_t bits) {
+            return (uint64_t{1} << bits) - 1;
+        }
+
+        uint64_t stateBits(uint32_t pipeline, uint32_t material, uint32_t mesh) {
+            return (pipeline & mask(RenderQueue::PIPELINE_BITS)) << PIPELINE_SHIFT
+                 | (material & mask(RenderQueue::MATERIAL_BITS)) << MATERIAL_SHIFT
+                 | (mesh & mask(RenderQueue::MESH_BITS)) << MESH_SHIFT;
+        }
+    }
+
+    uint64_t RenderQueue::opaqueKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+        return (pass & mask(PASS_BITS)) << PASS_SHIFT
+             | stateBits(pipeline, material, mesh) << DEPTH_BITS
+             | quantizeDepth(depth);
+    }
+
+    uint64_t RenderQueue::transparentKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, float depth) {
+        return (pass & mask(PASS_BITS)) << PASS_SHIFT
+             | uint64_t{1} << TRANSLUCENCY_SHIFT
+             | (~static_cast<uint64_t>(quantizeDepth(depth)) & mask(DEPTH_BITS)) << STATE_BITS
+             | stateBits(pipeline, material, mesh);
+    }
+
+    bool RenderQueue::isTransparent(uint64_t key) {
+        return (key >> TRANSLUCENCY_SHIFT) & 1;
+    }
+
+    uint64_t RenderQueue::stateKey(uint64_t key) {
+        if (isTransparent(key)) {
+            return key & ~(mask(DEPTH_BITS) << STATE_BITS);
+        }
+        return key & ~mask(DEPTH_BITS);
+    }
+
+    uint32_t RenderQueue::quantizeDepth(float depth) {
+        /* Bits of a positive float order like the float, keep the top 23 of 31 */
+        if (!(depth > 0.0f)) {
+            return 0;
+        }
+        return std::bit_cast<uint32_t>(depth) >> (31 - DEPTH_BITS);
+    }
+
+    void RenderQueue::sort() {
+        const size_t count = packets.size();
+        if (count < 2) {
+            return;
+        }
+
+        /* Small queues are cheaper to sort than to histogram, payload breaks ties for determinism */
+        if (count <= COMPARISON_SORT_THRESHOLD) {
+            std::sort(packets.begin(), packets.end(), [](const Packet &a, const Packet &b) {
+                return a.key < b.key || (a.key == b.key && a.payload < b.payload);
+            });
+            return;
+        }
+
+        /* Histograms for every digit in one pass over the keys */
+        std::array<std::array<uint32_t, RADIX_SIZE>, RADIX_PASSES> histograms{};
+        for (const auto &packet : packets) {
+            for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+                histograms[pass][(packet.key >> (pass * RADIX_BITS)) & RADIX_MASK]++;
+            }
+        }
+
+        scratch.resize(count);
+        Packet *src = packets.data();
+        Packet *dst = scratch.data();
+
+        for (uint32_t pass = 0; pass < RADIX_PASSES; pass++) {
+            const uint32_t shift = pass * RADIX_BITS;
+            auto &histogram = histograms[pass];
+
+            /* Every key shares this digit, the pass would not move anything */
+            if (histogram[(src[0].key >> shift) & RADIX_MASK] == count) {
+                continue;
+            }
+
+            uint32_t offset = 0;
+            for (auto &bucket : histogram) {
+                uint32_t bucket_count = bucket;
+                bucket = offset;
+                offset += bucket_count;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                const uint32_t digit = (src[i].key >> shift) & RADIX_MASK;
+                dst[histogram[digit]++] = src[i];
+            }
+
+            std::swap(src, dst);
+        }
+
+        if (src != packets.data()) {
+            packets.swap(scratch);
+        }
+    }
+
+}
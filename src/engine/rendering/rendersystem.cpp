@@ -1,12 +1,19 @@
 #include "engine/rendering/rendersystem.hpp"
 
+#include <algorithm>
+#include <cstring>
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/trigonometric.hpp>
 #include <glm/ext/matrix_transform.hpp>
 
-#include "utils/exitcode.hpp"
+#include "engine/vulkan/bindlesstable.hpp"
+#include "engine/vulkan/geometryarena.hpp"
+#include "engine/vulkan/layoutcache.hpp"
+#include "engine/vulkan/shaderreflection.hpp"
+#include "utils/profiler.hpp"
 
 namespace muon {
 
@@ -24,93 +31,287 @@ namespace muon {
 
     struct SimplePushConstantData {
         glm::mat4 model{1.0f};
+        uint32_t texture_index{0};
     };
 
-    RenderSystem3D::RenderSystem3D(Device &device, vk::RenderPass render_pass, vk::DescriptorSetLayout descriptor_set_layout) : device{device} {
+    RenderSystem3D::RenderSystem3D(Device &device, PipelineRegistry &pipeline_registry, const PipelineTarget &target, vk::DescriptorSetLayout descriptor_set_layout, FrameAllocator &frame_allocator, DescriptorCache &descriptor_cache, DescriptorAllocator &descriptor_allocator)
+        : device{device}, pipeline_registry{pipeline_registry}, frame_allocator{frame_allocator}, descriptor_cache{descriptor_cache}, descriptor_allocator{descriptor_allocator} {
         createPipelineLayout(descriptor_set_layout);
-        createPipeline(render_pass);
+        createPipelines(target);
     }
 
-    RenderSystem3D::~RenderSystem3D() {
-        vkDestroyPipelineLayout(device.getDevice(), pipeline_layout, nullptr);
-    }
+    RenderSystem3D::~RenderSystem3D() = default;
 
     void RenderSystem3D::renderModel(FrameInfo &frame_info, Model &model) {
-        pipeline->bind(frame_info.command_buffer);
-
-        frame_info.command_buffer.bindDescriptorSets(
-            vk::PipelineBindPoint::eGraphics,
-            pipeline_layout,
-            0,
-            1,
-            &frame_info.descriptor_set,
-            0,
-            nullptr
-        );
-
         // transform = glm::rotate(transform, glm::radians(1.0f), {0.0f, 1.0f, 0.0f});
+        renderModel(frame_info, model, transform);
+    }
 
-        SimplePushConstantData push{};
-        push.model = transform;
+    void RenderSystem3D::renderModel(FrameInfo &frame_info, Model &model, glm::mat4 transform, uint32_t texture_index) {
+        recordDraw(frame_info, frame_info.recorder, {&model, transform, texture_index, 1, 0, 0, false});
+    }
 
-        auto shader_stages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
-        frame_info.command_buffer.pushConstants(pipeline_layout, shader_stages, 0, sizeof(SimplePushConstantData), &push);
+    void RenderSystem3D::submit(FrameInfo &frame_info, Model &model, const glm::mat4 &transform, BlendMode blend_mode, uint32_t texture_index) {
+        auto [mesh, inserted] = mesh_ids.try_emplace(&model, static_cast<uint32_t>(mesh_ids.size()));
 
-        model.bind(frame_info.command_buffer);
-        model.draw(frame_info.command_buffer);
+        /* View space distance along the camera's forward axis */
+        const float depth = -(frame_info.camera.getView() * transform[3]).z;
+
+        const auto payload = static_cast<uint32_t>(queued_draws.size());
+        queued_draws.push_back({&model, transform, texture_index});
+
+        if (blend_mode == BlendMode::Transparent) {
+            render_queue.push(RenderQueue::transparentKey(0, PIPELINE_DEFAULT, 0, mesh->second, depth), payload);
+        } else {
+            render_queue.push(RenderQueue::opaqueKey(0, PIPELINE_INSTANCED, 0, mesh->second, depth), payload);
+        }
     }
 
-    void RenderSystem3D::renderModel(FrameInfo &frame_info, Model &model, glm::mat4 transform) {
-        pipeline->bind(frame_info.command_buffer);
+    void RenderSystem3D::prepare(FrameInfo &frame_info) {
+        MUON_PROFILE_SCOPE("RenderSystem3D::prepare");
+        render_queue.sort();
+        draw_ops.clear();
 
-        frame_info.command_buffer.bindDescriptorSets(
-            vk::PipelineBindPoint::eGraphics,
-            pipeline_layout,
-            0,
-            1,
-            &frame_info.descriptor_set,
-            0,
-            nullptr
-        );
+        /* Opaque packets sort first, instance groups form in key order */
+        auto packets = render_queue.getPackets();
+        size_t i = 0;
+        for (; i < packets.size() && !RenderQueue::isTransparent(packets[i].key); i++) {
+            const auto &draw = queued_draws[packets[i].payload];
+            addInstance(*draw.model, draw.transform, draw.texture_index);
+        }
+        prepareInstances();
 
-        SimplePushConstantData push{};
-        push.model = transform;
+        for (; i < packets.size(); i++) {
+            const auto &draw = queued_draws[packets[i].payload];
+            draw_ops.push_back({draw.model, draw.transform, draw.texture_index, 1, 0, 0, false});
+        }
+
+        render_queue.clear();
+        queued_draws.clear();
+        mesh_ids.clear();
+    }
 
-        auto shader_stages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
-        frame_info.command_buffer.pushConstants(pipeline_layout, shader_stages, 0, sizeof(SimplePushConstantData), &push);
+    void RenderSystem3D::record(const FrameInfo &frame_info, CommandRecorder &recorder, uint32_t begin, uint32_t end) const {
+        for (uint32_t i = begin; i < end; i++) {
+            recordDraw(frame_info, recorder, draw_ops[i]);
+        }
+    }
 
-        model.bind(frame_info.command_buffer);
-        model.draw(frame_info.command_buffer);
+    void RenderSystem3D::flush(FrameInfo &frame_info) {
+        prepare(frame_info);
+        record(frame_info, frame_info.recorder, 0, getDrawCount());
     }
 
-    void RenderSystem3D::createPipelineLayout(vk::DescriptorSetLayout descriptor_set_layout) {
-        vk::PushConstantRange push_constant_range{};
-        push_constant_range.stageFlags = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
-        push_constant_range.offset = 0;
-        push_constant_range.size = sizeof(SimplePushConstantData);
+    void RenderSystem3D::renderText(const FrameInfo &frame_info, CommandRecorder &recorder, const TextRenderer &text_renderer) const {
+        const Pipeline *target = pipeline.get();
+        if (target == nullptr) {
+            return;
+        }
+
+        bindGlobalState(frame_info, recorder, target->getPipeline(), pipeline_layout);
+        recorder.bindVertexBuffer(text_renderer.getVertexBuffer());
+        recorder.bindIndexBuffer(text_renderer.getIndexBuffer());
+
+        for (const auto &label : text_renderer.getLabels()) {
+            if (label.glyph_count == 0) {
+                continue;
+            }
 
-        std::vector<vk::DescriptorSetLayout> descriptor_set_layouts{descriptor_set_layout};
+            SimplePushConstantData push{};
+            push.model = label.transform;
+            push.texture_index = text_renderer.getTextureIndex();
+            recorder.pushConstants(pipeline_layout, push_constant_stages, 0, sizeof(SimplePushConstantData), &push);
 
-        vk::PipelineLayoutCreateInfo pipeline_layout_info{};
-        pipeline_layout_info.sType =  vk::StructureType::ePipelineLayoutCreateInfo;
-        pipeline_layout_info.setLayoutCount = static_cast<uint32_t>(descriptor_set_layouts.size());
-        pipeline_layout_info.pSetLayouts = descriptor_set_layouts.data();
-        pipeline_layout_info.pushConstantRangeCount = 1;
-        pipeline_layout_info.pPushConstantRanges = &push_constant_range;
+            /* Shared quad indices, the label's slot is picked by the vertex offset */
+            recorder.drawIndexed(label.glyph_count * 6, 1, 0, static_cast<int32_t>(label.first_glyph * 4), 0);
+        }
+    }
 
-        if (device.getDevice().createPipelineLayout(&pipeline_layout_info, nullptr, &pipeline_layout) != vk::Result::eSuccess) {
-            spdlog::error("Failed to create pipeline layout");
-            exit(exitcode::FAILURE);
+    void RenderSystem3D::addInstance(Model &model, const glm::mat4 &transform, uint32_t texture_index) {
+        auto [it, inserted] = group_lookup.try_emplace(&model, static_cast<uint32_t>(instance_groups.size()));
+        if (inserted) {
+            instance_groups.push_back({&model, 0, 0});
         }
+
+        instance_groups[it->second].count++;
+        instances.push_back({it->second, transform, texture_index});
+    }
+
+    void RenderSystem3D::renderInstances(FrameInfo &frame_info) {
+        const auto first = static_cast<uint32_t>(draw_ops.size());
+        prepareInstances();
+        record(frame_info, frame_info.recorder, first, getDrawCount());
+        draw_ops.resize(first);
     }
 
-    void RenderSystem3D::createPipeline(vk::RenderPass render_pass) {
+    void RenderSystem3D::prepareInstances() {
+        instanced_draw_count = 0;
+        overflow_sets.clear();
+
+        if (instances.empty()) {
+            return;
+        }
+
+        /* Counting sort by model so every group's instance data is contiguous */
+        uint32_t offset = 0;
+        for (auto &group : instance_groups) {
+            group.first = offset;
+            offset += group.count;
+        }
+
+        sorted_instances.resize(instances.size());
+        std::vector<uint32_t> cursors(instance_groups.size());
+        for (size_t i = 0; i < instance_groups.size(); i++) {
+            cursors[i] = instance_groups[i].first;
+        }
+        for (const auto &instance : instances) {
+            sorted_instances[cursors[instance.group]++] = {instance.transform, instance.texture_index, {}};
+        }
+
+        const auto total = static_cast<uint32_t>(sorted_instances.size());
+        size_t group_index = 0;
+        for (uint32_t batch_begin = 0; batch_begin < total; batch_begin += MAX_INSTANCES_PER_BATCH) {
+            const uint32_t batch_end = std::min(batch_begin + MAX_INSTANCES_PER_BATCH, total);
+
+            /* Sized to the batch, the allocator keeps the descriptor's full range inside the buffer */
+            const vk::DeviceSize batch_size = (batch_end - batch_begin) * sizeof(InstanceData);
+            auto slice = frame_allocator.allocateDynamic(batch_size, MAX_INSTANCES_PER_BATCH * sizeof(InstanceData));
+            memcpy(slice.mapped, &sorted_instances[batch_begin], batch_size);
+            auto dynamic_offset = static_cast<uint32_t>(slice.offset);
+            const vk::DescriptorSet instance_set = instanceSet(slice.buffer);
+
+            /* Groups may straddle batches, each batch draws its share of them */
+            while (group_index < instance_groups.size()) {
+                const auto &group = instance_groups[group_index];
+                const uint32_t draw_begin = std::max(group.first, batch_begin);
+                const uint32_t draw_end = std::min(group.first + group.count, batch_end);
+
+                draw_ops.push_back({group.model, glm::mat4{1.0f}, 0, draw_end - draw_begin, draw_begin - batch_begin, dynamic_offset, true, instance_set});
+                instanced_draw_count++;
+
+                if (group.first + group.count > batch_end) {
+                    break;
+                }
+                group_index++;
+            }
+        }
+
+        group_lookup.clear();
+        instance_groups.clear();
+        instances.clear();
+    }
+
+    vk::DescriptorSet RenderSystem3D::instanceSet(vk::Buffer buffer) {
+        if (buffer == frame_allocator.getBuffer()) {
+            return instance_descriptor_set;
+        }
+
+        for (const auto &[overflow_buffer, set] : overflow_sets) {
+            if (overflow_buffer == buffer) {
+                return set;
+            }
+        }
+
+        /* Overflow blocks can be replaced between frames, so their sets only live for this one */
+        vk::DescriptorBufferInfo buffer_info{buffer, 0, MAX_INSTANCES_PER_BATCH * sizeof(InstanceData)};
+        vk::DescriptorSet set{};
+        DescriptorWriter(*instance_set_layout, descriptor_allocator, true)
+            .writeToBuffer(0, &buffer_info)
+            .build(set);
+        overflow_sets.emplace_back(buffer, set);
+        return set;
+    }
+
+    void RenderSystem3D::recordDraw(const FrameInfo &frame_info, CommandRecorder &recorder, const DrawOp &op) const {
+        const Pipeline *target = op.instanced ? instanced_pipeline.get() : pipeline.get();
+        if (target == nullptr) {
+            return;
+        }
+
+        bindGlobalState(frame_info, recorder, target->getPipeline(), pipeline_layout);
+
+        if (op.instanced) {
+            recorder.bindDescriptorSet(pipeline_layout, 1, op.instance_set, {&op.dynamic_offset, 1});
+        } else {
+            SimplePushConstantData push{};
+            push.model = op.transform;
+            push.texture_index = op.texture_index;
+
+            recorder.pushConstants(pipeline_layout, push_constant_stages, 0, sizeof(SimplePushConstantData), &push);
+        }
+
+        /* Unchanged state is filtered by the recorder, so binding per draw is cheap */
+        op.model->bind(recorder);
+        op.model->draw(recorder, op.instance_count, op.first_instance);
+    }
+
+    void RenderSystem3D::bindGlobalState(const FrameInfo &frame_info, CommandRecorder &recorder, vk::Pipeline pipeline, vk::PipelineLayout layout) const {
+        recorder.bindPipeline(pipeline);
+        recorder.bindDescriptorSet(layout, 0, frame_info.descriptor_set, {&frame_info.global_ubo_offset, 1});
+        /* Update after bind, so textures registered mid frame are visible without rebinding */
+        recorder.bindDescriptorSet(layout, 2, device.getBindlessTable().getDescriptorSet());
+    }
+
+    void RenderSystem3D::createPipelineLayout(vk::DescriptorSetLayout global_set_layout) {
+        const ShaderReflection vert{"assets/shaders/shader.vert.spv"};
+        const ShaderReflection instanced_vert{"assets/shaders/instanced.vert.spv"};
+        const ShaderReflection frag{"assets/shaders/text.frag.spv"};
+
+        /* One push range covers both pipelines' stages, so they can share the layout */
+        const auto push_constant_ranges = ShaderReflection::mergePushConstantRanges({&vert, &instanced_vert, &frag});
+        for (const auto &range : push_constant_ranges) {
+            push_constant_stages |= range.stageFlags;
+        }
+
+        /* Set 0 is the app's global set, buffers in set 1 are addressed by dynamic offsets into the frame allocator */
+        auto instance_bindings = ShaderReflection::mergeSetBindings({&instanced_vert, &frag}, 1);
+        for (auto &binding : instance_bindings) {
+            if (binding.descriptorType == vk::DescriptorType::eStorageBuffer) {
+                binding.descriptorType = vk::DescriptorType::eStorageBufferDynamic;
+            } else if (binding.descriptorType == vk::DescriptorType::eUniformBuffer) {
+                binding.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+            }
+        }
+        createInstanceDescriptors(instance_bindings);
+
+        /*
+            Set 2 is the bindless texture table. Both pipelines use one layout that
+            declares the instance set, so every set survives pipeline switches and
+            the non-instanced pipeline simply never reads set 1.
+        */
+        const auto bindless_set_layout = device.getBindlessTable().getDescriptorSetLayout();
+        pipeline_layout = device.getLayoutCache().getPipelineLayout({global_set_layout, instance_set_layout->getDescriptorSetLayout(), bindless_set_layout}, push_constant_ranges);
+    }
+
+    void RenderSystem3D::createInstanceDescriptors(const std::vector<vk::DescriptorSetLayoutBinding> &instance_bindings) {
+        auto builder = DescriptorSetLayout::Builder(device);
+        for (const auto &binding : instance_bindings) {
+            builder.addBinding(binding.binding, binding.descriptorType, binding.stageFlags, binding.descriptorCount);
+        }
+        instance_set_layout = builder.build();
+
+        /* One set serves every frame, the frame allocator slice is picked by the dynamic offset */
+        auto buffer_info = frame_allocator.descriptorInfo(MAX_INSTANCES_PER_BATCH * sizeof(InstanceData));
+        DescriptorWriter(*instance_set_layout, descriptor_cache)
+            .writeToBuffer(0, &buffer_info)
+            .build(instance_descriptor_set);
+    }
+
+    void RenderSystem3D::createPipelines(const PipelineTarget &target) {
         PipelineConfigInfo pipeline_config{};
         Pipeline::defaultPipelineConfigInfo(pipeline_config);
-        pipeline_config.render_pass= render_pass;
+        target.apply(pipeline_config);
         pipeline_config.pipeline_layout = pipeline_layout;
 
-        pipeline = std::make_unique<Pipeline>(device, "assets/shaders/shader.vert.spv", "assets/shaders/text.frag.spv", pipeline_config);
+        pipeline = pipeline_registry.request("assets/shaders/shader.vert.spv", "assets/shaders/text.frag.spv", pipeline_config);
+
+        /* Same push constant range and set 0, so the global set stays bound across the switch */
+        PipelineConfigInfo instanced_config{};
+        Pipeline::defaultPipelineConfigInfo(instanced_config);
+        target.apply(instanced_config);
+        instanced_config.pipeline_layout = pipeline_layout;
+
+        instanced_pipeline = pipeline_registry.request("assets/shaders/instanced.vert.spv", "assets/shaders/text.frag.spv", instanced_config);
     }
 
 }
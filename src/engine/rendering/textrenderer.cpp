@@ -1 +1,212 @@
 #include "engine/rendering/textrenderer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/exitcode.hpp"
+#include "utils/profiler.hpp"
+
+namespace muon {
+
+    namespace {
+
+        constexpr uint32_t VERTICES_PER_GLYPH = 4;
+        constexpr uint32_t INDICES_PER_GLYPH = 6;
+
+    }
+
+    TextRenderer::TextRenderer(Device &device, Font &font, uint32_t frame_count) : device{device}, font{font}, frames(frame_count) {
+        for (auto &frame : frames) {
+            frame.vertex_buffer = std::make_unique<Buffer>(
+                device,
+                sizeof(Model::Vertex),
+                MAX_GLYPHS * VERTICES_PER_GLYPH,
+                vk::BufferUsageFlagBits::eVertexBuffer,
+                vk::MemoryPropertyFlagBits::eHostVisible
+            );
+        }
+
+        createIndexBuffer();
+    }
+
+    TextRenderer::LabelId TextRenderer::createLabel(uint32_t max_glyphs, const glm::mat4 &transform) {
+        if (next_glyph + max_glyphs > MAX_GLYPHS) {
+            spdlog::error("Text renderer is out of glyph slots, {} in use", next_glyph);
+            exit(exitcode::FAILURE);
+        }
+
+        const auto id = static_cast<LabelId>(labels.size());
+        labels.push_back({transform, next_glyph, max_glyphs});
+        next_glyph += max_glyphs;
+
+        for (auto &frame : frames) {
+            frame.label_versions.push_back(0);
+        }
+
+        return id;
+    }
+
+    void TextRenderer::setText(LabelId label, std::string_view text) {
+        auto &target = labels[label];
+        if (target.text == text) {
+            return;
+        }
+
+        MUON_PROFILE_SCOPE("TextRenderer::setText");
+
+        target.text = text;
+        layoutText(target);
+        target.version++;
+
+        /* This frame's fence has signalled, its copy can be rewritten now */
+        upload(frames[current_frame], label);
+    }
+
+    void TextRenderer::setTransform(LabelId label, const glm::mat4 &transform) {
+        labels[label].transform = transform;
+    }
+
+    void TextRenderer::beginFrame(uint32_t frame_index) {
+        current_frame = frame_index;
+
+        auto &frame = frames[frame_index];
+        for (LabelId id = 0; id < labels.size(); id++) {
+            if (frame.label_versions[id] != labels[id].version) {
+                upload(frame, id);
+            }
+        }
+    }
+
+    float TextRenderer::getLineHeight() const {
+        const auto &metrics = font.getFontGeometry().getMetrics();
+        return static_cast<float>(metrics.lineHeight / (metrics.ascenderY - metrics.descenderY));
+    }
+
+    void TextRenderer::createIndexBuffer() {
+        index_buffer = std::make_unique<Buffer>(
+            device,
+            sizeof(uint32_t),
+            MAX_GLYPHS * INDICES_PER_GLYPH,
+            vk::BufferUsageFlagBits::eIndexBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible
+        );
+
+        /* Quads relative to the label's first vertex, which drawIndexed adds as the vertex offset */
+        std::vector<uint32_t> indices{};
+        indices.reserve(MAX_GLYPHS * INDICES_PER_GLYPH);
+        for (uint32_t glyph = 0; glyph < MAX_GLYPHS; glyph++) {
+            const uint32_t first = glyph * VERTICES_PER_GLYPH;
+            indices.insert(indices.end(), {first + 0, first + 1, first + 2, first + 2, first + 3, first + 0});
+        }
+
+        index_buffer->writeToBuffer(indices.data());
+        if (index_buffer->flush() != vk::Result::eSuccess) {
+            spdlog::warn("Failed to flush text index buffer");
+        }
+    }
+
+    void TextRenderer::layoutText(Label &label) const {
+        const auto &font_geometry = font.getFontGeometry();
+        const auto &metrics = font_geometry.getMetrics();
+        const auto atlas = font.getAtlas();
+
+        const std::string &text = label.text;
+        label.vertices.clear();
+
+        double x = 0.0;
+        double y = 0.0;
+        const double fs_scale = 1.0 / (metrics.ascenderY - metrics.descenderY);
+
+        const float space_glyph_advance = font_geometry.getGlyph(' ')->getAdvance();
+        const float texel_width = 1.0f / atlas->getWidth();
+        const float texel_height = 1.0f / atlas->getHeight();
+
+        for (size_t i = 0; i < text.size() && label.vertices.size() < label.max_glyphs * VERTICES_PER_GLYPH; i++) {
+            const char c = text[i];
+            if (c == '\r') {
+                continue;
+            }
+
+            if (c == '\n') {
+                x = 0;
+                y -= fs_scale * metrics.lineHeight;
+                continue;
+            }
+
+            if (c == ' ') {
+                float advance = space_glyph_advance;
+                if (i < text.size() - 1) {
+                    double d_advance;
+                    font_geometry.getAdvance(d_advance, c, text[i + 1]);
+                    advance = static_cast<float>(d_advance);
+                }
+
+                x += fs_scale * advance;
+                continue;
+            }
+
+            auto glyph = font_geometry.getGlyph(c);
+            if (!glyph) {
+                glyph = font_geometry.getGlyph('?');
+            }
+            if (!glyph) {
+                break;
+            }
+
+            double al, ab, ar, at;
+            glyph->getQuadAtlasBounds(al, ab, ar, at);
+            glm::vec2 tex_coord_min{static_cast<float>(al), static_cast<float>(ab)};
+            glm::vec2 tex_coord_max{static_cast<float>(ar), static_cast<float>(at)};
+
+            double pl, pb, pr, pt;
+            glyph->getQuadPlaneBounds(pl, pb, pr, pt);
+            glm::vec2 quad_min{static_cast<float>(pl), static_cast<float>(pb)};
+            glm::vec2 quad_max{static_cast<float>(pr), static_cast<float>(pt)};
+
+            quad_min *= fs_scale;
+            quad_max *= fs_scale;
+            quad_min += glm::vec2(x, y);
+            quad_max += glm::vec2(x, y);
+
+            /* Flip the Y for Vulkan! */
+            quad_min.y = -quad_min.y;
+            quad_max.y = -quad_max.y;
+
+            tex_coord_min *= glm::vec2{texel_width, texel_height};
+            tex_coord_max *= glm::vec2{texel_width, texel_height};
+
+            const glm::vec3 colour{1.0f, 1.0f, 1.0f};
+            const glm::vec3 normal{0.0f, 0.0f, 0.0f};
+            label.vertices.push_back({glm::vec3{quad_min.x, quad_max.y, 0.0f}, colour, normal, glm::vec2{tex_coord_min.x, tex_coord_max.y}}); // Top left
+            label.vertices.push_back({glm::vec3{quad_min, 0.0f}, colour, normal, glm::vec2{tex_coord_min.x, tex_coord_min.y}});               // Bottom left
+            label.vertices.push_back({glm::vec3{quad_max.x, quad_min.y, 0.0f}, colour, normal, glm::vec2{tex_coord_max.x, tex_coord_min.y}}); // Bottom right
+            label.vertices.push_back({glm::vec3{quad_max, 0.0f}, colour, normal, glm::vec2{tex_coord_max.x, tex_coord_max.y}});               // Top right
+
+            if (i < text.size() - 1) {
+                double advance = glyph->getAdvance();
+                font_geometry.getAdvance(advance, c, text[i + 1]);
+                x += fs_scale * advance;
+            }
+        }
+
+        label.glyph_count = static_cast<uint32_t>(label.vertices.size() / VERTICES_PER_GLYPH);
+    }
+
+    void TextRenderer::upload(FrameBuffers &frame, LabelId id) {
+        const auto &label = labels[id];
+        const vk::DeviceSize offset = static_cast<vk::DeviceSize>(label.first_glyph) * VERTICES_PER_GLYPH * sizeof(Model::Vertex);
+        const vk::DeviceSize size = label.vertices.size() * sizeof(Model::Vertex);
+
+        if (size > 0) {
+            memcpy(static_cast<char *>(frame.vertex_buffer->getMappedMemory()) + offset, label.vertices.data(), size);
+            if (frame.vertex_buffer->flush(size, offset) != vk::Result::eSuccess) {
+                spdlog::warn("Failed to flush text vertex buffer");
+            }
+        }
+
+        frame.label_versions[id] = label.version;
+    }
+
+}
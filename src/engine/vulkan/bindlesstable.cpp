@@ -0,0 +1,132 @@
+#include "engine/vulkan/bindlesstable.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "engine/vulkan/device.hpp"
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    BindlessTable::BindlessTable(Device &device) : device{device} {
+        /* Update after bind descriptors have their own, usually much higher, limits */
+        const auto &limits = device.getDescriptorIndexingProperties();
+        capacity = std::min({
+            MAX_TEXTURES,
+            limits.maxDescriptorSetUpdateAfterBindSampledImages,
+            limits.maxDescriptorSetUpdateAfterBindSamplers,
+            limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            limits.maxPerStageDescriptorUpdateAfterBindSamplers,
+        });
+
+        createDescriptorSetLayout();
+        createDescriptorSet();
+
+        spdlog::debug("Bindless texture table: {} slots", capacity);
+    }
+
+    BindlessTable::~BindlessTable() {
+        device.getDevice().destroyDescriptorPool(descriptor_pool, nullptr);
+        device.getDevice().destroyDescriptorSetLayout(descriptor_set_layout, nullptr);
+    }
+
+    uint32_t BindlessTable::addTexture(const vk::DescriptorImageInfo &image_info) {
+        std::lock_guard lock{mutex};
+
+        uint32_t index;
+        if (!free_indices.empty()) {
+            index = free_indices.back();
+            free_indices.pop_back();
+        } else if (next_index < capacity) {
+            index = next_index++;
+        } else {
+            spdlog::error("Bindless texture table is full, {} slots", capacity);
+            exit(exitcode::FAILURE);
+        }
+
+        vk::WriteDescriptorSet write{};
+        write.sType = vk::StructureType::eWriteDescriptorSet;
+        write.dstSet = descriptor_set;
+        write.dstBinding = 0;
+        write.dstArrayElement = index;
+        write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        write.descriptorCount = 1;
+        write.pImageInfo = &image_info;
+
+        /* Host access to the set is externally synchronised by the lock */
+        device.getDevice().updateDescriptorSets(1, &write, 0, nullptr);
+
+        return index;
+    }
+
+    void BindlessTable::removeTexture(uint32_t index) {
+        if (index == INVALID_INDEX) {
+            return;
+        }
+
+        /* The slot keeps its stale descriptor, partially bound lets it sit unused until rewritten */
+        std::lock_guard lock{mutex};
+        free_indices.push_back(index);
+    }
+
+    uint32_t BindlessTable::getTextureCount() const {
+        std::lock_guard lock{mutex};
+        return next_index - static_cast<uint32_t>(free_indices.size());
+    }
+
+    void BindlessTable::createDescriptorSetLayout() {
+        vk::DescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        binding.descriptorCount = capacity;
+        binding.stageFlags = vk::ShaderStageFlagBits::eAllGraphics;
+
+        const vk::DescriptorBindingFlagsEXT binding_flags = vk::DescriptorBindingFlagBitsEXT::eUpdateAfterBind | vk::DescriptorBindingFlagBitsEXT::ePartiallyBound;
+
+        vk::DescriptorSetLayoutBindingFlagsCreateInfoEXT binding_flags_info{};
+        binding_flags_info.sType = vk::StructureType::eDescriptorSetLayoutBindingFlagsCreateInfoEXT;
+        binding_flags_info.bindingCount = 1;
+        binding_flags_info.pBindingFlags = &binding_flags;
+
+        vk::DescriptorSetLayoutCreateInfo layout_info{};
+        layout_info.sType = vk::StructureType::eDescriptorSetLayoutCreateInfo;
+        layout_info.pNext = &binding_flags_info;
+        layout_info.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPoolEXT;
+        layout_info.bindingCount = 1;
+        layout_info.pBindings = &binding;
+
+        if (device.getDevice().createDescriptorSetLayout(&layout_info, nullptr, &descriptor_set_layout) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create bindless descriptor set layout");
+            exit(exitcode::FAILURE);
+        }
+    }
+
+    void BindlessTable::createDescriptorSet() {
+        vk::DescriptorPoolSize pool_size{vk::DescriptorType::eCombinedImageSampler, capacity};
+
+        vk::DescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = vk::StructureType::eDescriptorPoolCreateInfo;
+        pool_info.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBindEXT;
+        pool_info.maxSets = 1;
+        pool_info.poolSizeCount = 1;
+        pool_info.pPoolSizes = &pool_size;
+
+        if (device.getDevice().createDescriptorPool(&pool_info, nullptr, &descriptor_pool) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create bindless descriptor pool");
+            exit(exitcode::FAILURE);
+        }
+
+        vk::DescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = vk::StructureType::eDescriptorSetAllocateInfo;
+        alloc_info.descriptorPool = descriptor_pool;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &descriptor_set_layout;
+
+        if (device.getDevice().allocateDescriptorSets(&alloc_info, &descriptor_set) != vk::Result::eSuccess) {
+            spdlog::error("Failed to allocate bindless descriptor set");
+            exit(exitcode::FAILURE);
+        }
+    }
+
+}
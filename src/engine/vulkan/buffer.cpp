@@ -1,29 +1,41 @@
 #include "engine/vulkan/buffer.hpp"
 
+#include "engine/vulkan/deletionqueue.hpp"
+
 namespace muon {
 
     Buffer::Buffer(Device &device, vk::DeviceSize instance_size, uint32_t instance_count,
-        vk::BufferUsageFlags usage_flags, vk::MemoryPropertyFlags memory_property_flags, vk::DeviceSize min_offset_alignment)
-        : device{device}, instance_size{instance_size}, instance_count{instance_count}, usage_flags{usage_flags}, memory_property_flags{memory_property_flags} {
+        vk::BufferUsageFlags usage_flags, vk::MemoryPropertyFlags memory_property_flags, vk::DeviceSize min_offset_alignment, bool shared)
+        : device{device}, instance_size{instance_size}, instance_count{instance_count}, usage_flags{usage_flags}, memory_property_flags{memory_property_flags}, shared{shared} {
 
         alignment_size = getAlignment(instance_size, min_offset_alignment);
         buffer_size = alignment_size * instance_count;
-        device.createBuffer(buffer_size, usage_flags, memory_property_flags, buffer, memory);
+
+        VmaAllocationInfo allocation_info{};
+        device.createBuffer(buffer_size, usage_flags, memory_property_flags, buffer, allocation, &allocation_info, shared);
+
+        mapped = allocation_info.pMappedData;
+        persistently_mapped = mapped != nullptr;
     }
 
     Buffer::~Buffer() {
         unmap();
-        device.getDevice().destroyBuffer(buffer, nullptr);
-        device.getDevice().freeMemory(memory, nullptr);
+        device.getDeletionQueue().enqueue([allocator = device.getAllocator(), buffer = buffer, allocation = allocation]() {
+            vmaDestroyBuffer(allocator, buffer, allocation);
+        });
     }
 
     vk::Result Buffer::map(vk::DeviceSize size, vk::DeviceSize offset) {
-        return device.getDevice().mapMemory(memory, offset, size, vk::MemoryMapFlags{}, &mapped);
+        /* Host visible buffers are mapped on creation, VMA always maps the whole allocation */
+        if (mapped) {
+            return vk::Result::eSuccess;
+        }
+        return static_cast<vk::Result>(vmaMapMemory(device.getAllocator(), allocation, &mapped));
     }
 
     void Buffer::unmap() {
-        if (mapped) {
-            device.getDevice().unmapMemory(memory);
+        if (mapped && !persistently_mapped) {
+            vmaUnmapMemory(device.getAllocator(), allocation);
             mapped = nullptr;
         }
     }
@@ -40,12 +52,8 @@ namespace muon {
     }
 
     vk::Result Buffer::flush(vk::DeviceSize size, vk::DeviceSize offset) {
-        vk::MappedMemoryRange mapped_range = {};
-        mapped_range.sType = vk::StructureType::eMappedMemoryRange;
-        mapped_range.memory = memory;
-        mapped_range.offset = offset;
-        mapped_range.size = size;
-        return device.getDevice().flushMappedMemoryRanges(1, &mapped_range);
+        /* No-op on coherent memory, otherwise VMA aligns the range to nonCoherentAtomSize */
+        return static_cast<vk::Result>(vmaFlushAllocation(device.getAllocator(), allocation, offset, size));
     }
 
     vk::DescriptorBufferInfo Buffer::descriptorInfo(vk::DeviceSize size, vk::DeviceSize offset) {
@@ -53,12 +61,7 @@ namespace muon {
     }
 
     vk::Result Buffer::invalidate(vk::DeviceSize size, vk::DeviceSize offset) {
-        vk::MappedMemoryRange mapped_range = {};
-        mapped_range.sType = vk::StructureType::eMappedMemoryRange;
-        mapped_range.memory = memory;
-        mapped_range.offset = offset;
-        mapped_range.size = size;
-        return device.getDevice().invalidateMappedMemoryRanges(1, &mapped_range);
+        return static_cast<vk::Result>(vmaInvalidateAllocation(device.getAllocator(), allocation, offset, size));
     }
 
 
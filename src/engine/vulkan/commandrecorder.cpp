@@ -0,0 +1,151 @@
+#include "engine/vulkan/commandrecorder.hpp"
+
+#include <algorithm>
+
+namespace muon {
+
+    CommandRecorder::Stats &CommandRecorder::Stats::operator+=(const Stats &other) {
+        pipeline_binds += other.pipeline_binds;
+        pipeline_binds_skipped += other.pipeline_binds_skipped;
+        descriptor_binds += other.descriptor_binds;
+        descriptor_binds_skipped += other.descriptor_binds_skipped;
+        buffer_binds += other.buffer_binds;
+        buffer_binds_skipped += other.buffer_binds_skipped;
+        dynamic_state_sets += other.dynamic_state_sets;
+        dynamic_state_sets_skipped += other.dynamic_state_sets_skipped;
+        draws += other.draws;
+        return *this;
+    }
+
+    void CommandRecorder::begin(vk::CommandBuffer command_buffer) {
+        this->command_buffer = command_buffer;
+        stats = Stats{};
+        invalidate();
+    }
+
+    void CommandRecorder::invalidate() {
+        pipeline = nullptr;
+        sets = {};
+        vertex_buffer = nullptr;
+        vertex_offset = 0;
+        index_buffer = nullptr;
+        index_offset = 0;
+        viewport.reset();
+        scissor.reset();
+    }
+
+    void CommandRecorder::bindPipeline(vk::Pipeline pipeline) {
+        if (this->pipeline == pipeline) {
+            stats.pipeline_binds_skipped++;
+            return;
+        }
+
+        command_buffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+        this->pipeline = pipeline;
+        stats.pipeline_binds++;
+    }
+
+    void CommandRecorder::bindDescriptorSet(vk::PipelineLayout layout, uint32_t set_index, vk::DescriptorSet set, std::span<const uint32_t> dynamic_offsets) {
+        const bool trackable = set_index < MAX_DESCRIPTOR_SETS && dynamic_offsets.size() <= MAX_DYNAMIC_OFFSETS;
+
+        if (trackable) {
+            const auto &bound = sets[set_index];
+            if (bound.layout == layout && bound.set == set && bound.dynamic_offset_count == dynamic_offsets.size()
+                && std::equal(dynamic_offsets.begin(), dynamic_offsets.end(), bound.dynamic_offsets.begin())) {
+                stats.descriptor_binds_skipped++;
+                return;
+            }
+        }
+
+        command_buffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eGraphics,
+            layout,
+            set_index,
+            1,
+            &set,
+            static_cast<uint32_t>(dynamic_offsets.size()),
+            dynamic_offsets.data()
+        );
+        stats.descriptor_binds++;
+
+        /*
+            Binding with another layout may disturb the other sets. Compatibility
+            is not checked here, so any set bound through a different layout is forgotten.
+        */
+        for (auto &bound : sets) {
+            if (bound.layout != layout) {
+                bound = BoundSet{};
+            }
+        }
+
+        if (trackable) {
+            auto &bound = sets[set_index];
+            bound.layout = layout;
+            bound.set = set;
+            bound.dynamic_offset_count = static_cast<uint32_t>(dynamic_offsets.size());
+            std::copy(dynamic_offsets.begin(), dynamic_offsets.end(), bound.dynamic_offsets.begin());
+        }
+    }
+
+    void CommandRecorder::bindVertexBuffer(vk::Buffer buffer, vk::DeviceSize offset) {
+        if (vertex_buffer == buffer && vertex_offset == offset) {
+            stats.buffer_binds_skipped++;
+            return;
+        }
+
+        command_buffer.bindVertexBuffers(0, 1, &buffer, &offset);
+        vertex_buffer = buffer;
+        vertex_offset = offset;
+        stats.buffer_binds++;
+    }
+
+    void CommandRecorder::bindIndexBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::IndexType index_type) {
+        if (index_buffer == buffer && index_offset == offset && this->index_type == index_type) {
+            stats.buffer_binds_skipped++;
+            return;
+        }
+
+        command_buffer.bindIndexBuffer(buffer, offset, index_type);
+        index_buffer = buffer;
+        index_offset = offset;
+        this->index_type = index_type;
+        stats.buffer_binds++;
+    }
+
+    void CommandRecorder::setViewport(const vk::Viewport &viewport) {
+        if (this->viewport == viewport) {
+            stats.dynamic_state_sets_skipped++;
+            return;
+        }
+
+        command_buffer.setViewport(0, 1, &viewport);
+        this->viewport = viewport;
+        stats.dynamic_state_sets++;
+    }
+
+    void CommandRecorder::setScissor(const vk::Rect2D &scissor) {
+        if (this->scissor == scissor) {
+            stats.dynamic_state_sets_skipped++;
+            return;
+        }
+
+        command_buffer.setScissor(0, 1, &scissor);
+        this->scissor = scissor;
+        stats.dynamic_state_sets++;
+    }
+
+    void CommandRecorder::pushConstants(vk::PipelineLayout layout, vk::ShaderStageFlags stages, uint32_t offset, uint32_t size, const void *data) {
+        command_buffer.pushConstants(layout, stages, offset, size, data);
+    }
+
+    void CommandRecorder::draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex, uint32_t first_instance) {
+        command_buffer.draw(vertex_count, instance_count, first_vertex, first_instance);
+        stats.draws++;
+    }
+
+    void CommandRecorder::drawIndexed(uint32_t index_count, uint32_t instance_count, uint32_t first_index, int32_t vertex_offset, uint32_t first_instance) {
+        command_buffer.drawIndexed(index_count, instance_count, first_index, vertex_offset, first_instance);
+        stats.draws++;
+    }
+
+}
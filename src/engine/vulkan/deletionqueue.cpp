@@ -0,0 +1,31 @@
+#include "engine/vulkan/deletionqueue.hpp"
+
+namespace muon {
+
+    DeletionQueue::~DeletionQueue() {
+        flush();
+    }
+
+    void DeletionQueue::enqueue(std::function<void()> &&deleter) {
+        deleters.emplace_back(current_frame, std::move(deleter));
+    }
+
+    void DeletionQueue::collect(uint64_t completed_frame) {
+        /* Tags only ever increase, so the front is always the oldest */
+        while (!deleters.empty() && deleters.front().first <= completed_frame) {
+            auto deleter = std::move(deleters.front().second);
+            deleters.pop_front();
+            deleter();
+        }
+    }
+
+    void DeletionQueue::flush() {
+        /* Deleters may enqueue more work, e.g. a model releasing its arena range */
+        while (!deleters.empty()) {
+            auto deleter = std::move(deleters.front().second);
+            deleters.pop_front();
+            deleter();
+        }
+    }
+
+}
@@ -0,0 +1,150 @@
+#include "engine/vulkan/descriptorallocator.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    namespace {
+
+        /* Covers what the engine's layouts use, roughly in proportion to how often */
+        const std::vector<DescriptorAllocator::PoolSizeRatio> DEFAULT_POOL_RATIOS = {
+            {vk::DescriptorType::eUniformBuffer, 1.0f},
+            {vk::DescriptorType::eUniformBufferDynamic, 1.0f},
+            {vk::DescriptorType::eStorageBuffer, 1.0f},
+            {vk::DescriptorType::eStorageBufferDynamic, 1.0f},
+            {vk::DescriptorType::eCombinedImageSampler, 2.0f},
+            {vk::DescriptorType::eSampledImage, 1.0f},
+            {vk::DescriptorType::eStorageImage, 0.5f},
+        };
+
+    }
+
+    DescriptorAllocator::DescriptorAllocator(Device &device, uint32_t frame_count) : device{device}, ratios{DEFAULT_POOL_RATIOS}, frames(frame_count) {}
+
+    DescriptorAllocator::~DescriptorAllocator() {
+        destroyPools(persistent);
+        for (auto &frame : frames) {
+            destroyPools(frame);
+        }
+    }
+
+    void DescriptorAllocator::beginFrame(uint32_t frame_index) {
+        current_frame = frame_index;
+        auto &frame = frames[frame_index];
+
+        /* Spilling means the pool was too small, one pool fitting the whole frame replaces the lot */
+        if (frame.full.size() + frame.ready.size() > 1) {
+            const uint32_t observed = std::bit_ceil(std::max(frame.allocated_sets, 1u));
+            const uint32_t sets_per_pool = std::min(observed, MAX_SETS_PER_POOL);
+            destroyPools(frame);
+            frame.sets_per_pool = sets_per_pool;
+            spdlog::debug("Transient descriptor pool for frame {} resized to {} sets", frame_index, sets_per_pool);
+        } else {
+            resetPools(frame);
+        }
+
+        frame.allocated_sets = 0;
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate(vk::DescriptorSetLayout layout) {
+        return allocate(persistent, layout);
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocateTransient(vk::DescriptorSetLayout layout) {
+        return allocate(frames[current_frame], layout);
+    }
+
+    size_t DescriptorAllocator::getPoolCount() const {
+        size_t count = persistent.full.size() + persistent.ready.size();
+        for (const auto &frame : frames) {
+            count += frame.full.size() + frame.ready.size();
+        }
+        return count;
+    }
+
+    vk::DescriptorSet DescriptorAllocator::allocate(PoolList &list, vk::DescriptorSetLayout layout) {
+        vk::DescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType = vk::StructureType::eDescriptorSetAllocateInfo;
+        alloc_info.descriptorSetCount = 1;
+        alloc_info.pSetLayouts = &layout;
+
+        vk::DescriptorSet set{};
+        alloc_info.descriptorPool = acquirePool(list);
+        auto result = device.getDevice().allocateDescriptorSets(&alloc_info, &set);
+
+        /* The pool is done with, retry once in a fresh one */
+        if (result == vk::Result::eErrorOutOfPoolMemory || result == vk::Result::eErrorFragmentedPool) {
+            list.full.push_back(list.ready.back());
+            list.ready.pop_back();
+
+            alloc_info.descriptorPool = acquirePool(list);
+            result = device.getDevice().allocateDescriptorSets(&alloc_info, &set);
+        }
+
+        if (result != vk::Result::eSuccess) {
+            spdlog::error("Failed to allocate descriptor set: {}", vk::to_string(result));
+            exit(exitcode::FAILURE);
+        }
+
+        list.allocated_sets++;
+        return set;
+    }
+
+    vk::DescriptorPool DescriptorAllocator::acquirePool(PoolList &list) {
+        if (list.ready.empty()) {
+            list.ready.push_back(createPool(list.sets_per_pool));
+            list.sets_per_pool = std::min(list.sets_per_pool * 2, MAX_SETS_PER_POOL);
+        }
+
+        return list.ready.back();
+    }
+
+    vk::DescriptorPool DescriptorAllocator::createPool(uint32_t set_count) {
+        std::vector<vk::DescriptorPoolSize> pool_sizes{};
+        pool_sizes.reserve(ratios.size());
+        for (const auto &ratio : ratios) {
+            const auto count = static_cast<uint32_t>(ratio.ratio * static_cast<float>(set_count));
+            pool_sizes.push_back({ratio.descriptor_type, std::max(count, 1u)});
+        }
+
+        vk::DescriptorPoolCreateInfo pool_info{};
+        pool_info.sType = vk::StructureType::eDescriptorPoolCreateInfo;
+        pool_info.maxSets = set_count;
+        pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        pool_info.pPoolSizes = pool_sizes.data();
+
+        vk::DescriptorPool pool{};
+        if (device.getDevice().createDescriptorPool(&pool_info, nullptr, &pool) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create descriptor pool");
+            exit(exitcode::FAILURE);
+        }
+
+        return pool;
+    }
+
+    void DescriptorAllocator::resetPools(PoolList &list) {
+        list.ready.insert(list.ready.end(), list.full.begin(), list.full.end());
+        list.full.clear();
+
+        for (const auto pool : list.ready) {
+            device.getDevice().resetDescriptorPool(pool, vk::DescriptorPoolResetFlags{});
+        }
+    }
+
+    void DescriptorAllocator::destroyPools(PoolList &list) {
+        for (const auto pool : list.full) {
+            device.getDevice().destroyDescriptorPool(pool, nullptr);
+        }
+        for (const auto pool : list.ready) {
+            device.getDevice().destroyDescriptorPool(pool, nullptr);
+        }
+        list.full.clear();
+        list.ready.clear();
+    }
+
+}
@@ -0,0 +1,42 @@
+#include "engine/vulkan/descriptorcache.hpp"
+
+#include "utils/hash.hpp"
+
+namespace muon {
+
+    size_t DescriptorCache::KeyHash::operator()(const Key &key) const {
+        return static_cast<size_t>(hash::fnv1a(key.data(), key.size() * sizeof(uint64_t)));
+    }
+
+    vk::DescriptorSet DescriptorCache::get(const Key &key, vk::DescriptorSetLayout layout, const std::function<void(vk::DescriptorSet)> &write) {
+        std::lock_guard lock{mutex};
+
+        if (auto it = sets.find(key); it != sets.end()) {
+            hits++;
+            return it->second;
+        }
+
+        misses++;
+        const auto set = allocator.allocate(layout);
+        write(set);
+
+        sets.emplace(key, set);
+        return set;
+    }
+
+    size_t DescriptorCache::getSetCount() const {
+        std::lock_guard lock{mutex};
+        return sets.size();
+    }
+
+    uint64_t DescriptorCache::getHitCount() const {
+        std::lock_guard lock{mutex};
+        return hits;
+    }
+
+    uint64_t DescriptorCache::getMissCount() const {
+        std::lock_guard lock{mutex};
+        return misses;
+    }
+
+}
@@ -1,8 +1,12 @@
 #include "engine/vulkan/descriptors.hpp"
 
+#include <algorithm>
+
 #include <spdlog/spdlog.h>
 #include <vulkan/vulkan_core.h>
 
+#include "engine/vulkan/layoutcache.hpp"
+
 #include "utils/exitcode.hpp"
 
 namespace muon {
@@ -31,84 +35,60 @@ namespace muon {
             set_layout_bindings.push_back(value);
         }
 
-        vk::DescriptorSetLayoutCreateInfo descriptor_set_layout_info{};
-        descriptor_set_layout_info.sType = vk::StructureType::eDescriptorSetLayoutCreateInfo;
-        descriptor_set_layout_info.bindingCount = static_cast<uint32_t>(set_layout_bindings.size());
-        descriptor_set_layout_info.pBindings = set_layout_bindings.data();
+        /* Identical layouts built elsewhere, including from shader reflection, share the handle */
+        descriptor_set_layout = device.getLayoutCache().getDescriptorSetLayout(std::move(set_layout_bindings));
 
-        if (device.getDevice().createDescriptorSetLayout(&descriptor_set_layout_info, nullptr, &descriptor_set_layout) != vk::Result::eSuccess) {
-            spdlog::error("Failed to create descriptor set layout");
-            exit(exitcode::FAILURE);
-        }
+        createUpdateTemplate();
     }
 
     DescriptorSetLayout::~DescriptorSetLayout() {
-        vkDestroyDescriptorSetLayout(device.getDevice(), descriptor_set_layout, nullptr);
+        /* The layout handle belongs to the device's layout cache, the template to this */
+        device.getDevice().destroyDescriptorUpdateTemplate(update_template, nullptr);
     }
 
-    /* DescriptorPool Builder */
-    DescriptorPool::Builder &DescriptorPool::Builder::addPoolSize(vk::DescriptorType descriptor_type, uint32_t count) {
-        pool_sizes.push_back({descriptor_type, count});
-        return *this;
-    }
-
-    DescriptorPool::Builder &DescriptorPool::Builder::setPoolFlags(vk::DescriptorPoolCreateFlags flags) {
-        pool_flags = flags;
-        return *this;
-    }
-
-    DescriptorPool::Builder &DescriptorPool::Builder::setMaxSets(uint32_t count) {
-        max_sets = count;
-        return *this;
-    }
-
-    std::unique_ptr<DescriptorPool> DescriptorPool::Builder::build() const {
-        return std::make_unique<DescriptorPool>(device, max_sets, pool_flags, pool_sizes);
-    }
-
-    /* DescriptorPool */
-    DescriptorPool::DescriptorPool(Device &device, uint32_t max_sets, vk::DescriptorPoolCreateFlags pool_flags,
-        const std::vector<vk::DescriptorPoolSize> &pool_sizes) : device{device} {
-        vk::DescriptorPoolCreateInfo descriptor_pool_info{};
-        descriptor_pool_info.sType = vk::StructureType::eDescriptorPoolCreateInfo;
-        descriptor_pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
-        descriptor_pool_info.pPoolSizes = pool_sizes.data();
-        descriptor_pool_info.maxSets = max_sets;
-        descriptor_pool_info.flags = pool_flags;
-
-        if (device.getDevice().createDescriptorPool(&descriptor_pool_info, nullptr, &descriptor_pool) != vk::Result::eSuccess) {
-            spdlog::error("Failed to create descriptor pool");
-            exit(exitcode::FAILURE);
+    void DescriptorSetLayout::createUpdateTemplate() {
+        std::vector<vk::DescriptorSetLayoutBinding> sorted_bindings{};
+        for (const auto &[key, value] : bindings) {
+            sorted_bindings.push_back(value);
         }
-    }
-
-    DescriptorPool::~DescriptorPool() {
-        vkDestroyDescriptorPool(device.getDevice(), descriptor_pool, nullptr);
-    }
-
-    bool DescriptorPool::allocateDescriptor(const vk::DescriptorSetLayout descriptor_set_layout, vk::DescriptorSet &descriptor) const {
-        vk::DescriptorSetAllocateInfo alloc_info{};
-        alloc_info.sType = vk::StructureType::eDescriptorSetAllocateInfo;
-        alloc_info.descriptorPool = descriptor_pool;
-        alloc_info.pSetLayouts = &descriptor_set_layout;
-        alloc_info.descriptorSetCount = 1;
-
-        if (device.getDevice().allocateDescriptorSets(&alloc_info, &descriptor) != vk::Result::eSuccess) {
-            return false;
+        std::sort(sorted_bindings.begin(), sorted_bindings.end(), [](const auto &a, const auto &b) {
+            return a.binding < b.binding;
+        });
+
+        std::vector<vk::DescriptorUpdateTemplateEntry> entries{};
+        for (const auto &binding : sorted_bindings) {
+            template_slots[binding.binding] = template_slot_count;
+
+            vk::DescriptorUpdateTemplateEntry entry{};
+            entry.dstBinding = binding.binding;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = binding.descriptorCount;
+            entry.descriptorType = binding.descriptorType;
+            entry.offset = template_slot_count * sizeof(DescriptorData);
+            entry.stride = sizeof(DescriptorData);
+            entries.push_back(entry);
+
+            template_slot_count += binding.descriptorCount;
         }
-        return true;
-    }
 
-    void DescriptorPool::freeDescriptors(std::vector<vk::DescriptorSet> &descriptors) const {
-        device.getDevice().freeDescriptorSets(descriptor_pool, static_cast<uint32_t>(descriptors.size()), descriptors.data());
-    }
+        vk::DescriptorUpdateTemplateCreateInfo template_info{};
+        template_info.sType = vk::StructureType::eDescriptorUpdateTemplateCreateInfo;
+        template_info.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+        template_info.pDescriptorUpdateEntries = entries.data();
+        template_info.templateType = vk::DescriptorUpdateTemplateType::eDescriptorSet;
+        template_info.descriptorSetLayout = descriptor_set_layout;
 
-    void DescriptorPool::resetPool() {
-        vkResetDescriptorPool(device.getDevice(), descriptor_pool, 0);
+        if (device.getDevice().createDescriptorUpdateTemplate(&template_info, nullptr, &update_template) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create descriptor update template");
+            exit(exitcode::FAILURE);
+        }
     }
 
     /* DescriptorWriter */
-    DescriptorWriter::DescriptorWriter(DescriptorSetLayout &set_layout, DescriptorPool &pool) : set_layout{set_layout}, pool{pool} {}
+    DescriptorWriter::DescriptorWriter(DescriptorSetLayout &set_layout, DescriptorAllocator &allocator, bool transient)
+        : device{set_layout.device}, set_layout{set_layout}, allocator{&allocator}, transient{transient} {}
+
+    DescriptorWriter::DescriptorWriter(DescriptorSetLayout &set_layout, DescriptorCache &cache) : device{set_layout.device}, set_layout{set_layout}, cache{&cache} {}
 
     DescriptorWriter &DescriptorWriter::writeToBuffer(uint32_t binding, vk::DescriptorBufferInfo *buffer_info) {
         auto &binding_description = set_layout.bindings[binding];
@@ -139,19 +119,86 @@ namespace muon {
     }
 
     bool DescriptorWriter::build(vk::DescriptorSet &set) {
-        bool success = pool.allocateDescriptor(set_layout.getDescriptorSetLayout(), set);
-        if (!success) {
-            return false;
+        if (cache) {
+            set = cache->get(makeKey(), set_layout.getDescriptorSetLayout(), [this](vk::DescriptorSet new_set) {
+                overwrite(new_set);
+            });
+            return true;
         }
+
+        /* The allocator grows instead of failing */
+        const auto layout = set_layout.getDescriptorSetLayout();
+        set = transient ? allocator->allocateTransient(layout) : allocator->allocate(layout);
         overwrite(set);
         return true;
     }
 
     void DescriptorWriter::overwrite(vk::DescriptorSet &set) {
+        if (writeWithTemplate(set)) {
+            return;
+        }
+
         for (auto &write : writes) {
             write.dstSet = set;
         }
-        pool.device.getDevice().updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+        device.getDevice().updateDescriptorSets(writes.size(), writes.data(), 0, nullptr);
+    }
+
+    DescriptorCache::Key DescriptorWriter::makeKey() {
+        /* Write order does not change the set, so it does not change the key either */
+        std::sort(writes.begin(), writes.end(), [](const auto &a, const auto &b) {
+            return a.dstBinding != b.dstBinding ? a.dstBinding < b.dstBinding : a.dstArrayElement < b.dstArrayElement;
+        });
+
+        DescriptorCache::Key key{};
+        key.reserve(1 + writes.size() * 6);
+        key.push_back(reinterpret_cast<uint64_t>(static_cast<VkDescriptorSetLayout>(set_layout.getDescriptorSetLayout())));
+        for (const auto &write : writes) {
+            key.push_back(write.dstBinding);
+            key.push_back(write.dstArrayElement);
+            key.push_back(static_cast<uint64_t>(write.descriptorType));
+            if (write.pBufferInfo) {
+                key.push_back(reinterpret_cast<uint64_t>(static_cast<VkBuffer>(write.pBufferInfo->buffer)));
+                key.push_back(write.pBufferInfo->offset);
+                key.push_back(write.pBufferInfo->range);
+            } else if (write.pImageInfo) {
+                key.push_back(reinterpret_cast<uint64_t>(static_cast<VkSampler>(write.pImageInfo->sampler)));
+                key.push_back(reinterpret_cast<uint64_t>(static_cast<VkImageView>(write.pImageInfo->imageView)));
+                key.push_back(static_cast<uint64_t>(write.pImageInfo->imageLayout));
+            }
+        }
+        return key;
+    }
+
+    bool DescriptorWriter::writeWithTemplate(vk::DescriptorSet set) const {
+        /* The template writes every slot, partial writes would clobber the rest with zeroes */
+        if (writes.size() != set_layout.template_slot_count) {
+            return false;
+        }
+
+        std::vector<DescriptorData> data(set_layout.template_slot_count);
+        std::vector<bool> written(set_layout.template_slot_count, false);
+        for (const auto &write : writes) {
+            const auto it = set_layout.template_slots.find(write.dstBinding);
+            if (it == set_layout.template_slots.end()) {
+                return false;
+            }
+
+            const uint32_t slot = it->second + write.dstArrayElement;
+            if (slot >= data.size() || written[slot]) {
+                return false;
+            }
+            written[slot] = true;
+
+            if (write.pBufferInfo) {
+                data[slot].buffer = *write.pBufferInfo;
+            } else if (write.pImageInfo) {
+                data[slot].image = *write.pImageInfo;
+            }
+        }
+
+        device.getDevice().updateDescriptorSetWithTemplate(set, set_layout.update_template, data.data());
+        return true;
     }
 
 }
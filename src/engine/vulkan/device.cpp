@@ -1,5 +1,11 @@
 #include "engine/vulkan/device.hpp"
 
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
 #include <set>
 #include <unordered_set>
 
@@ -7,6 +13,13 @@
 #include <SDL3/SDL_vulkan.h>
 #include <vulkan/vulkan.hpp>
 
+#include "engine/vulkan/bindlesstable.hpp"
+#include "engine/vulkan/deletionqueue.hpp"
+#include "engine/vulkan/geometryarena.hpp"
+#include "engine/vulkan/layoutcache.hpp"
+#include "engine/vulkan/model.hpp"
+#include "engine/vulkan/uploadqueue.hpp"
+
 #include "utils/defaults.hpp"
 #include "utils/exitcode.hpp"
 
@@ -39,17 +52,32 @@ namespace muon {
     }
 
     /* Device class */
-    Device::Device(Window &window) : window{window} {
-        createInstance();
-        setupDebugMessenger();
-        createSurface();
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createCommandPool();
+    Device::Device(Window &window) : window{&window} {
+        init();
+    }
+
+    Device::Device() {
+        init();
     }
 
     Device::~Device() {
+        /* Pending uploads may still target the arena, so they are flushed first */
+        upload_queue = nullptr;
+        /* Deferred arena frees must run before the arena itself goes, textures release bindless slots */
+        deletion_queue->flush();
+        geometry_arena = nullptr;
+        deletion_queue = nullptr;
+        bindless_table = nullptr;
+
+        savePipelineCache();
+        device.destroyPipelineCache(pipeline_cache, nullptr);
+        layout_cache = nullptr;
+
         device.destroyCommandPool(command_pool, nullptr);
+        if (transfer_command_pool) {
+            device.destroyCommandPool(transfer_command_pool, nullptr);
+        }
+        vmaDestroyAllocator(allocator);
         device.destroy();
 
         if (enable_validation_layers) {
@@ -92,32 +120,41 @@ namespace muon {
         exit(exitcode::FAILURE);
     }
 
-    void Device::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, vk::DeviceMemory &buffer_memory) {
+    void Device::createBuffer(vk::DeviceSize size, vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties, vk::Buffer &buffer, VmaAllocation &allocation, VmaAllocationInfo *allocation_info, bool shared) {
         vk::BufferCreateInfo buffer_info{};
         buffer_info.sType = vk::StructureType::eBufferCreateInfo;
         buffer_info.size = size;
         buffer_info.usage = usage;
         buffer_info.sharingMode = vk::SharingMode::eExclusive;
 
-        if (device.createBuffer(&buffer_info, nullptr, &buffer) != vk::Result::eSuccess) {
-            spdlog::error("Failed to create vertex buffer, exiting");
-            exit(exitcode::FAILURE);
-        }
-
-        vk::MemoryRequirements memory_requirements;
-        device.getBufferMemoryRequirements(buffer, &memory_requirements);
-
-        vk::MemoryAllocateInfo alloc_info{};
-        alloc_info.sType = vk::StructureType::eMemoryAllocateInfo;
-        alloc_info.allocationSize = memory_requirements.size;
-        alloc_info.memoryTypeIndex = findMemoryType(memory_requirements.memoryTypeBits, properties);
-
-        if (device.allocateMemory(&alloc_info, nullptr, &buffer_memory) != vk::Result::eSuccess) {
-            spdlog::error("Failed to allocate vertex buffer memory, exiting");
+        QueueFamilyIndices indices = findQueueFamilies(physical_device);
+        uint32_t queue_family_indices[] = {indices.graphics_family, indices.transfer_family};
+        if (shared && hasTransferQueue() && indices.graphics_family != indices.transfer_family) {
+            buffer_info.sharingMode = vk::SharingMode::eConcurrent;
+            buffer_info.queueFamilyIndexCount = 2;
+            buffer_info.pQueueFamilyIndices = queue_family_indices;
+        }
+
+        /* Host visible memory is persistently mapped for its entire lifetime */
+        VmaAllocationCreateInfo allocation_create_info{};
+        allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+        allocation_create_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(properties);
+        if (properties & vk::MemoryPropertyFlagBits::eHostVisible) {
+            allocation_create_info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+        }
+
+        auto result = vmaCreateBuffer(
+            allocator,
+            reinterpret_cast<const VkBufferCreateInfo *>(&buffer_info),
+            &allocation_create_info,
+            reinterpret_cast<VkBuffer *>(&buffer),
+            &allocation,
+            allocation_info
+        );
+        if (result != VK_SUCCESS) {
+            spdlog::error("Failed to create buffer, exiting");
             exit(exitcode::FAILURE);
         }
-
-        vkBindBufferMemory(device, buffer, buffer_memory, 0);
     }
 
     vk::CommandBuffer Device::beginSingleTimeCommands() {
@@ -195,33 +232,58 @@ namespace muon {
         endSingleTimeCommands(command_buffer);
     }
 
-    void Device::createImageWithInfo(const vk::ImageCreateInfo &image_info, vk::MemoryPropertyFlags properties, vk::Image &image, vk::DeviceMemory &image_memory) {
-        if (device.createImage(&image_info, nullptr, &image) != vk::Result::eSuccess) {
-            spdlog::error("Failed to create image, exiting");
-            exit(exitcode::FAILURE);
-        }
+    void Device::pipelineBarrier2(vk::CommandBuffer command_buffer, const vk::DependencyInfoKHR &dependency_info) const {
+        cmd_pipeline_barrier2(command_buffer, reinterpret_cast<const VkDependencyInfoKHR *>(&dependency_info));
+    }
 
-        vk::MemoryRequirements memory_requirements;
-        device.getImageMemoryRequirements(image, &memory_requirements);
+    void Device::beginRendering(vk::CommandBuffer command_buffer, const vk::RenderingInfoKHR &rendering_info) const {
+        cmd_begin_rendering(command_buffer, reinterpret_cast<const VkRenderingInfoKHR *>(&rendering_info));
+    }
 
-        vk::MemoryAllocateInfo allocate_info{};
-        allocate_info.sType = vk::StructureType::eMemoryAllocateInfo;
-        allocate_info.allocationSize = memory_requirements.size;
-        allocate_info.memoryTypeIndex = findMemoryType(memory_requirements.memoryTypeBits, properties);
+    void Device::endRendering(vk::CommandBuffer command_buffer) const {
+        cmd_end_rendering(command_buffer);
+    }
 
-        if (device.allocateMemory(&allocate_info, nullptr, &image_memory) != vk::Result::eSuccess) {
-            spdlog::error("Failed to allocate image memory, exiting");
+    void Device::createImageWithInfo(const vk::ImageCreateInfo &image_info, vk::MemoryPropertyFlags properties, vk::Image &image, VmaAllocation &allocation) {
+        VmaAllocationCreateInfo allocation_create_info{};
+        allocation_create_info.usage = VMA_MEMORY_USAGE_AUTO;
+        allocation_create_info.requiredFlags = static_cast<VkMemoryPropertyFlags>(properties);
+
+        auto result = vmaCreateImage(
+            allocator,
+            reinterpret_cast<const VkImageCreateInfo *>(&image_info),
+            &allocation_create_info,
+            reinterpret_cast<VkImage *>(&image),
+            &allocation,
+            nullptr
+        );
+        if (result != VK_SUCCESS) {
+            spdlog::error("Failed to create image, exiting");
             exit(exitcode::FAILURE);
         }
-
-        device.bindImageMemory(image, image_memory, 0);
-        // if (device.bindImageMemory(image, image_memory, 0) != vk::Result::eSuccess) {
-        //     spdlog::error("Failed to bind image memory, exiting");
-        //     exit(exitcode::FAILURE);
-        // }
     }
 
     /* Private functions */
+    void Device::init() {
+        createInstance();
+        setupDebugMessenger();
+        /* Headless devices never present, so there is no surface to create or query */
+        if (!isHeadless()) {
+            createSurface();
+        }
+        pickPhysicalDevice();
+        createLogicalDevice();
+        createAllocator();
+        createCommandPool();
+        createPipelineCache();
+
+        deletion_queue = std::make_unique<DeletionQueue>();
+        layout_cache = std::make_unique<LayoutCache>(*this);
+        bindless_table = std::make_unique<BindlessTable>(*this);
+        upload_queue = std::make_unique<UploadQueue>(*this);
+        geometry_arena = std::make_unique<GeometryArena>(*this, sizeof(Model::Vertex));
+    }
+
     void Device::createInstance() {
         if (enable_validation_layers && !checkValidationLayerSupport()) {
             spdlog::error("Validation layers requested but not available, exiting");
@@ -234,7 +296,7 @@ namespace muon {
         app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         app_info.pEngineName = "Muon";
         app_info.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-        app_info.apiVersion = VK_API_VERSION_1_0;
+        app_info.apiVersion = VK_API_VERSION_1_1;
 
         vk::InstanceCreateInfo create_info = {};
         create_info.sType = vk::StructureType::eInstanceCreateInfo;
@@ -285,7 +347,7 @@ namespace muon {
     }
 
     void Device::createSurface() {
-        window.createSurface(instance, &surface);
+        window->createSurface(instance, &surface);
     }
 
     void Device::pickPhysicalDevice() {
@@ -320,36 +382,110 @@ namespace muon {
 
         physical_device.getProperties(&properties);
         spdlog::debug("Physical device: {}", properties.deviceName.data());
+
+        descriptor_indexing_properties.sType = vk::StructureType::ePhysicalDeviceDescriptorIndexingPropertiesEXT;
+        vk::PhysicalDeviceProperties2 properties2{};
+        properties2.sType = vk::StructureType::ePhysicalDeviceProperties2;
+        properties2.pNext = &descriptor_indexing_properties;
+        physical_device.getProperties2(&properties2);
+        descriptor_indexing_properties.pNext = nullptr;
     }
 
     void Device::createLogicalDevice() {
         QueueFamilyIndices indices = findQueueFamilies(physical_device);
 
         std::vector<vk::DeviceQueueCreateInfo> queue_create_infos;
-        std::set unique_queue_families = {indices.graphics_family, indices.present_family};
+        std::map<uint32_t, uint32_t> queue_counts = {{indices.graphics_family, 1}, {indices.present_family, 1}};
+        if (indices.transfer_family_has_value) {
+            auto &count = queue_counts[indices.transfer_family];
+            count = std::max(count, indices.transfer_queue_index + 1);
+        }
 
-        float queue_priority = 1.0f;
-        for (uint32_t queue_family : unique_queue_families) {
+        const std::array<float, 2> queue_priorities = {1.0f, 1.0f};
+        for (auto [queue_family, queue_count] : queue_counts) {
             vk::DeviceQueueCreateInfo queue_create_info = {};
             queue_create_info.sType = vk::StructureType::eDeviceQueueCreateInfo;
             queue_create_info.queueFamilyIndex = queue_family;
-            queue_create_info.queueCount = 1;
-            queue_create_info.pQueuePriorities = &queue_priority;
+            queue_create_info.queueCount = queue_count;
+            queue_create_info.pQueuePriorities = queue_priorities.data();
             queue_create_infos.push_back(queue_create_info);
         }
 
         vk::PhysicalDeviceFeatures device_features = {};
         device_features.samplerAnisotropy = VK_TRUE;
 
+        std::vector<const char *> enabled_extensions = getRequiredDeviceExtensions();
+
+        /* Enabled only when both the extension and its feature are there, barriers fall back to the original API otherwise */
+        vk::PhysicalDeviceSynchronization2FeaturesKHR synchronization2_features{};
+        synchronization2_features.sType = vk::StructureType::ePhysicalDeviceSynchronization2FeaturesKHR;
+        bool synchronization2 = false;
+        if (checkOptionalExtensionSupport(physical_device, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+            vk::PhysicalDeviceFeatures2 features2{};
+            features2.sType = vk::StructureType::ePhysicalDeviceFeatures2;
+            features2.pNext = &synchronization2_features;
+            physical_device.getFeatures2(&features2);
+
+            synchronization2 = synchronization2_features.synchronization2 == VK_TRUE;
+            synchronization2_features.pNext = nullptr;
+        }
+        if (synchronization2) {
+            enabled_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+        }
+
+        /* On a 1.1 instance dynamic rendering also needs the extensions that became core in 1.2 */
+        const std::array<const char *, 3> dynamic_rendering_extensions = {
+            VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME,
+            VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+            VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME,
+        };
+        vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamic_rendering_features{};
+        dynamic_rendering_features.sType = vk::StructureType::ePhysicalDeviceDynamicRenderingFeaturesKHR;
+        bool dynamic_rendering = std::all_of(dynamic_rendering_extensions.begin(), dynamic_rendering_extensions.end(), [&](const char *name) {
+            return checkOptionalExtensionSupport(physical_device, name);
+        });
+        if (dynamic_rendering) {
+            vk::PhysicalDeviceFeatures2 features2{};
+            features2.sType = vk::StructureType::ePhysicalDeviceFeatures2;
+            features2.pNext = &dynamic_rendering_features;
+            physical_device.getFeatures2(&features2);
+
+            dynamic_rendering = dynamic_rendering_features.dynamicRendering == VK_TRUE;
+            dynamic_rendering_features.pNext = nullptr;
+        }
+        if (dynamic_rendering) {
+            enabled_extensions.insert(enabled_extensions.end(), dynamic_rendering_extensions.begin(), dynamic_rendering_extensions.end());
+        }
+
+        /* Required, checked in isDeviceSuitable, only what the bindless table and its shaders use */
+        vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features{};
+        descriptor_indexing_features.sType = vk::StructureType::ePhysicalDeviceDescriptorIndexingFeaturesEXT;
+        descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        descriptor_indexing_features.descriptorBindingPartiallyBound = VK_TRUE;
+        descriptor_indexing_features.runtimeDescriptorArray = VK_TRUE;
+
+        /* Feature structs of the enabled extensions, chained onto the create info */
+        void *features_chain = &descriptor_indexing_features;
+        if (synchronization2) {
+            synchronization2_features.pNext = features_chain;
+            features_chain = &synchronization2_features;
+        }
+        if (dynamic_rendering) {
+            dynamic_rendering_features.pNext = features_chain;
+            features_chain = &dynamic_rendering_features;
+        }
+
         vk::DeviceCreateInfo create_info = {};
         create_info.sType = vk::StructureType::eDeviceCreateInfo;
+        create_info.pNext = features_chain;
 
         create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
         create_info.pQueueCreateInfos = queue_create_infos.data();
 
         create_info.pEnabledFeatures = &device_features;
-        create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
-        create_info.ppEnabledExtensionNames = device_extensions.data();
+        create_info.enabledExtensionCount = static_cast<uint32_t>(enabled_extensions.size());
+        create_info.ppEnabledExtensionNames = enabled_extensions.data();
 
         if (enable_validation_layers) {
             create_info.enabledLayerCount = static_cast<uint32_t>(validation_layers.size());
@@ -363,8 +499,46 @@ namespace muon {
             exit(exitcode::FAILURE);
         }
 
+        if (synchronization2) {
+            auto device_proc_addr = vkGetDeviceProcAddr(device, "vkCmdPipelineBarrier2KHR");
+            cmd_pipeline_barrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(device_proc_addr);
+        }
+        spdlog::debug("Synchronization2: {}", hasSynchronization2() ? "enabled" : "unavailable");
+
+        if (dynamic_rendering) {
+            auto begin_proc_addr = vkGetDeviceProcAddr(device, "vkCmdBeginRenderingKHR");
+            auto end_proc_addr = vkGetDeviceProcAddr(device, "vkCmdEndRenderingKHR");
+            cmd_begin_rendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(begin_proc_addr);
+            cmd_end_rendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(end_proc_addr);
+        }
+        spdlog::debug("Dynamic rendering: {}", hasDynamicRendering() ? "enabled" : "unavailable");
+
         device.getQueue(indices.graphics_family, 0, &graphics_queue);
         device.getQueue(indices.present_family, 0, &present_queue);
+
+        if (indices.transfer_family_has_value) {
+            device.getQueue(indices.transfer_family, indices.transfer_queue_index, &transfer_queue);
+            spdlog::debug("Transfer queue: family {}, index {}", indices.transfer_family, indices.transfer_queue_index);
+        } else {
+            spdlog::debug("No separate transfer queue, uploads share the graphics queue");
+        }
+    }
+
+    void Device::createAllocator() {
+        /*
+            Vulkan 1.1 makes dedicated allocations core, VMA will then only
+            give a resource its own allocation when the driver prefers it
+        */
+        VmaAllocatorCreateInfo allocator_info{};
+        allocator_info.vulkanApiVersion = VK_API_VERSION_1_1;
+        allocator_info.instance = instance;
+        allocator_info.physicalDevice = physical_device;
+        allocator_info.device = device;
+
+        if (vmaCreateAllocator(&allocator_info, &allocator) != VK_SUCCESS) {
+            spdlog::error("Failed to create memory allocator, exiting");
+            exit(exitcode::FAILURE);
+        }
     }
 
     void Device::createCommandPool() {
@@ -379,6 +553,167 @@ namespace muon {
             spdlog::error("Failed to create command pool, exiting");
             exit(exitcode::FAILURE);
         }
+
+        if (!hasTransferQueue()) {
+            return;
+        }
+
+        pool_info.queueFamilyIndex = queue_family_indices.transfer_family;
+        if (device.createCommandPool(&pool_info, nullptr, &transfer_command_pool) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create transfer command pool, exiting");
+            exit(exitcode::FAILURE);
+        }
+    }
+
+    /*
+        The driver validates its own blob as well, but a mismatching blob is only
+        silently ignored. Checking up front lets stale caches be logged and replaced.
+    */
+    struct PipelineCacheFileHeader {
+        static constexpr uint32_t MAGIC = 0x4843504d; /* "MPCH" */
+        static constexpr uint32_t VERSION = 2;
+
+        uint32_t magic{MAGIC};
+        uint32_t version{VERSION};
+        uint32_t vendor_id{};
+        uint32_t device_id{};
+        uint32_t driver_version{};
+        uint8_t uuid[VK_UUID_SIZE]{};
+        /* Spelled out so every byte written is initialised */
+        uint32_t padding{};
+        uint64_t data_size{};
+        uint64_t cold_compile_time{};
+        uint64_t cold_pipeline_set{};
+    };
+    static_assert(sizeof(PipelineCacheFileHeader) == 20 + VK_UUID_SIZE + 4 + 24, "PipelineCacheFileHeader must have no implicit padding");
+
+    void Device::createPipelineCache() {
+        std::vector<char> cache_data{};
+
+        std::ifstream file{defaults::pipeline_cache::PATH, std::ios::binary | std::ios::ate};
+        if (file.is_open()) {
+            const auto file_size = static_cast<size_t>(file.tellg());
+            file.seekg(0);
+
+            PipelineCacheFileHeader header{};
+            if (file_size >= sizeof(header)) {
+                file.read(reinterpret_cast<char *>(&header), sizeof(header));
+            }
+
+            const bool valid = file_size >= sizeof(header)
+                && header.magic == PipelineCacheFileHeader::MAGIC
+                && header.version == PipelineCacheFileHeader::VERSION
+                && header.vendor_id == properties.vendorID
+                && header.device_id == properties.deviceID
+                && header.driver_version == properties.driverVersion
+                && memcmp(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0
+                && header.data_size == file_size - sizeof(header);
+
+            if (valid) {
+                cache_data.resize(header.data_size);
+                file.read(cache_data.data(), static_cast<std::streamsize>(cache_data.size()));
+                cold_pipeline_compile_time = header.cold_compile_time;
+                cold_pipeline_set = header.cold_pipeline_set;
+                pipeline_cache_loaded = true;
+                spdlog::info("Loaded pipeline cache ({} bytes)", cache_data.size());
+            } else {
+                spdlog::info("Pipeline cache does not match this device or driver, rebuilding");
+            }
+        }
+
+        vk::PipelineCacheCreateInfo cache_info{};
+        cache_info.sType = vk::StructureType::ePipelineCacheCreateInfo;
+        cache_info.initialDataSize = cache_data.size();
+        cache_info.pInitialData = cache_data.empty() ? nullptr : cache_data.data();
+
+        if (device.createPipelineCache(&cache_info, nullptr, &pipeline_cache) != vk::Result::eSuccess) {
+            spdlog::warn("Failed to create pipeline cache from file, starting empty");
+
+            cache_info.initialDataSize = 0;
+            cache_info.pInitialData = nullptr;
+            cold_pipeline_compile_time = 0;
+            cold_pipeline_set = 0;
+            pipeline_cache_loaded = false;
+            if (device.createPipelineCache(&cache_info, nullptr, &pipeline_cache) != vk::Result::eSuccess) {
+                spdlog::error("Failed to create pipeline cache, exiting");
+                exit(exitcode::FAILURE);
+            }
+        }
+    }
+
+    void Device::savePipelineCache() {
+        /*
+            A cold time only means something for the pipelines it was measured on. When
+            the set changed it is dropped rather than compared, and this warm run cannot
+            stand in for it, so the file carries no cold time until a rebuild.
+        */
+        const bool cache_was_cold = !pipeline_cache_loaded;
+        const bool same_pipelines = cold_pipeline_compile_time > 0 && cold_pipeline_set == pipeline_set.load();
+
+        const auto compile_ms = static_cast<double>(pipeline_compile_time) / 1e6;
+        if (cache_was_cold) {
+            spdlog::info("Pipeline creation took {:.2f} ms without a pipeline cache", compile_ms);
+        } else if (same_pipelines) {
+            const auto cold_ms = static_cast<double>(cold_pipeline_compile_time) / 1e6;
+            spdlog::info("Pipeline creation took {:.2f} ms, {:.2f} ms saved by the pipeline cache", compile_ms, cold_ms - compile_ms);
+        } else {
+            spdlog::info("Pipeline creation took {:.2f} ms, no cold run of this pipeline set to compare with", compile_ms);
+        }
+
+        size_t data_size = 0;
+        if (device.getPipelineCacheData(pipeline_cache, &data_size, nullptr) != vk::Result::eSuccess) {
+            spdlog::warn("Failed to query pipeline cache size");
+            return;
+        }
+
+        std::vector<char> cache_data(data_size);
+        if (device.getPipelineCacheData(pipeline_cache, &data_size, cache_data.data()) != vk::Result::eSuccess) {
+            spdlog::warn("Failed to read pipeline cache data");
+            return;
+        }
+        cache_data.resize(data_size);
+
+        PipelineCacheFileHeader header{};
+        memset(&header, 0, sizeof(header));
+        header.magic = PipelineCacheFileHeader::MAGIC;
+        header.version = PipelineCacheFileHeader::VERSION;
+        header.vendor_id = properties.vendorID;
+        header.device_id = properties.deviceID;
+        header.driver_version = properties.driverVersion;
+        memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+        header.data_size = cache_data.size();
+        if (cache_was_cold) {
+            header.cold_compile_time = pipeline_compile_time.load();
+            header.cold_pipeline_set = pipeline_set.load();
+        } else if (same_pipelines) {
+            header.cold_compile_time = cold_pipeline_compile_time;
+            header.cold_pipeline_set = cold_pipeline_set;
+        }
+
+        /* Written beside the old file and renamed over it, so a crash never leaves a torn cache */
+        const std::string path = defaults::pipeline_cache::PATH;
+        const std::string temp_path = path + ".tmp";
+        {
+            std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+            if (!file.is_open()) {
+                spdlog::warn("Failed to open {} for writing", temp_path);
+                return;
+            }
+
+            file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            file.write(cache_data.data(), static_cast<std::streamsize>(cache_data.size()));
+            if (!file.good()) {
+                spdlog::warn("Failed to write pipeline cache");
+                file.close();
+                std::remove(temp_path.c_str());
+                return;
+            }
+        }
+
+        if (std::rename(temp_path.c_str(), path.c_str()) != 0) {
+            spdlog::warn("Failed to replace {}", path);
+            std::remove(temp_path.c_str());
+        }
     }
 
     bool Device::isDeviceSuitable(vk::PhysicalDevice device) {
@@ -386,8 +721,8 @@ namespace muon {
 
         const bool extensions_supported = checkDeviceExtensionSupport(device);
 
-        bool swapchain_adequate = false;
-        if (extensions_supported) {
+        bool swapchain_adequate = isHeadless();
+        if (extensions_supported && !isHeadless()) {
             const SwapchainSupportDetails swap_chain_support = querySwapchainSupport(device);
             swapchain_adequate = !swap_chain_support.formats.empty() && !swap_chain_support.present_modes.empty();
         }
@@ -395,14 +730,34 @@ namespace muon {
         vk::PhysicalDeviceFeatures supported_features;
         device.getFeatures(&supported_features);
 
-        return indices.isComplete() && extensions_supported && swapchain_adequate && supported_features.samplerAnisotropy;
+        return indices.isComplete() && extensions_supported && swapchain_adequate && supported_features.samplerAnisotropy
+            && supportsBindlessTextures(device);
+    }
+
+    bool Device::supportsBindlessTextures(vk::PhysicalDevice device) {
+        vk::PhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features{};
+        descriptor_indexing_features.sType = vk::StructureType::ePhysicalDeviceDescriptorIndexingFeaturesEXT;
+
+        vk::PhysicalDeviceFeatures2 features2{};
+        features2.sType = vk::StructureType::ePhysicalDeviceFeatures2;
+        features2.pNext = &descriptor_indexing_features;
+        device.getFeatures2(&features2);
+
+        return descriptor_indexing_features.shaderSampledImageArrayNonUniformIndexing
+            && descriptor_indexing_features.descriptorBindingSampledImageUpdateAfterBind
+            && descriptor_indexing_features.descriptorBindingPartiallyBound
+            && descriptor_indexing_features.runtimeDescriptorArray;
     }
 
     std::vector<const char*> Device::getRequiredExtensions() {
-        uint32_t extension_count = 0;
-        auto sdl_extensions = SDL_Vulkan_GetInstanceExtensions(&extension_count);
+        std::vector<const char *> extensions{};
 
-        std::vector<const char *> extensions(sdl_extensions, sdl_extensions + extension_count);
+        /* SDL's surface extensions, which need its video subsystem and are useless without a window */
+        if (!isHeadless()) {
+            uint32_t extension_count = 0;
+            auto sdl_extensions = SDL_Vulkan_GetInstanceExtensions(&extension_count);
+            extensions.assign(sdl_extensions, sdl_extensions + extension_count);
+        }
 
         if (enable_validation_layers) {
             extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -411,6 +766,16 @@ namespace muon {
         return extensions;
     }
 
+    std::vector<const char *> Device::getRequiredDeviceExtensions() const {
+        /* Textures are only reachable through the bindless table, headless or not */
+        std::vector<const char *> extensions = {VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME};
+        if (!isHeadless()) {
+            extensions.insert(extensions.end(), device_extensions.begin(), device_extensions.end());
+        }
+
+        return extensions;
+    }
+
     bool Device::checkValidationLayerSupport() {
         // uint32_t layer_count;
         // vkEnumerateInstanceLayerProperties(&layer_count, nullptr);
@@ -448,25 +813,50 @@ namespace muon {
         device.getQueueFamilyProperties(&queue_family_count, queue_families.data());
 
 
+        bool transfer_only = false;
+
         int32_t i = 0;
         for (const auto &queue_family : queue_families) {
-            if (queue_family.queueCount > 0 && queue_family.queueFlags & vk::QueueFlagBits::eGraphics) {
-                indices.graphics_family = i;
-                indices.graphics_family_has_value = true;
-            }
-            vk::Bool32 present_support = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
-            if (queue_family.queueCount > 0 && present_support) {
-                indices.present_family = i;
-                indices.present_family_has_value = true;
+            if (!indices.isComplete()) {
+                if (queue_family.queueCount > 0 && queue_family.queueFlags & vk::QueueFlagBits::eGraphics) {
+                    indices.graphics_family = i;
+                    indices.graphics_family_has_value = true;
+                }
+                /* Without a surface nothing is presented, the graphics family stands in */
+                vk::Bool32 present_support = false;
+                if (surface) {
+                    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &present_support);
+                } else {
+                    present_support = indices.graphics_family_has_value && indices.graphics_family == static_cast<uint32_t>(i);
+                }
+                if (queue_family.queueCount > 0 && present_support) {
+                    indices.present_family = i;
+                    indices.present_family_has_value = true;
+                }
             }
-            if (indices.isComplete()) {
-                break;
+
+            /* Prefer a transfer only family (DMA engine) over an async compute family, compute implies transfer */
+            bool can_graphics = static_cast<bool>(queue_family.queueFlags & vk::QueueFlagBits::eGraphics);
+            bool can_compute = static_cast<bool>(queue_family.queueFlags & vk::QueueFlagBits::eCompute);
+            bool can_transfer = can_compute || static_cast<bool>(queue_family.queueFlags & vk::QueueFlagBits::eTransfer);
+            if (queue_family.queueCount > 0 && can_transfer && !can_graphics && !transfer_only) {
+                indices.transfer_family = i;
+                indices.transfer_queue_index = 0;
+                indices.transfer_family_has_value = true;
+                transfer_only = !can_compute;
             }
 
             i++;
         }
 
+        /* Fall back to a second queue in the graphics family if there is one */
+        if (!indices.transfer_family_has_value && indices.graphics_family_has_value
+            && queue_families[indices.graphics_family].queueCount > 1) {
+            indices.transfer_family = indices.graphics_family;
+            indices.transfer_queue_index = 1;
+            indices.transfer_family_has_value = true;
+        }
+
         return indices;
     }
 
@@ -512,6 +902,22 @@ namespace muon {
         }
     }
 
+    bool Device::checkOptionalExtensionSupport(vk::PhysicalDevice device, const char *extension_name) {
+        uint32_t extension_count = 0;
+        if (device.enumerateDeviceExtensionProperties(nullptr, &extension_count, nullptr) != vk::Result::eSuccess) {
+            return false;
+        }
+
+        std::vector<vk::ExtensionProperties> available_extensions(extension_count);
+        if (device.enumerateDeviceExtensionProperties(nullptr, &extension_count, available_extensions.data()) != vk::Result::eSuccess) {
+            return false;
+        }
+
+        return std::any_of(available_extensions.begin(), available_extensions.end(), [&](const auto &extension) {
+            return strcmp(extension.extensionName.data(), extension_name) == 0;
+        });
+    }
+
     bool Device::checkDeviceExtensionSupport(vk::PhysicalDevice device) {
         uint32_t extension_count;
         auto result = device.enumerateDeviceExtensionProperties(nullptr, &extension_count, nullptr);
@@ -525,7 +931,8 @@ namespace muon {
             spdlog::warn("Failed to enumerate device extension properties");
         }
 
-        std::set<std::string> required_extensions(device_extensions.begin(), device_extensions.end());
+        const auto extensions = getRequiredDeviceExtensions();
+        std::set<std::string> required_extensions(extensions.begin(), extensions.end());
 
         for (const auto &extension : availabile_extensions) {
             required_extensions.erase(extension.extensionName);
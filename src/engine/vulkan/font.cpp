@@ -15,6 +15,7 @@
 #include "engine/vulkan/texture.hpp"
 
 #include "utils/exitcode.hpp"
+#include "utils/profiler.hpp"
 
 namespace muon {
 
@@ -43,6 +44,8 @@ namespace muon {
     }
 
     Font::Font(std::string &font_path, Device &device) {
+        MUON_PROFILE_SCOPE("Font::Font");
+
         msdfgen::FreetypeHandle *freetype = msdfgen::initializeFreetype();
         msdfgen::FontHandle *font = msdfgen::loadFont(freetype, font_path.c_str());
         if (font == nullptr) {
@@ -0,0 +1,117 @@
+#include "engine/vulkan/frameallocator.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    FrameAllocator::FrameAllocator(Device &device, vk::DeviceSize frame_size, uint32_t frame_count) : device{device}, overflow_blocks(frame_count) {
+        const auto &limits = device.getProperties().limits;
+        min_alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+
+        /* Keep every region start aligned so slice offsets stay valid dynamic offsets */
+        this->frame_size = getAlignment(frame_size, min_alignment);
+
+        buffer = createBuffer(this->frame_size, frame_count);
+    }
+
+    void FrameAllocator::beginFrame(uint32_t frame_index) {
+        current_frame = frame_index;
+        frame_begin = frame_index * frame_size;
+        frame_offset = frame_begin;
+        overflow_count = 0;
+    }
+
+    void FrameAllocator::flush() {
+        if (frame_offset != frame_begin && buffer->flush(frame_offset - frame_begin, frame_begin) != vk::Result::eSuccess) {
+            spdlog::warn("Failed to flush frame allocator");
+        }
+
+        const auto &blocks = overflow_blocks[current_frame];
+        for (size_t i = 0; i < overflow_count; i++) {
+            if (blocks[i].buffer->flush(blocks[i].offset, 0) != vk::Result::eSuccess) {
+                spdlog::warn("Failed to flush frame allocator overflow block");
+            }
+        }
+    }
+
+    FrameAllocator::Slice FrameAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+        return allocate(size, alignment, 0);
+    }
+
+    FrameAllocator::Slice FrameAllocator::allocateDynamic(vk::DeviceSize size, vk::DeviceSize range) {
+        return allocate(size, min_alignment, range);
+    }
+
+    FrameAllocator::Slice FrameAllocator::allocateGlobal(vk::DeviceSize size) {
+        /* The start of the region is the one place guaranteed to be in the main buffer */
+        if (frame_offset != frame_begin || overflow_count > 0 || size > frame_size) {
+            spdlog::error("Global frame data must be the first allocation of the frame, exiting");
+            exit(exitcode::FAILURE);
+        }
+
+        return allocate(size, min_alignment, 0);
+    }
+
+    FrameAllocator::Slice FrameAllocator::allocate(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize range) {
+        /* Once a frame has overflowed it stays in its blocks, the region is full */
+        if (overflow_count > 0) {
+            return allocateOverflow(size, alignment, range);
+        }
+
+        /* A descriptor's range may reach into the next frame's region, never past the buffer */
+        const vk::DeviceSize offset = getAlignment(frame_offset, alignment);
+        if (offset + size > frame_begin + frame_size || offset + std::max(size, range) > buffer->getBufferSize()) {
+            return allocateOverflow(size, alignment, range);
+        }
+
+        frame_offset = offset + size;
+
+        return {buffer->getBuffer(), offset, size, static_cast<char *>(buffer->getMappedMemory()) + offset};
+    }
+
+    FrameAllocator::Slice FrameAllocator::allocateOverflow(vk::DeviceSize size, vk::DeviceSize alignment, vk::DeviceSize range) {
+        auto &blocks = overflow_blocks[current_frame];
+        const vk::DeviceSize needed = std::max(size, range);
+
+        vk::DeviceSize offset = overflow_count > 0 ? getAlignment(blocks[overflow_count - 1].offset, alignment) : 0;
+        if (overflow_count == 0 || offset + needed > blocks[overflow_count - 1].buffer->getBufferSize()) {
+            /* Reuse the next block this frame chained before if it is large enough, otherwise chain a new one */
+            if (overflow_count == blocks.size() || blocks[overflow_count].buffer->getBufferSize() < needed) {
+                /* A region's worth plus one descriptor range of tail room, so dynamic slices do not each need a block */
+                const vk::DeviceSize block_size = getAlignment(std::max(frame_size, size) + range, min_alignment);
+                spdlog::warn("Frame allocator region of {} bytes is full, chaining a {} byte block", frame_size, block_size);
+
+                /* A block too small for this request is replaced, the buffer goes through the deletion queue */
+                if (overflow_count == blocks.size()) {
+                    blocks.push_back({});
+                }
+                blocks[overflow_count].buffer = createBuffer(block_size, 1);
+            }
+
+            blocks[overflow_count].offset = 0;
+            overflow_count++;
+            offset = 0;
+        }
+
+        auto &block = blocks[overflow_count - 1];
+        block.offset = offset + size;
+
+        return {block.buffer->getBuffer(), offset, size, static_cast<char *>(block.buffer->getMappedMemory()) + offset};
+    }
+
+    std::unique_ptr<Buffer> FrameAllocator::createBuffer(vk::DeviceSize size, uint32_t count) const {
+        return std::make_unique<Buffer>(
+            device,
+            size,
+            count,
+            vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+                | vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eIndexBuffer,
+            vk::MemoryPropertyFlagBits::eHostVisible
+        );
+    }
+
+}
@@ -1,21 +1,170 @@
 #include "engine/vulkan/framebuffer.hpp"
+
+#include <array>
+
 #include <spdlog/spdlog.h>
 
+#include "utils/exitcode.hpp"
+
 namespace muon {
 
-    Framebuffer::Framebuffer(Device &device, vk::RenderPass render_pass, vk::Extent2D extent) {
+    Framebuffer::Framebuffer(Device &device, vk::Extent2D extent) : device{device}, extent{extent} {
+        createImages();
+        if (!device.hasDynamicRendering()) {
+            createRenderPass();
+            createFramebuffer();
+        }
+    }
+
+    Framebuffer::~Framebuffer() {
+        if (render_pass) {
+            device.getDevice().destroyFramebuffer(framebuffer, nullptr);
+            device.getDevice().destroyRenderPass(render_pass, nullptr);
+        }
+
+        device.getDevice().destroyImageView(depth_image_view, nullptr);
+        vmaDestroyImage(device.getAllocator(), depth_image, depth_image_allocation);
+
+        device.getDevice().destroyImageView(color_image_view, nullptr);
+        vmaDestroyImage(device.getAllocator(), color_image, color_image_allocation);
+    }
+
+    void Framebuffer::createImages() {
+        auto candidates = {vk::Format::eD32Sfloat, vk::Format::eD32SfloatS8Uint, vk::Format::eD24UnormS8Uint};
+        depth_format = device.findSupportedFormat(candidates, vk::ImageTiling::eOptimal, vk::FormatFeatureFlagBits::eDepthStencilAttachment);
+
+        /* Transfer source so frames can be read back, e.g. for image comparisons in CI, after a transition out of the attachment layout */
+        createImage(
+            color_format,
+            vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc,
+            vk::ImageAspectFlagBits::eColor,
+            color_image, color_image_allocation, color_image_view
+        );
+
+        createImage(
+            depth_format,
+            vk::ImageUsageFlagBits::eDepthStencilAttachment,
+            vk::ImageAspectFlagBits::eDepth,
+            depth_image, depth_image_allocation, depth_image_view
+        );
+    }
+
+    void Framebuffer::createRenderPass() {
+        vk::AttachmentDescription colour_attachment{};
+        colour_attachment.format = color_format;
+        colour_attachment.samples = vk::SampleCountFlagBits::e1;
+        colour_attachment.loadOp = vk::AttachmentLoadOp::eClear;
+        colour_attachment.storeOp = vk::AttachmentStoreOp::eStore;
+        colour_attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        colour_attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        colour_attachment.initialLayout = vk::ImageLayout::eUndefined;
+        colour_attachment.finalLayout = vk::ImageLayout::eColorAttachmentOptimal;
+
+        vk::AttachmentDescription depth_attachment{};
+        depth_attachment.format = depth_format;
+        depth_attachment.samples = vk::SampleCountFlagBits::e1;
+        depth_attachment.loadOp = vk::AttachmentLoadOp::eClear;
+        depth_attachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+        depth_attachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
+        depth_attachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
+        depth_attachment.initialLayout = vk::ImageLayout::eUndefined;
+        depth_attachment.finalLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+        vk::AttachmentReference colour_attachment_ref{};
+        colour_attachment_ref.attachment = 0;
+        colour_attachment_ref.layout = vk::ImageLayout::eColorAttachmentOptimal;
+
+        vk::AttachmentReference depth_attachment_ref{};
+        depth_attachment_ref.attachment = 1;
+        depth_attachment_ref.layout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+
+        vk::SubpassDescription subpass{};
+        subpass.pipelineBindPoint = vk::PipelineBindPoint::eGraphics;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colour_attachment_ref;
+        subpass.pDepthStencilAttachment = &depth_attachment_ref;
+
+        /*
+            Unlike swapchain images the target is reused by the next frame in flight,
+            so the previous frame's attachment writes have to complete before this
+            frame clears. Both attachments stay in their attachment layouts so no
+            transition falls outside this dependency.
+        */
+        vk::SubpassDependency dependency{};
+        dependency.srcSubpass = vk::SubpassExternal;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eLateFragmentTests;
+        dependency.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        dependency.dstStageMask = vk::PipelineStageFlagBits::eColorAttachmentOutput | vk::PipelineStageFlagBits::eEarlyFragmentTests;
+        dependency.dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+
+        std::array<vk::AttachmentDescription, 2> attachments = {colour_attachment, depth_attachment};
+        vk::RenderPassCreateInfo render_pass_info{};
+        render_pass_info.sType = vk::StructureType::eRenderPassCreateInfo;
+        render_pass_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        render_pass_info.pAttachments = attachments.data();
+        render_pass_info.subpassCount = 1;
+        render_pass_info.pSubpasses = &subpass;
+        render_pass_info.dependencyCount = 1;
+        render_pass_info.pDependencies = &dependency;
+
+        if (device.getDevice().createRenderPass(&render_pass_info, nullptr, &render_pass) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create offscreen render pass");
+            exit(exitcode::FAILURE);
+        }
+    }
+
+    void Framebuffer::createFramebuffer() {
+        std::array<vk::ImageView, 2> attachments = {color_image_view, depth_image_view};
+
         vk::FramebufferCreateInfo framebuffer_info{};
         framebuffer_info.sType = vk::StructureType::eFramebufferCreateInfo;
         framebuffer_info.renderPass = render_pass;
-        framebuffer_info.attachmentCount = 1;
-        framebuffer_info.pAttachments = nullptr;
+        framebuffer_info.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebuffer_info.pAttachments = attachments.data();
         framebuffer_info.width = extent.width;
         framebuffer_info.height = extent.height;
         framebuffer_info.layers = 1;
 
-        // if (device.getDevice().createFramebuffer(&framebuffer_info, 0, &framebuffer) != vk::Result::eSuccess) {
-        //     spdlog::error("Failed to create framebuffer");
-        // }
+        if (device.getDevice().createFramebuffer(&framebuffer_info, nullptr, &framebuffer) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create framebuffer");
+            exit(exitcode::FAILURE);
+        }
+    }
+
+    void Framebuffer::createImage(vk::Format format, vk::ImageUsageFlags usage, vk::ImageAspectFlags aspect, vk::Image &image, VmaAllocation &allocation, vk::ImageView &view) {
+        vk::ImageCreateInfo image_info{};
+        image_info.sType = vk::StructureType::eImageCreateInfo;
+        image_info.imageType = vk::ImageType::e2D;
+        image_info.extent.width = extent.width;
+        image_info.extent.height = extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.format = format;
+        image_info.tiling = vk::ImageTiling::eOptimal;
+        image_info.initialLayout = vk::ImageLayout::eUndefined;
+        image_info.usage = usage;
+        image_info.samples = vk::SampleCountFlagBits::e1;
+        image_info.sharingMode = vk::SharingMode::eExclusive;
+
+        device.createImageWithInfo(image_info, vk::MemoryPropertyFlagBits::eDeviceLocal, image, allocation);
+
+        vk::ImageViewCreateInfo view_info{};
+        view_info.sType = vk::StructureType::eImageViewCreateInfo;
+        view_info.image = image;
+        view_info.viewType = vk::ImageViewType::e2D;
+        view_info.format = format;
+        view_info.subresourceRange.aspectMask = aspect;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+
+        if (device.getDevice().createImageView(&view_info, nullptr, &view) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create offscreen image view");
+            exit(exitcode::FAILURE);
+        }
     }
 
 }
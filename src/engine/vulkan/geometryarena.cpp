@@ -0,0 +1,239 @@
+#include "engine/vulkan/geometryarena.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+#include <spdlog/spdlog.h>
+
+#include "engine/vulkan/deletionqueue.hpp"
+#include "engine/vulkan/uploadqueue.hpp"
+
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    /* FreeList */
+    std::optional<uint32_t> GeometryArena::FreeList::allocate(uint32_t count) {
+        for (auto it = free_ranges.begin(); it != free_ranges.end(); ++it) {
+            auto [offset, size] = *it;
+            if (size < count) {
+                continue;
+            }
+
+            free_ranges.erase(it);
+            if (size > count) {
+                free_ranges.emplace(offset + count, size - count);
+            }
+            return offset;
+        }
+
+        return std::nullopt;
+    }
+
+    void GeometryArena::FreeList::free(uint32_t offset, uint32_t count) {
+        auto next = free_ranges.lower_bound(offset);
+
+        if (next != free_ranges.end() && offset + count == next->first) {
+            count += next->second;
+            next = free_ranges.erase(next);
+        }
+
+        if (next != free_ranges.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += count;
+                return;
+            }
+        }
+
+        free_ranges.emplace(offset, count);
+    }
+
+    void GeometryArena::FreeList::reset(uint32_t used, uint32_t new_capacity) {
+        capacity = new_capacity;
+        free_ranges.clear();
+        if (used < capacity) {
+            free_ranges.emplace(used, capacity - used);
+        }
+    }
+
+    /* GeometryArena */
+    GeometryArena::GeometryArena(Device &device, vk::DeviceSize vertex_stride, uint32_t vertex_capacity, uint32_t index_capacity)
+        : device{device}, vertex_stride{vertex_stride} {
+        vertex_buffer = createVertexBuffer(vertex_capacity);
+        index_buffer = createIndexBuffer(index_capacity);
+        vertex_free_list.reset(0, vertex_capacity);
+        index_free_list.reset(0, index_capacity);
+    }
+
+    GeometryArena::~GeometryArena() {
+        if (!allocations.empty()) {
+            spdlog::warn("Geometry arena destroyed with {} live allocations", allocations.size());
+        }
+    }
+
+    void GeometryArena::allocate(GeometryAllocation &allocation, const void *vertices, uint32_t vertex_count, const uint32_t *indices, uint32_t index_count) {
+        std::optional<uint32_t> vertex_offset = vertex_count > 0 ? vertex_free_list.allocate(vertex_count) : std::optional<uint32_t>{0};
+        std::optional<uint32_t> first_index = index_count > 0 ? index_free_list.allocate(index_count) : std::optional<uint32_t>{0};
+
+        if (!vertex_offset || !first_index) {
+            if (vertex_offset && vertex_count > 0) {
+                vertex_free_list.free(*vertex_offset, vertex_count);
+            }
+            if (first_index && index_count > 0) {
+                index_free_list.free(*first_index, index_count);
+            }
+
+            /* Compaction alone is enough if the live ranges leave room, otherwise grow */
+            uint32_t live_vertices = 0;
+            uint32_t live_indices = 0;
+            for (const auto *live : allocations) {
+                live_vertices += live->vertex_count;
+                live_indices += live->index_count;
+            }
+
+            uint32_t new_vertex_capacity = vertex_free_list.capacity;
+            while (live_vertices + vertex_count > new_vertex_capacity) {
+                new_vertex_capacity *= 2;
+            }
+            uint32_t new_index_capacity = index_free_list.capacity;
+            while (live_indices + index_count > new_index_capacity) {
+                new_index_capacity *= 2;
+            }
+
+            rebuild(new_vertex_capacity, new_index_capacity);
+
+            vertex_offset = vertex_count > 0 ? vertex_free_list.allocate(vertex_count) : std::optional<uint32_t>{0};
+            first_index = index_count > 0 ? index_free_list.allocate(index_count) : std::optional<uint32_t>{0};
+
+            if (!vertex_offset || !first_index) {
+                spdlog::error("Failed to allocate geometry after compaction, exiting");
+                exit(exitcode::FAILURE);
+            }
+        }
+
+        allocation.vertex_offset = static_cast<int32_t>(*vertex_offset);
+        allocation.vertex_count = vertex_count;
+        allocation.first_index = *first_index;
+        allocation.index_count = index_count;
+        allocations.insert(&allocation);
+
+        auto &upload_queue = device.getUploadQueue();
+        if (vertex_count > 0) {
+            upload_queue.uploadBuffer(*vertex_buffer, vertices, vertex_count * vertex_stride, *vertex_offset * vertex_stride);
+        }
+        if (index_count > 0) {
+            upload_queue.uploadBuffer(*index_buffer, indices, index_count * sizeof(uint32_t), *first_index * sizeof(uint32_t));
+        }
+    }
+
+    void GeometryArena::free(GeometryAllocation &allocation) {
+        if (allocations.erase(&allocation) == 0) {
+            return;
+        }
+
+        /* A rebuild in the meantime already dropped the range, since it is no longer registered */
+        device.getDeletionQueue().enqueue([this, range = allocation, allocation_generation = generation]() {
+            if (allocation_generation != generation) {
+                return;
+            }
+
+            if (range.vertex_count > 0) {
+                vertex_free_list.free(static_cast<uint32_t>(range.vertex_offset), range.vertex_count);
+            }
+            if (range.index_count > 0) {
+                index_free_list.free(range.first_index, range.index_count);
+            }
+        });
+
+        allocation = GeometryAllocation{};
+    }
+
+    void GeometryArena::compact() {
+        rebuild(vertex_free_list.capacity, index_free_list.capacity);
+    }
+
+    void GeometryArena::bind(CommandRecorder &recorder) {
+        recorder.bindVertexBuffer(vertex_buffer->getBuffer());
+        recorder.bindIndexBuffer(index_buffer->getBuffer(), 0, vk::IndexType::eUint32);
+    }
+
+    std::unique_ptr<Buffer> GeometryArena::createVertexBuffer(uint32_t capacity) {
+        return std::make_unique<Buffer>(
+            device,
+            vertex_stride,
+            capacity,
+            vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            1,
+            true
+        );
+    }
+
+    std::unique_ptr<Buffer> GeometryArena::createIndexBuffer(uint32_t capacity) {
+        return std::make_unique<Buffer>(
+            device,
+            sizeof(uint32_t),
+            capacity,
+            vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+            vk::MemoryPropertyFlagBits::eDeviceLocal,
+            1,
+            true
+        );
+    }
+
+    void GeometryArena::rebuild(uint32_t new_vertex_capacity, uint32_t new_index_capacity) {
+        /* Pack live ranges in their current order to keep neighbouring meshes together */
+        std::vector<GeometryAllocation *> live(allocations.begin(), allocations.end());
+        std::sort(live.begin(), live.end(), [](const GeometryAllocation *a, const GeometryAllocation *b) {
+            return a->vertex_offset < b->vertex_offset;
+        });
+
+        auto new_vertex_buffer = createVertexBuffer(new_vertex_capacity);
+        auto new_index_buffer = createIndexBuffer(new_index_capacity);
+
+        std::vector<vk::BufferCopy> vertex_copies{};
+        std::vector<vk::BufferCopy> index_copies{};
+        uint32_t vertex_cursor = 0;
+        uint32_t index_cursor = 0;
+
+        for (auto *allocation : live) {
+            if (allocation->vertex_count > 0) {
+                vertex_copies.push_back({
+                    static_cast<uint32_t>(allocation->vertex_offset) * vertex_stride,
+                    vertex_cursor * vertex_stride,
+                    allocation->vertex_count * vertex_stride
+                });
+                allocation->vertex_offset = static_cast<int32_t>(vertex_cursor);
+                vertex_cursor += allocation->vertex_count;
+            }
+
+            if (allocation->index_count > 0) {
+                index_copies.push_back({
+                    allocation->first_index * sizeof(uint32_t),
+                    index_cursor * sizeof(uint32_t),
+                    allocation->index_count * sizeof(uint32_t)
+                });
+                allocation->first_index = index_cursor;
+                index_cursor += allocation->index_count;
+            }
+        }
+
+        auto &upload_queue = device.getUploadQueue();
+        upload_queue.copyBuffer(vertex_buffer->getBuffer(), new_vertex_buffer->getBuffer(), vertex_copies);
+        upload_queue.copyBuffer(index_buffer->getBuffer(), new_index_buffer->getBuffer(), index_copies);
+
+        spdlog::debug(
+            "Geometry arena rebuilt: {}/{} vertices, {}/{} indices",
+            vertex_cursor, new_vertex_capacity, index_cursor, new_index_capacity
+        );
+
+        /* The old buffers are released through the deletion queue once frames using them retire */
+        generation++;
+        vertex_buffer = std::move(new_vertex_buffer);
+        index_buffer = std::move(new_index_buffer);
+        vertex_free_list.reset(vertex_cursor, new_vertex_capacity);
+        index_free_list.reset(index_cursor, new_index_capacity);
+    }
+
+}
@@ -0,0 +1,152 @@
+#include "engine/vulkan/gpuprofiler.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "engine/vulkan/device.hpp"
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    GpuProfiler::Scope::Scope(GpuProfiler &profiler, vk::CommandBuffer command_buffer, const char *name)
+        : profiler{profiler}, command_buffer{command_buffer}, index{profiler.beginScope(command_buffer, name)} {}
+
+    GpuProfiler::Scope::~Scope() {
+        profiler.endScope(command_buffer, index);
+    }
+
+    GpuProfiler::GpuProfiler(Device &device, uint32_t frame_count) : device{device}, frames(frame_count) {
+        const auto physical_device = device.getPhysicalDevice();
+        const uint32_t graphics_family = device.getPhysicalQueueFamilies().graphics_family;
+
+        uint32_t queue_family_count = 0;
+        physical_device.getQueueFamilyProperties(&queue_family_count, nullptr);
+        std::vector<vk::QueueFamilyProperties> queue_families(queue_family_count);
+        physical_device.getQueueFamilyProperties(&queue_family_count, queue_families.data());
+
+        const uint32_t valid_bits = queue_families[graphics_family].timestampValidBits;
+        if (valid_bits == 0) {
+            spdlog::warn("Graphics queue does not support timestamps, GPU profiling disabled");
+            return;
+        }
+
+        enabled = true;
+        timestamp_period_ns = static_cast<double>(device.getProperties().limits.timestampPeriod);
+        timestamp_mask = valid_bits >= 64 ? ~0ull : (1ull << valid_bits) - 1;
+
+        vk::QueryPoolCreateInfo pool_info{};
+        pool_info.sType = vk::StructureType::eQueryPoolCreateInfo;
+        pool_info.queryType = vk::QueryType::eTimestamp;
+        pool_info.queryCount = MAX_SCOPES_PER_FRAME * 2;
+
+        for (auto &frame : frames) {
+            if (device.getDevice().createQueryPool(&pool_info, nullptr, &frame.query_pool) != vk::Result::eSuccess) {
+                spdlog::error("Failed to create timestamp query pool");
+                exit(exitcode::FAILURE);
+            }
+            frame.scopes.reserve(MAX_SCOPES_PER_FRAME);
+        }
+    }
+
+    GpuProfiler::~GpuProfiler() {
+        for (const auto &frame : frames) {
+            device.getDevice().destroyQueryPool(frame.query_pool, nullptr);
+        }
+    }
+
+    void GpuProfiler::beginFrame(vk::CommandBuffer command_buffer, uint32_t frame_index) {
+        if (!enabled) {
+            return;
+        }
+
+        current_frame = frame_index;
+        auto &frame = frames[frame_index];
+
+        collect(frame);
+
+        frame.scopes.clear();
+        command_buffer.resetQueryPool(frame.query_pool, 0, MAX_SCOPES_PER_FRAME * 2);
+    }
+
+    std::vector<GpuProfiler::ScopeStats> GpuProfiler::getStats() const {
+        std::vector<ScopeStats> stats{};
+        stats.reserve(histories.size());
+
+        for (const auto &[name, history] : histories) {
+            if (history.count == 0) {
+                continue;
+            }
+
+            const auto begin = history.samples.begin();
+            const auto end = begin + history.count;
+            double total = 0.0;
+            for (auto it = begin; it != end; ++it) {
+                total += *it;
+            }
+
+            stats.push_back({name, *std::min_element(begin, end), total / history.count, *std::max_element(begin, end)});
+        }
+
+        return stats;
+    }
+
+    uint32_t GpuProfiler::beginScope(vk::CommandBuffer command_buffer, const char *name) {
+        /* Scopes past the limit go unmeasured rather than overwrite each other */
+        if (!enabled || frames[current_frame].scopes.size() >= MAX_SCOPES_PER_FRAME) {
+            return INVALID_SCOPE;
+        }
+
+        auto &frame = frames[current_frame];
+        const auto index = static_cast<uint32_t>(frame.scopes.size());
+        frame.scopes.push_back(name);
+
+        command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, frame.query_pool, index * 2);
+        return index;
+    }
+
+    void GpuProfiler::endScope(vk::CommandBuffer command_buffer, uint32_t index) {
+        if (index == INVALID_SCOPE) {
+            return;
+        }
+
+        command_buffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, frames[current_frame].query_pool, index * 2 + 1);
+    }
+
+    void GpuProfiler::collect(FrameQueries &frame) {
+        if (frame.scopes.empty()) {
+            return;
+        }
+
+        /* Value then availability per query, an unfinished scope is skipped rather than waited on */
+        const auto query_count = static_cast<uint32_t>(frame.scopes.size() * 2);
+        std::vector<uint64_t> results(query_count * 2);
+        const auto result = device.getDevice().getQueryPoolResults(
+            frame.query_pool, 0, query_count,
+            results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWithAvailability
+        );
+
+        if (result != vk::Result::eSuccess && result != vk::Result::eNotReady) {
+            spdlog::warn("Failed to read timestamp queries: {}", vk::to_string(result));
+            return;
+        }
+
+        for (size_t i = 0; i < frame.scopes.size(); i++) {
+            const uint64_t *begin = &results[i * 4];
+            const uint64_t *end = &results[i * 4 + 2];
+            if (begin[1] == 0 || end[1] == 0) {
+                continue;
+            }
+
+            const uint64_t ticks = (end[0] - begin[0]) & timestamp_mask;
+            const double ms = static_cast<double>(ticks) * timestamp_period_ns / 1'000'000.0;
+
+            auto &history = histories[frame.scopes[i]];
+            history.samples[history.next] = ms;
+            history.next = (history.next + 1) % HISTORY_SIZE;
+            history.count = std::min(history.count + 1, HISTORY_SIZE);
+        }
+    }
+
+}
@@ -0,0 +1,105 @@
+#include "engine/vulkan/layoutcache.hpp"
+
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include "engine/vulkan/device.hpp"
+
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    LayoutCache::~LayoutCache() {
+        for (const auto &[key, layout] : pipeline_layouts) {
+            device.getDevice().destroyPipelineLayout(layout, nullptr);
+        }
+        for (const auto &[key, layout] : set_layouts) {
+            device.getDevice().destroyDescriptorSetLayout(layout, nullptr);
+        }
+    }
+
+    vk::DescriptorSetLayout LayoutCache::getDescriptorSetLayout(std::vector<vk::DescriptorSetLayoutBinding> bindings) {
+        /* Binding order does not change the layout, sort so it does not change the key either */
+        std::sort(bindings.begin(), bindings.end(), [](const auto &a, const auto &b) {
+            return a.binding < b.binding;
+        });
+
+        Key key{};
+        key.reserve(bindings.size() * 4);
+        for (const auto &binding : bindings) {
+            key.push_back(binding.binding);
+            key.push_back(static_cast<uint64_t>(binding.descriptorType));
+            key.push_back(binding.descriptorCount);
+            key.push_back(static_cast<uint64_t>(static_cast<VkShaderStageFlags>(binding.stageFlags)));
+        }
+
+        std::lock_guard lock{mutex};
+
+        if (auto it = set_layouts.find(key); it != set_layouts.end()) {
+            return it->second;
+        }
+
+        vk::DescriptorSetLayoutCreateInfo layout_info{};
+        layout_info.sType = vk::StructureType::eDescriptorSetLayoutCreateInfo;
+        layout_info.bindingCount = static_cast<uint32_t>(bindings.size());
+        layout_info.pBindings = bindings.data();
+
+        vk::DescriptorSetLayout layout{};
+        if (device.getDevice().createDescriptorSetLayout(&layout_info, nullptr, &layout) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create descriptor set layout");
+            exit(exitcode::FAILURE);
+        }
+
+        set_layouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    vk::PipelineLayout LayoutCache::getPipelineLayout(const std::vector<vk::DescriptorSetLayout> &set_layouts, const std::vector<vk::PushConstantRange> &push_constant_ranges) {
+        /* Set layouts are deduplicated, so their handles identify them */
+        Key key{};
+        key.reserve(1 + set_layouts.size() + push_constant_ranges.size() * 3);
+        key.push_back(set_layouts.size());
+        for (const auto layout : set_layouts) {
+            key.push_back(reinterpret_cast<uint64_t>(static_cast<VkDescriptorSetLayout>(layout)));
+        }
+        for (const auto &range : push_constant_ranges) {
+            key.push_back(static_cast<uint64_t>(static_cast<VkShaderStageFlags>(range.stageFlags)));
+            key.push_back(range.offset);
+            key.push_back(range.size);
+        }
+
+        std::lock_guard lock{mutex};
+
+        if (auto it = pipeline_layouts.find(key); it != pipeline_layouts.end()) {
+            return it->second;
+        }
+
+        vk::PipelineLayoutCreateInfo layout_info{};
+        layout_info.sType = vk::StructureType::ePipelineLayoutCreateInfo;
+        layout_info.setLayoutCount = static_cast<uint32_t>(set_layouts.size());
+        layout_info.pSetLayouts = set_layouts.data();
+        layout_info.pushConstantRangeCount = static_cast<uint32_t>(push_constant_ranges.size());
+        layout_info.pPushConstantRanges = push_constant_ranges.data();
+
+        vk::PipelineLayout layout{};
+        if (device.getDevice().createPipelineLayout(&layout_info, nullptr, &layout) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create pipeline layout");
+            exit(exitcode::FAILURE);
+        }
+
+        pipeline_layouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    size_t LayoutCache::getDescriptorSetLayoutCount() const {
+        std::lock_guard lock{mutex};
+        return set_layouts.size();
+    }
+
+    size_t LayoutCache::getPipelineLayoutCount() const {
+        std::lock_guard lock{mutex};
+        return pipeline_layouts.size();
+    }
+
+}
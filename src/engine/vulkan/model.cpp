@@ -116,90 +116,27 @@ namespace muon {
 
     /* Model */
     Model::Model(Device &device, const Builder &builder) : device{device} {
-        createVertexBuffer(builder.vertices);
-        createIndexBuffer(builder.indices);
-    }
-
-    Model::~Model() = default;
-
-    void Model::bind(vk::CommandBuffer command_buffer) {
-        const vk::Buffer buffers[] = {vertex_buffer->getBuffer()};
-        constexpr vk::DeviceSize offsets[] = {0};
-
-        command_buffer.bindVertexBuffers(0, buffers, offsets);
-
-        if (has_index_buffer) {
-            command_buffer.bindIndexBuffer(index_buffer->getBuffer(), 0, vk::IndexType::eUint32);
-        }
+        device.getGeometryArena().allocate(
+            geometry,
+            builder.vertices.data(), static_cast<uint32_t>(builder.vertices.size()),
+            builder.indices.data(), static_cast<uint32_t>(builder.indices.size())
+        );
     }
 
-    void Model::draw(vk::CommandBuffer command_buffer) {
-        if (has_index_buffer) {
-            command_buffer.drawIndexed(index_count, 1, 0, 0, 0);
-        } else {
-            command_buffer.draw(vertex_count, 1, 0, 0);
-        }
+    Model::~Model() {
+        device.getGeometryArena().free(geometry);
     }
 
-    void Model::createVertexBuffer(const std::vector<Vertex> &vertices) {
-        vertex_count = static_cast<uint32_t>(vertices.size());
-
-        uint32_t vertex_size = sizeof(vertices[0]);
-        vk::DeviceSize buffer_size = sizeof(vertices[0]) * vertex_count;
-
-        Buffer staging_buffer{
-            device,
-            vertex_size,
-            vertex_count,
-            vk::BufferUsageFlagBits::eTransferSrc,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        };
-
-        staging_buffer.map();
-        staging_buffer.writeToBuffer((void*)vertices.data());
-
-        vertex_buffer = std::make_unique<Buffer>(
-            device,
-            vertex_size,
-            vertex_count,
-            vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-            vk::MemoryPropertyFlagBits::eDeviceLocal
-        );
-
-        device.copyBuffer(staging_buffer.getBuffer(), vertex_buffer->getBuffer(), buffer_size);
+    void Model::bind(CommandRecorder &recorder) {
+        device.getGeometryArena().bind(recorder);
     }
 
-    void Model::createIndexBuffer(const std::vector<uint32_t> &indices) {
-        index_count = static_cast<uint32_t>(indices.size());
-        has_index_buffer = index_count > 0;
-
-        if (!has_index_buffer) {
-            return;
+    void Model::draw(CommandRecorder &recorder, uint32_t instance_count, uint32_t first_instance) {
+        if (geometry.index_count > 0) {
+            recorder.drawIndexed(geometry.index_count, instance_count, geometry.first_index, geometry.vertex_offset, first_instance);
+        } else {
+            recorder.draw(geometry.vertex_count, instance_count, static_cast<uint32_t>(geometry.vertex_offset), first_instance);
         }
-
-        uint32_t index_size = sizeof(indices[0]);
-        vk::DeviceSize buffer_size = sizeof(indices[0]) * index_count;
-
-        Buffer staging_buffer{
-            device,
-            index_size,
-            index_count,
-            vk::BufferUsageFlagBits::eTransferSrc,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        };
-
-        staging_buffer.map();
-        staging_buffer.writeToBuffer((void *)indices.data());
-
-        index_buffer = std::make_unique<Buffer>(
-            device,
-            index_size,
-            index_count,
-            vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst,
-            vk::MemoryPropertyFlagBits::eDeviceLocal
-        );
-
-        device.copyBuffer(staging_buffer.getBuffer(), index_buffer->getBuffer(), buffer_size);
     }
 
     std::unique_ptr<Model> Model::fromFile(Device &device, const std::string &path) {
@@ -1,6 +1,7 @@
 #include "engine/vulkan/pipeline.hpp"
 
 #include <array>
+#include <chrono>
 #include <cstdlib>
 #include <fstream>
 
@@ -11,6 +12,7 @@
 #include "engine/vulkan/model.hpp"
 #include "engine/vulkan/shaderreflection.hpp"
 #include "utils/exitcode.hpp"
+#include "utils/hash.hpp"
 
 namespace muon {
 
@@ -60,7 +62,7 @@ namespace muon {
         auto vert = readFile(vert_path);
         auto frag = readFile(frag_path);
 
-        ShaderReflection reflection{vert};
+        ShaderReflection reflection{vert_path, vert};
         auto vertex_info = reflection.getVertexInfo();
 
         createShaderModule(vert, &vert_shader_module);
@@ -112,13 +114,26 @@ namespace muon {
         pipeline_info.renderPass = config_info.render_pass;
         pipeline_info.subpass = config_info.subpass;
 
+        vk::PipelineRenderingCreateInfoKHR rendering_info{};
+        if (!config_info.render_pass) {
+            rendering_info.sType = vk::StructureType::ePipelineRenderingCreateInfoKHR;
+            rendering_info.colorAttachmentCount = static_cast<uint32_t>(config_info.colour_attachment_formats.size());
+            rendering_info.pColorAttachmentFormats = config_info.colour_attachment_formats.data();
+            rendering_info.depthAttachmentFormat = config_info.depth_attachment_format;
+            pipeline_info.pNext = &rendering_info;
+        }
+
         pipeline_info.basePipelineIndex = -1;
         pipeline_info.basePipelineHandle = nullptr;
 
-        if (device.getDevice().createGraphicsPipelines(nullptr, 1, &pipeline_info, nullptr, &graphics_pipeline) != vk::Result::eSuccess) {
+        const auto start = std::chrono::steady_clock::now();
+        if (device.getDevice().createGraphicsPipelines(device.getPipelineCache(), 1, &pipeline_info, nullptr, &graphics_pipeline) != vk::Result::eSuccess) {
             spdlog::error("Failed to create graphics pipeline");
             exit(exitcode::FAILURE);
         }
+        /* Shader code only, a fixed function change on unchanged shaders is not told apart */
+        const uint64_t fingerprint = hash::fnv1a(frag.data(), frag.size(), hash::fnv1a(vert.data(), vert.size()));
+        device.addPipelineCompileTime(std::chrono::steady_clock::now() - start, fingerprint);
     }
 
     void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo &config_info) {
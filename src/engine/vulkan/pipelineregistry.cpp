@@ -0,0 +1,171 @@
+#include "engine/vulkan/pipelineregistry.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "utils/hash.hpp"
+
+namespace muon {
+
+    /* Field by field, so padding and pNext pointers never reach the key */
+    class PipelineKeyWriter {
+    public:
+        template <typename T>
+        void add(const T &value) {
+            key.append(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        void add(const std::string &value) {
+            add(value.size());
+            key.append(value);
+        }
+
+        std::string take() { return std::move(key); }
+
+    private:
+        std::string key{};
+    };
+
+    /* The create infos point into the config itself, those pointers are rebuilt for the copy */
+    void copyPipelineConfig(const PipelineConfigInfo &src, PipelineConfigInfo &dst) {
+        dst.viewport_info = src.viewport_info;
+        dst.input_assembly_info = src.input_assembly_info;
+        dst.rasterization_info = src.rasterization_info;
+        dst.multisample_info = src.multisample_info;
+        dst.colour_blend_attachment = src.colour_blend_attachment;
+        dst.colour_blend_info = src.colour_blend_info;
+        dst.depth_stencil_info = src.depth_stencil_info;
+        dst.dynamic_state_enables = src.dynamic_state_enables;
+        dst.dynamic_state_info = src.dynamic_state_info;
+        dst.pipeline_layout = src.pipeline_layout;
+        dst.render_pass = src.render_pass;
+        dst.subpass = src.subpass;
+        dst.colour_attachment_formats = src.colour_attachment_formats;
+        dst.depth_attachment_format = src.depth_attachment_format;
+
+        dst.colour_blend_info.pAttachments = &dst.colour_blend_attachment;
+        dst.dynamic_state_info.pDynamicStates = dst.dynamic_state_enables.data();
+        dst.dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(dst.dynamic_state_enables.size());
+    }
+
+    PipelineRegistry::PipelineRegistry(Device &device)
+        : device{device}, compile_pool{std::max(1u, std::thread::hardware_concurrency() / 4)} {}
+
+    PipelineRegistry::~PipelineRegistry() {
+        waitIdle();
+    }
+
+    PipelineHandle PipelineRegistry::request(const std::string &vert_path, const std::string &frag_path, const PipelineConfigInfo &config_info) {
+        auto key = pipelineKey(vert_path, frag_path, config_info);
+
+        std::lock_guard lock{mutex};
+
+        if (auto it = entries.find(key); it != entries.end()) {
+            return PipelineHandle{it->second};
+        }
+
+        auto entry = std::make_shared<PipelineHandle::Entry>();
+        entry->vert_path = vert_path;
+        entry->frag_path = frag_path;
+        copyPipelineConfig(config_info, entry->config);
+
+        /* The entry owns the config copy, so the caller's may go out of scope before compilation */
+        entry->done = compile_pool.submit([this, entry]() {
+            entry->pipeline = std::make_unique<Pipeline>(device, entry->vert_path, entry->frag_path, entry->config);
+            entry->ready.store(true, std::memory_order_release);
+        }).share();
+
+        entries.emplace(std::move(key), entry);
+
+        return PipelineHandle{std::move(entry)};
+    }
+
+    void PipelineRegistry::waitIdle() {
+        std::vector<std::shared_future<void>> pending{};
+        {
+            std::lock_guard lock{mutex};
+            for (const auto &[key, entry] : entries) {
+                pending.push_back(entry->done);
+            }
+        }
+
+        for (const auto &future : pending) {
+            future.wait();
+        }
+    }
+
+    size_t PipelineRegistry::size() const {
+        std::lock_guard lock{mutex};
+        return entries.size();
+    }
+
+    size_t PipelineRegistry::KeyHash::operator()(const std::string &key) const {
+        return static_cast<size_t>(hash::fnv1a(key.data(), key.size()));
+    }
+
+    std::string PipelineRegistry::pipelineKey(const std::string &vert_path, const std::string &frag_path, const PipelineConfigInfo &config_info) {
+        PipelineKeyWriter key{};
+        key.add(vert_path);
+        key.add(frag_path);
+
+        const auto &input_assembly = config_info.input_assembly_info;
+        key.add(input_assembly.topology);
+        key.add(input_assembly.primitiveRestartEnable);
+
+        const auto &rasterization = config_info.rasterization_info;
+        key.add(rasterization.depthClampEnable);
+        key.add(rasterization.rasterizerDiscardEnable);
+        key.add(rasterization.polygonMode);
+        key.add(rasterization.cullMode);
+        key.add(rasterization.frontFace);
+        key.add(rasterization.depthBiasEnable);
+        key.add(rasterization.depthBiasConstantFactor);
+        key.add(rasterization.depthBiasClamp);
+        key.add(rasterization.depthBiasSlopeFactor);
+        key.add(rasterization.lineWidth);
+
+        const auto &multisample = config_info.multisample_info;
+        key.add(multisample.rasterizationSamples);
+        key.add(multisample.sampleShadingEnable);
+        key.add(multisample.minSampleShading);
+        key.add(multisample.alphaToCoverageEnable);
+        key.add(multisample.alphaToOneEnable);
+
+        const auto &blend = config_info.colour_blend_attachment;
+        key.add(blend.blendEnable);
+        key.add(blend.srcColorBlendFactor);
+        key.add(blend.dstColorBlendFactor);
+        key.add(blend.colorBlendOp);
+        key.add(blend.srcAlphaBlendFactor);
+        key.add(blend.dstAlphaBlendFactor);
+        key.add(blend.alphaBlendOp);
+        key.add(blend.colorWriteMask);
+        key.add(config_info.colour_blend_info.logicOpEnable);
+        key.add(config_info.colour_blend_info.logicOp);
+
+        const auto &depth_stencil = config_info.depth_stencil_info;
+        key.add(depth_stencil.depthTestEnable);
+        key.add(depth_stencil.depthWriteEnable);
+        key.add(depth_stencil.depthCompareOp);
+        key.add(depth_stencil.depthBoundsTestEnable);
+        key.add(depth_stencil.stencilTestEnable);
+        key.add(depth_stencil.minDepthBounds);
+        key.add(depth_stencil.maxDepthBounds);
+
+        for (const auto state : config_info.dynamic_state_enables) {
+            key.add(state);
+        }
+
+        /* Handles compare by identity, which is what pipeline compatibility needs here */
+        key.add(static_cast<VkPipelineLayout>(config_info.pipeline_layout));
+        key.add(static_cast<VkRenderPass>(config_info.render_pass));
+        key.add(config_info.subpass);
+        for (const auto format : config_info.colour_attachment_formats) {
+            key.add(format);
+        }
+        key.add(config_info.depth_attachment_format);
+
+        return key.take();
+    }
+
+}
@@ -1,36 +1,89 @@
 #include "engine/vulkan/renderer.hpp"
 
+#include <algorithm>
+#include <future>
+#include <limits>
+
 #include <SDL3/SDL_events.h>
 #include <vulkan/vulkan_core.h>
 
+#include "engine/vulkan/deletionqueue.hpp"
+#include "engine/vulkan/uploadqueue.hpp"
+
 #include "utils/exitcode.hpp"
+#include "utils/profiler.hpp"
 
 namespace muon {
 
-    Renderer::Renderer(Window &window, Device &device) : window{window}, device{device} {
+    Renderer::Renderer(Window &window, Device &device, const RendererProperties &properties)
+        : window{&window}, device{device}, properties{properties}, frame_limiter{properties.max_fps} {
+        validateProperties();
+        createSyncObjects();
         recreateSwapchain();
-        createCommandBuffers();
+        init();
+    }
+
+    Renderer::Renderer(Device &device, vk::Extent2D extent, const RendererProperties &properties)
+        : device{device}, properties{properties}, frame_limiter{properties.max_fps} {
+        validateProperties();
+        offscreen_target = std::make_unique<Framebuffer>(device, extent);
+        createSyncObjects();
+        init();
     }
 
     Renderer::~Renderer() {
+        /* Workers may still hold references to recorders, join them before the pools go */
+        thread_pool = nullptr;
+        destroyWorkerFrames();
         freeCommandBuffers();
+        destroySyncObjects();
     }
 
     vk::CommandBuffer Renderer::beginFrame() {
-        const vk::Result result = swapchain->acquireNextImage(&current_image_index);
+        MUON_PROFILE_SCOPE("Renderer::beginFrame");
 
-        if (result == vk::Result::eErrorOutOfDateKHR) {
-            recreateSwapchain();
-            return nullptr;
-        }
+        /* Before the fence wait and acquire, so the frame starts from the freshest input */
+        frame_limiter.wait();
 
-        if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
-            spdlog::error("Failed to acquire next swap chain image");
-            exit(exitcode::FAILURE);
+        /* The previous submission from this slot has to retire before its command buffer is reused */
+        fence_wait = waitForFence(in_flight_fences[current_frame_index]);
+
+        if (!isHeadless()) {
+            const vk::Result result = swapchain->acquireNextImage(image_available_semaphores[current_frame_index], &current_image_index);
+
+            if (result == vk::Result::eErrorOutOfDateKHR) {
+                recreateSwapchain();
+                return nullptr;
+            }
+
+            if (result != vk::Result::eSuccess && result != vk::Result::eSuboptimalKHR) {
+                spdlog::error("Failed to acquire next swap chain image");
+                exit(exitcode::FAILURE);
+            }
+
+            /* Images are not acquired in slot order, the image's depth buffer may still be in use by another slot */
+            auto &image_fence = images_in_flight[current_image_index];
+            if (image_fence && image_fence != in_flight_fences[current_frame_index]) {
+                fence_wait += waitForFence(image_fence);
+            }
+            image_fence = in_flight_fences[current_frame_index];
         }
 
         frame_in_progress = true;
 
+        /* The fence for this frame has signalled, so its slice of the frame allocator and its descriptor pools are free again */
+        frame_allocator->beginFrame(current_frame_index);
+        descriptor_allocator->beginFrame(current_frame_index);
+
+        /* That fence belongs to the frame frames_in_flight back, everything up to it has retired */
+        frame_count++;
+        const auto frames_in_flight = static_cast<uint64_t>(properties.frames_in_flight);
+        auto &deletion_queue = device.getDeletionQueue();
+        if (frame_count > frames_in_flight) {
+            deletion_queue.collect(frame_count - frames_in_flight);
+        }
+        deletion_queue.setCurrentFrame(frame_count);
+
         const auto command_buffer = getCurrentCommandBuffer();
 
         vk::CommandBufferBeginInfo begin_info{};
@@ -41,70 +94,218 @@ namespace muon {
             exit(exitcode::FAILURE);
         }
 
+        getCommandRecorder().begin(command_buffer);
+        secondary_stats = {};
+
+        /* Same fence, the slot's timestamps are ready to read without waiting */
+        gpu_profiler->beginFrame(command_buffer, current_frame_index);
+
         return command_buffer;
     }
 
     void Renderer::endFrame() {
+        MUON_PROFILE_SCOPE("Renderer::endFrame");
+
         const auto command_buffer = getCurrentCommandBuffer();
 
         command_buffer.end();
+        last_frame_stats = getCommandRecorder().getStats();
+        last_frame_stats += secondary_stats;
 
-        const auto result = swapchain->submitCommandBuffers(&command_buffer, &current_image_index);
+        frame_allocator->flush();
 
-        /* Resizing window */
-        if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || window.wasResized()) {
-            window.resetResized();
-            recreateSwapchain();
-        } else if (result != vk::Result::eSuccess) {
-            spdlog::error("Failed to present swapchain image");
-            exit(exitcode::FAILURE);
+        /* Uploads recorded this frame land before the frame's own commands on the same queue */
+        device.getUploadQueue().submit();
+
+        submitFrame(command_buffer);
+        last_fence_wait = fence_wait;
+
+        if (!isHeadless()) {
+            const auto result = swapchain->present(render_finished_semaphores[current_frame_index], current_image_index);
+
+            /* Resizing window */
+            if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR || window->wasResized()) {
+                window->resetResized();
+                recreateSwapchain();
+            } else if (result != vk::Result::eSuccess) {
+                spdlog::error("Failed to present swapchain image");
+                exit(exitcode::FAILURE);
+            }
         }
 
         frame_in_progress = false;
-        current_frame_index = (current_frame_index + 1) % Swapchain::MAX_FRAMES_IN_FLIGHT;
+        current_frame_index = (current_frame_index + 1) % static_cast<int32_t>(properties.frames_in_flight);
     }
 
 
-    void Renderer::beginSwapchainRenderPass(vk::CommandBuffer command_buffer) {
-        vk::RenderPassBeginInfo render_pass_info{};
-        render_pass_info.sType = vk::StructureType::eRenderPassBeginInfo;
-        render_pass_info.renderPass = swapchain->getRenderPass();
-        render_pass_info.framebuffer = swapchain->getFramebuffer(current_image_index);
+    void Renderer::beginSwapchainRenderPass(vk::CommandBuffer command_buffer, vk::SubpassContents contents) {
+        const vk::Extent2D extent = getExtent();
+
+        if (usesDynamicRendering()) {
+            beginDynamicRendering(command_buffer, contents);
+        } else {
+            vk::RenderPassBeginInfo render_pass_info{};
+            render_pass_info.sType = vk::StructureType::eRenderPassBeginInfo;
+            render_pass_info.renderPass = getSwapchainRenderPass();
+            render_pass_info.framebuffer = getCurrentFramebuffer();
 
-        render_pass_info.renderArea.setOffset({0, 0});
-        render_pass_info.renderArea.extent = swapchain->getSwapchainExtent();
+            render_pass_info.renderArea.setOffset({0, 0});
+            render_pass_info.renderArea.extent = extent;
 
-        std::array<vk::ClearValue, 2> clear_values{};
-        clear_values[0].color = clear_color;
-        clear_values[1].depthStencil = clear_depth_stencil;
+            std::array<vk::ClearValue, 2> clear_values{};
+            clear_values[0].color = clear_color;
+            clear_values[1].depthStencil = clear_depth_stencil;
 
-        render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
-        render_pass_info.pClearValues = clear_values.data();
+            render_pass_info.clearValueCount = static_cast<uint32_t>(clear_values.size());
+            render_pass_info.pClearValues = clear_values.data();
 
-        command_buffer.beginRenderPass(&render_pass_info, vk::SubpassContents::eInline);
+            command_buffer.beginRenderPass(&render_pass_info, contents);
+        }
 
-        vk::Viewport viewport{};
+        viewport = vk::Viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
-        viewport.width = static_cast<float>(swapchain->getSwapchainExtent().width);
-        viewport.height = static_cast<float>(swapchain->getSwapchainExtent().height);
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
 
-        vk::Rect2D scissor{};
+        scissor = vk::Rect2D{};
         scissor.setOffset({0, 0});
-        scissor.extent = swapchain->getSwapchainExtent();
+        scissor.extent = extent;
+
+        /* Only vkCmdExecuteCommands may follow in this subpass, secondaries set their own state */
+        if (contents == vk::SubpassContents::eSecondaryCommandBuffers) {
+            return;
+        }
 
-        command_buffer.setViewport(0, 1, &viewport);
-        command_buffer.setScissor(0, 1, &scissor);
+        auto &recorder = getCommandRecorder();
+        recorder.setViewport(viewport);
+        recorder.setScissor(scissor);
     }
 
     void Renderer::endSwapchainRenderPass(vk::CommandBuffer command_buffer) {
+        if (usesDynamicRendering()) {
+            endDynamicRendering(command_buffer);
+            return;
+        }
+
         command_buffer.endRenderPass();
     }
 
+    void Renderer::recordParallel(uint32_t draw_count, const RecordFunction &record) {
+        MUON_PROFILE_SCOPE("Renderer::recordParallel");
+
+        auto &workers = worker_frames[current_frame_index];
+
+        const uint32_t slice_count = std::clamp<uint32_t>(
+            (draw_count + MIN_DRAWS_PER_SLICE - 1) / MIN_DRAWS_PER_SLICE,
+            1,
+            static_cast<uint32_t>(workers.size())
+        );
+
+        vk::CommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = vk::StructureType::eCommandBufferInheritanceInfo;
+        inheritance_info.renderPass = getSwapchainRenderPass();
+        inheritance_info.subpass = 0;
+        inheritance_info.framebuffer = getCurrentFramebuffer();
+
+        /* Without a render pass the secondaries are told the attachment formats instead */
+        const Attachments attachments = getCurrentAttachments();
+        vk::CommandBufferInheritanceRenderingInfoKHR inheritance_rendering_info{};
+        if (usesDynamicRendering()) {
+            inheritance_rendering_info.sType = vk::StructureType::eCommandBufferInheritanceRenderingInfoKHR;
+            inheritance_rendering_info.colorAttachmentCount = 1;
+            inheritance_rendering_info.pColorAttachmentFormats = &attachments.colour_format;
+            inheritance_rendering_info.depthAttachmentFormat = attachments.depth_format;
+            inheritance_rendering_info.rasterizationSamples = vk::SampleCountFlagBits::e1;
+            inheritance_info.pNext = &inheritance_rendering_info;
+        }
+
+        auto record_slice = [&](uint32_t slice) {
+            MUON_PROFILE_SCOPE("Renderer::recordSlice");
+            auto &worker = workers[slice];
+
+            /* The frame's fence has signalled, so the whole pool can be recycled at once */
+            vkResetCommandPool(device.getDevice(), worker.command_pool, 0);
+
+            vk::CommandBufferBeginInfo begin_info{};
+            begin_info.sType = vk::StructureType::eCommandBufferBeginInfo;
+            begin_info.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+            begin_info.pInheritanceInfo = &inheritance_info;
+
+            if (worker.command_buffer.begin(&begin_info) != vk::Result::eSuccess) {
+                spdlog::error("Failed to begin recording secondary command buffer");
+                exit(exitcode::FAILURE);
+            }
+
+            /* Dynamic state is not inherited from the primary */
+            worker.recorder.begin(worker.command_buffer);
+            worker.recorder.setViewport(viewport);
+            worker.recorder.setScissor(scissor);
+
+            const auto begin = static_cast<uint32_t>(static_cast<uint64_t>(draw_count) * slice / slice_count);
+            const auto end = static_cast<uint32_t>(static_cast<uint64_t>(draw_count) * (slice + 1) / slice_count);
+            record(worker.recorder, begin, end);
+
+            worker.command_buffer.end();
+        };
+
+        std::vector<std::future<void>> futures{};
+        futures.reserve(slice_count - 1);
+        for (uint32_t slice = 1; slice < slice_count; slice++) {
+            futures.push_back(thread_pool->submit([&record_slice, slice]() { record_slice(slice); }));
+        }
+
+        /* The calling thread takes the first slice instead of idling on the join */
+        record_slice(0);
+        for (auto &future : futures) {
+            future.get();
+        }
+
+        std::vector<vk::CommandBuffer> secondaries(slice_count);
+        for (uint32_t slice = 0; slice < slice_count; slice++) {
+            secondaries[slice] = workers[slice].command_buffer;
+            secondary_stats += workers[slice].recorder.getStats();
+        }
+
+        getCurrentCommandBuffer().executeCommands(slice_count, secondaries.data());
+
+        /* Secondaries leave the primary's bound state undefined */
+        getCommandRecorder().invalidate();
+    }
+
+    void Renderer::validateProperties() {
+        if (properties.frames_in_flight < 1 || properties.frames_in_flight > Swapchain::MAX_FRAMES_IN_FLIGHT) {
+            spdlog::warn(
+                "Frames in flight must be between 1 and {}, got {}, using {}",
+                Swapchain::MAX_FRAMES_IN_FLIGHT, properties.frames_in_flight, defaults::renderer::FRAMES_IN_FLIGHT
+            );
+            properties.frames_in_flight = defaults::renderer::FRAMES_IN_FLIGHT;
+        }
+
+        spdlog::debug("Frames in flight: {}", properties.frames_in_flight);
+        if (frame_limiter.isEnabled()) {
+            spdlog::debug("Frame limit: {} FPS", properties.max_fps);
+        }
+        spdlog::debug("Parallel recording from {} draws", properties.parallel_record_threshold);
+    }
+
+    void Renderer::init() {
+        createCommandBuffers();
+
+        thread_pool = std::make_unique<ThreadPool>();
+        createWorkerFrames();
+
+        frame_allocator = std::make_unique<FrameAllocator>(device, FRAME_ALLOCATOR_SIZE, properties.frames_in_flight);
+        descriptor_allocator = std::make_unique<DescriptorAllocator>(device, properties.frames_in_flight);
+        descriptor_cache = std::make_unique<DescriptorCache>(*descriptor_allocator);
+        gpu_profiler = std::make_unique<GpuProfiler>(device, properties.frames_in_flight);
+    }
+
     void Renderer::createCommandBuffers() {
-        command_buffers.resize(Swapchain::MAX_FRAMES_IN_FLIGHT);
+        command_buffers.resize(properties.frames_in_flight);
+        command_recorders.resize(properties.frames_in_flight);
 
         vk::CommandBufferAllocateInfo alloc_info{};
         alloc_info.sType = vk::StructureType::eCommandBufferAllocateInfo;
@@ -123,26 +324,311 @@ namespace muon {
         command_buffers.clear();
     }
 
+    void Renderer::createWorkerFrames() {
+        /* The calling thread records a slice too */
+        const uint32_t slice_count = thread_pool->getThreadCount() + 1;
+
+        vk::CommandPoolCreateInfo pool_info{};
+        pool_info.sType = vk::StructureType::eCommandPoolCreateInfo;
+        pool_info.queueFamilyIndex = device.getPhysicalQueueFamilies().graphics_family;
+        pool_info.flags = vk::CommandPoolCreateFlagBits::eTransient;
+
+        worker_frames.resize(properties.frames_in_flight);
+        for (auto &workers : worker_frames) {
+            workers.resize(slice_count);
+
+            for (auto &worker : workers) {
+                if (device.getDevice().createCommandPool(&pool_info, nullptr, &worker.command_pool) != vk::Result::eSuccess) {
+                    spdlog::error("Failed to create worker command pool");
+                    exit(exitcode::FAILURE);
+                }
+
+                vk::CommandBufferAllocateInfo alloc_info{};
+                alloc_info.sType = vk::StructureType::eCommandBufferAllocateInfo;
+                alloc_info.level = vk::CommandBufferLevel::eSecondary;
+                alloc_info.commandPool = worker.command_pool;
+                alloc_info.commandBufferCount = 1;
+
+                if (device.getDevice().allocateCommandBuffers(&alloc_info, &worker.command_buffer) != vk::Result::eSuccess) {
+                    spdlog::error("Failed to allocate secondary command buffer");
+                    exit(exitcode::FAILURE);
+                }
+            }
+        }
+    }
+
+    void Renderer::destroyWorkerFrames() {
+        for (auto &workers : worker_frames) {
+            for (auto &worker : workers) {
+                /* Destroying the pool frees its command buffer */
+                device.getDevice().destroyCommandPool(worker.command_pool, nullptr);
+            }
+        }
+        worker_frames.clear();
+    }
+
     void Renderer::recreateSwapchain() {
-        auto extent = window.getExtent();
+        auto extent = window->getExtent();
         while (extent.width == 0 || extent.height == 0) {
-            extent = window.getExtent();
+            extent = window->getExtent();
             SDL_Event event;
             SDL_WaitEvent(&event);
         }
 
-        device.getDevice().waitIdle();
-
         if (swapchain == nullptr) {
-            swapchain = std::make_unique<Swapchain>(device, extent);
+            swapchain = std::make_unique<Swapchain>(device, extent, properties.present_mode);
         } else {
             std::shared_ptr old_swap_chain = std::move(swapchain);
-            swapchain = std::make_unique<Swapchain>(device, extent, old_swap_chain);
+            swapchain = std::make_unique<Swapchain>(device, extent, properties.present_mode, old_swap_chain);
             if (!swapchain->compareSwapFormats(*old_swap_chain)) {
                 spdlog::error("Swapchain does not match swap formats");
                 exit(exitcode::FAILURE);
             }
+
+            /*
+                No waitIdle, frames up to the current one may still be rendering to
+                the old images. They are tagged with this frame, so the old swapchain
+                goes once its fence has been waited on and rendering carries on
+                through a drag-resize.
+            */
+            device.getDeletionQueue().enqueue([retired = std::move(old_swap_chain)]() mutable {
+                retired = nullptr;
+            });
+        }
+
+        images_in_flight.assign(swapchain->getImageCount(), nullptr);
+    }
+
+
+    void Renderer::createSyncObjects() {
+        in_flight_fences.resize(properties.frames_in_flight);
+
+        vk::FenceCreateInfo fence_info{};
+        fence_info.sType = vk::StructureType::eFenceCreateInfo;
+        fence_info.flags = vk::FenceCreateFlagBits::eSignaled;
+
+        for (auto &fence : in_flight_fences) {
+            if (device.getDevice().createFence(&fence_info, nullptr, &fence) != vk::Result::eSuccess) {
+                spdlog::error("Failed to create frame fence");
+                exit(exitcode::FAILURE);
+            }
+        }
+
+        /* Headless frames have nothing to acquire or present */
+        if (isHeadless()) {
+            return;
+        }
+
+        image_available_semaphores.resize(properties.frames_in_flight);
+        render_finished_semaphores.resize(properties.frames_in_flight);
+
+        vk::SemaphoreCreateInfo semaphore_info{};
+        semaphore_info.sType = vk::StructureType::eSemaphoreCreateInfo;
+
+        for (uint32_t i = 0; i < properties.frames_in_flight; i++) {
+            const bool image_available_failed = device.getDevice().createSemaphore(&semaphore_info, nullptr, &image_available_semaphores[i]) != vk::Result::eSuccess;
+            const bool render_finished_failed = device.getDevice().createSemaphore(&semaphore_info, nullptr, &render_finished_semaphores[i]) != vk::Result::eSuccess;
+            if (image_available_failed || render_finished_failed) {
+                spdlog::error("Failed to create synchronisation objects for a frame");
+                exit(exitcode::FAILURE);
+            }
+        }
+    }
+
+    void Renderer::destroySyncObjects() {
+        for (const auto fence : in_flight_fences) {
+            device.getDevice().destroyFence(fence, nullptr);
+        }
+        in_flight_fences.clear();
+
+        for (const auto semaphore : image_available_semaphores) {
+            device.getDevice().destroySemaphore(semaphore, nullptr);
+        }
+        image_available_semaphores.clear();
+
+        for (const auto semaphore : render_finished_semaphores) {
+            device.getDevice().destroySemaphore(semaphore, nullptr);
+        }
+        render_finished_semaphores.clear();
+    }
+
+    std::chrono::nanoseconds Renderer::waitForFence(vk::Fence fence) {
+        MUON_PROFILE_SCOPE("Renderer::waitForFence");
+        const auto wait_start = std::chrono::steady_clock::now();
+        if (device.getDevice().waitForFences(1, &fence, vk::True, std::numeric_limits<uint64_t>::max()) != vk::Result::eSuccess) {
+            spdlog::warn("Failed to wait for fences");
+        }
+        return std::chrono::steady_clock::now() - wait_start;
+    }
+
+    void Renderer::submitFrame(vk::CommandBuffer command_buffer) {
+        auto &fence = in_flight_fences[current_frame_index];
+        if (device.getDevice().resetFences(1, &fence) != vk::Result::eSuccess) {
+            spdlog::warn("Failed to reset fences");
+        }
+
+        vk::SubmitInfo submit_info{};
+        submit_info.sType = vk::StructureType::eSubmitInfo;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &command_buffer;
+
+        /* Headless frames have no acquire to wait on and no present to signal */
+        const vk::PipelineStageFlags wait_stage = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+        if (!isHeadless()) {
+            submit_info.waitSemaphoreCount = 1;
+            submit_info.pWaitSemaphores = &image_available_semaphores[current_frame_index];
+            submit_info.pWaitDstStageMask = &wait_stage;
+            submit_info.signalSemaphoreCount = 1;
+            submit_info.pSignalSemaphores = &render_finished_semaphores[current_frame_index];
+        }
+
+        if (device.getGraphicsQueue().submit(1, &submit_info, fence) != vk::Result::eSuccess) {
+            spdlog::error("Failed to submit draw command buffer");
+            exit(exitcode::FAILURE);
+        }
+    }
+
+    vk::Framebuffer Renderer::getCurrentFramebuffer() const {
+        /* Dynamic rendering creates no framebuffers */
+        if (usesDynamicRendering()) {
+            return nullptr;
+        }
+        return swapchain ? swapchain->getFramebuffer(current_image_index) : offscreen_target->getFramebuffer();
+    }
+
+    PipelineTarget Renderer::getPipelineTarget() const {
+        PipelineTarget target{};
+        if (!usesDynamicRendering()) {
+            target.render_pass = getSwapchainRenderPass();
+            return target;
         }
+
+        const Attachments attachments = getCurrentAttachments();
+        target.colour_attachment_formats = {attachments.colour_format};
+        target.depth_attachment_format = attachments.depth_format;
+        return target;
+    }
+
+    Renderer::Attachments Renderer::getCurrentAttachments() const {
+        if (swapchain) {
+            const auto index = static_cast<int>(current_image_index);
+            return {
+                swapchain->getImage(index), swapchain->getImageView(index), swapchain->getSwapchainImageFormat(),
+                swapchain->getDepthImage(index), swapchain->getDepthImageView(index), swapchain->getSwapchainDepthFormat(),
+            };
+        }
+
+        return {
+            offscreen_target->getColorImage(), offscreen_target->getColorImageView(), offscreen_target->getColorFormat(),
+            offscreen_target->getDepthImage(), offscreen_target->getDepthImageView(), offscreen_target->getDepthFormat(),
+        };
+    }
+
+    void Renderer::beginDynamicRendering(vk::CommandBuffer command_buffer, vk::SubpassContents contents) {
+        const Attachments attachments = getCurrentAttachments();
+
+        vk::ImageAspectFlags depth_aspect = vk::ImageAspectFlagBits::eDepth;
+        if (attachments.depth_format == vk::Format::eD32SfloatS8Uint || attachments.depth_format == vk::Format::eD24UnormS8Uint) {
+            depth_aspect |= vk::ImageAspectFlagBits::eStencil;
+        }
+
+        /*
+            What the render pass's subpass dependency and initial layouts did. Both
+            attachments are cleared, so their contents are discarded, but the offscreen
+            target is shared by the frames in flight and must wait for the previous
+            frame's writes. The colour wait chains with the acquire semaphore.
+        */
+        std::array<vk::ImageMemoryBarrier, 2> barriers{};
+        barriers[0].sType = vk::StructureType::eImageMemoryBarrier;
+        barriers[0].srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        barriers[0].dstAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        barriers[0].oldLayout = vk::ImageLayout::eUndefined;
+        barriers[0].newLayout = vk::ImageLayout::eColorAttachmentOptimal;
+        barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].image = attachments.colour_image;
+        barriers[0].subresourceRange = vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+
+        barriers[1].sType = vk::StructureType::eImageMemoryBarrier;
+        barriers[1].srcAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        barriers[1].dstAccessMask = vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite;
+        barriers[1].oldLayout = vk::ImageLayout::eUndefined;
+        barriers[1].newLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+        barriers[1].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].image = attachments.depth_image;
+        barriers[1].subresourceRange = vk::ImageSubresourceRange{depth_aspect, 0, 1, 0, 1};
+
+        const auto attachment_stages = vk::PipelineStageFlagBits::eColorAttachmentOutput
+                                     | vk::PipelineStageFlagBits::eEarlyFragmentTests
+                                     | vk::PipelineStageFlagBits::eLateFragmentTests;
+        command_buffer.pipelineBarrier(
+            attachment_stages,
+            attachment_stages,
+            vk::DependencyFlags{},
+            0, nullptr,
+            0, nullptr,
+            static_cast<uint32_t>(barriers.size()), barriers.data()
+        );
+
+        vk::RenderingAttachmentInfoKHR colour_attachment{};
+        colour_attachment.sType = vk::StructureType::eRenderingAttachmentInfoKHR;
+        colour_attachment.imageView = attachments.colour_view;
+        colour_attachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+        colour_attachment.loadOp = vk::AttachmentLoadOp::eClear;
+        colour_attachment.storeOp = vk::AttachmentStoreOp::eStore;
+        colour_attachment.clearValue.color = clear_color;
+
+        vk::RenderingAttachmentInfoKHR depth_attachment{};
+        depth_attachment.sType = vk::StructureType::eRenderingAttachmentInfoKHR;
+        depth_attachment.imageView = attachments.depth_view;
+        depth_attachment.imageLayout = vk::ImageLayout::eDepthStencilAttachmentOptimal;
+        depth_attachment.loadOp = vk::AttachmentLoadOp::eClear;
+        depth_attachment.storeOp = vk::AttachmentStoreOp::eDontCare;
+        depth_attachment.clearValue.depthStencil = clear_depth_stencil;
+
+        vk::RenderingInfoKHR rendering_info{};
+        rendering_info.sType = vk::StructureType::eRenderingInfoKHR;
+        if (contents == vk::SubpassContents::eSecondaryCommandBuffers) {
+            rendering_info.flags = vk::RenderingFlagBitsKHR::eContentsSecondaryCommandBuffers;
+        }
+        rendering_info.renderArea.setOffset({0, 0});
+        rendering_info.renderArea.extent = getExtent();
+        rendering_info.layerCount = 1;
+        rendering_info.colorAttachmentCount = 1;
+        rendering_info.pColorAttachments = &colour_attachment;
+        rendering_info.pDepthAttachment = &depth_attachment;
+
+        device.beginRendering(command_buffer, rendering_info);
+    }
+
+    void Renderer::endDynamicRendering(vk::CommandBuffer command_buffer) {
+        device.endRendering(command_buffer);
+
+        /* The offscreen target stays in its attachment layout, only swapchain images are handed to presentation */
+        if (!swapchain) {
+            return;
+        }
+
+        vk::ImageMemoryBarrier barrier{};
+        barrier.sType = vk::StructureType::eImageMemoryBarrier;
+        barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+        barrier.dstAccessMask = vk::AccessFlags{};
+        barrier.oldLayout = vk::ImageLayout::eColorAttachmentOptimal;
+        barrier.newLayout = vk::ImageLayout::ePresentSrcKHR;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = swapchain->getImage(static_cast<int>(current_image_index));
+        barrier.subresourceRange = vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+
+        command_buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eColorAttachmentOutput,
+            vk::PipelineStageFlagBits::eBottomOfPipe,
+            vk::DependencyFlags{},
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
     }
 
 }
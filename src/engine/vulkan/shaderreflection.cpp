@@ -1,17 +1,28 @@
 #include "engine/vulkan/shaderreflection.hpp"
 
 #include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <type_traits>
 
 #include <spdlog/spdlog.h>
+#include <spirv_reflect.h>
 
 #include "utils/exitcode.hpp"
+#include "utils/hash.hpp"
 
 namespace muon {
 
     uint32_t formatByteSize(vk::Format format) {
-        uint32_t byte_size;
+        uint32_t byte_size = 0;
 
         switch (format) {
+            case vk::Format::eR32Sfloat:
+                byte_size = sizeof(float);
+                break;
+
             case vk::Format::eR32G32Sfloat:
                 byte_size = 2 * sizeof(float);
                 break;
@@ -20,6 +31,10 @@ namespace muon {
                 byte_size = 3 * sizeof(float);
                 break;
 
+            case vk::Format::eR32G32B32A32Sfloat:
+                byte_size = 4 * sizeof(float);
+                break;
+
             default:
                 spdlog::error("New format provided");
                 break;
@@ -28,90 +43,335 @@ namespace muon {
         return byte_size;
     }
 
-    ShaderReflection::ShaderReflection(std::vector<char> &data) {
-        SpvReflectResult result = spvReflectCreateShaderModule(data.size(), data.data(), &module);
-        if (result != SPV_REFLECT_RESULT_SUCCESS) {
-            spvReflectDestroyShaderModule(&module);
-            spdlog::error("Failed to create reflect shader module, exiting");
+    /* Reflection cache file */
+    struct ReflectionCacheHeader {
+        static constexpr uint32_t MAGIC = 0x4c46524d; /* "MRFL" */
+        static constexpr uint32_t VERSION = 1;
+
+        uint32_t magic{MAGIC};
+        uint32_t version{VERSION};
+        uint64_t spirv_hash{};
+    };
+
+    class CacheWriter {
+    public:
+        explicit CacheWriter(std::ofstream &file) : file{file} {}
+
+        template <typename T>
+        void write(const T &value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            file.write(reinterpret_cast<const char *>(&value), sizeof(T));
+        }
+
+        template <typename T>
+        void writeVector(const std::vector<T> &values) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            write(static_cast<uint32_t>(values.size()));
+            file.write(reinterpret_cast<const char *>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+        }
+
+    private:
+        std::ofstream &file;
+    };
+
+    class CacheReader {
+    public:
+        explicit CacheReader(std::ifstream &file) : file{file} {}
+
+        template <typename T>
+        bool read(T &value) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            file.read(reinterpret_cast<char *>(&value), sizeof(T));
+            return file.good();
+        }
+
+        template <typename T>
+        bool readVector(std::vector<T> &values) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            uint32_t count = 0;
+            /* Guards against allocating for a corrupt count */
+            if (!read(count) || count > MAX_ELEMENTS) {
+                return false;
+            }
+            values.resize(count);
+            file.read(reinterpret_cast<char *>(values.data()), static_cast<std::streamsize>(count * sizeof(T)));
+            return file.good();
+        }
+
+    private:
+        static constexpr uint32_t MAX_ELEMENTS = 4096;
+
+        std::ifstream &file;
+    };
+
+    /* ShaderReflection */
+    ShaderReflection::ShaderReflection(const std::string &spv_path, const std::vector<char> &data) {
+        load(spv_path, data);
+    }
+
+    ShaderReflection::ShaderReflection(const std::string &spv_path) {
+        std::ifstream file{spv_path, std::ios::ate | std::ios::binary};
+        if (!file.is_open()) {
+            spdlog::error("Failed to open file: {}", spv_path);
             exit(exitcode::FAILURE);
         }
 
-        computeVertexInfo();
-        computeDescriptorSetLayout();
+        std::vector<char> data(file.tellg());
+        file.seekg(0);
+        file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+        load(spv_path, data);
     }
 
-    ShaderReflection::~ShaderReflection() {
-        spvReflectDestroyShaderModule(&module);
+    std::vector<vk::DescriptorSetLayoutBinding> ShaderReflection::mergeSetBindings(const std::vector<const ShaderReflection *> &shaders, uint32_t set) {
+        std::vector<vk::DescriptorSetLayoutBinding> merged{};
+
+        for (const auto *shader : shaders) {
+            for (const auto &binding : shader->descriptor_bindings) {
+                if (binding.set != set) {
+                    continue;
+                }
+
+                auto it = std::find_if(merged.begin(), merged.end(), [&](const auto &existing) {
+                    return existing.binding == binding.binding;
+                });
+
+                if (it == merged.end()) {
+                    vk::DescriptorSetLayoutBinding layout_binding{};
+                    layout_binding.binding = binding.binding;
+                    layout_binding.descriptorType = binding.descriptor_type;
+                    layout_binding.descriptorCount = binding.count;
+                    layout_binding.stageFlags = shader->stage;
+                    merged.push_back(layout_binding);
+                    continue;
+                }
+
+                if (it->descriptorType != binding.descriptor_type || it->descriptorCount != binding.count) {
+                    spdlog::warn("Set {} binding {} is declared differently between stages", set, binding.binding);
+                }
+                it->stageFlags |= shader->stage;
+            }
+        }
+
+        std::sort(merged.begin(), merged.end(), [](const auto &a, const auto &b) {
+            return a.binding < b.binding;
+        });
+
+        return merged;
     }
 
-    void ShaderReflection::computeVertexInfo() {
-        uint32_t var_count = 0;
-        auto result = spvReflectEnumerateInputVariables(&module, &var_count, nullptr);
-        if (result != SPV_REFLECT_RESULT_SUCCESS) {
-            spdlog::warn("Failed to enumerate input variables, returning early");
+    std::vector<vk::PushConstantRange> ShaderReflection::mergePushConstantRanges(const std::vector<const ShaderReflection *> &shaders) {
+        std::vector<vk::PushConstantRange> merged{};
+
+        for (const auto *shader : shaders) {
+            for (const auto &range : shader->push_constant_ranges) {
+                auto it = std::find_if(merged.begin(), merged.end(), [&](const auto &existing) {
+                    return existing.offset == range.offset && existing.size == range.size;
+                });
+
+                if (it == merged.end()) {
+                    merged.push_back(range);
+                } else {
+                    it->stageFlags |= range.stageFlags;
+                }
+            }
+        }
+
+        return merged;
+    }
+
+    void ShaderReflection::load(const std::string &spv_path, const std::vector<char> &data) {
+        const uint64_t spirv_hash = hash::fnv1a(data.data(), data.size());
+        const std::string cache_path = spv_path + ".refl";
+
+        if (readCache(cache_path, spirv_hash)) {
             return;
         }
 
+        reflect(data);
+        writeCache(cache_path, spirv_hash);
+    }
+
+    void ShaderReflection::reflect(const std::vector<char> &data) {
+        SpvReflectShaderModule module{};
+        SpvReflectResult result = spvReflectCreateShaderModule(data.size(), data.data(), &module);
+        if (result != SPV_REFLECT_RESULT_SUCCESS) {
+            spvReflectDestroyShaderModule(&module);
+            spdlog::error("Failed to create reflect shader module, exiting");
+            exit(exitcode::FAILURE);
+        }
+
+        stage = static_cast<vk::ShaderStageFlagBits>(module.shader_stage);
+
+        /* Vertex inputs, only the vertex stage reads from vertex buffers */
+        uint32_t var_count = 0;
+        result = spvReflectEnumerateInputVariables(&module, &var_count, nullptr);
         std::vector<SpvReflectInterfaceVariable *> input_vars(var_count);
-        result = spvReflectEnumerateInputVariables(&module, &var_count, input_vars.data());
+        if (result == SPV_REFLECT_RESULT_SUCCESS) {
+            result = spvReflectEnumerateInputVariables(&module, &var_count, input_vars.data());
+        }
         if (result != SPV_REFLECT_RESULT_SUCCESS) {
-            spdlog::warn("Failed to enumerate input variables, returning early");
-            return;
+            spdlog::warn("Failed to enumerate input variables");
+            input_vars.clear();
         }
 
+        /* Built ins such as gl_InstanceIndex have no location and no vertex buffer backing */
+        std::erase_if(input_vars, [](const SpvReflectInterfaceVariable *var) {
+            return (var->decoration_flags & SPV_REFLECT_DECORATION_BUILT_IN) != 0;
+        });
+
         std::sort(input_vars.begin(), input_vars.end(),
             [](const SpvReflectInterfaceVariable *a, const SpvReflectInterfaceVariable *b) {
                 return a->location < b->location;
             }
         );
 
-        vertex_info.attribute_descriptions.reserve(var_count);
+        if (stage == vk::ShaderStageFlagBits::eVertex) {
+            vertex_info.attribute_descriptions.reserve(input_vars.size());
 
-        uint32_t total_offset = 0;
-        for (int i = 0; i < var_count; i++) {
-            const SpvReflectInterfaceVariable &var = *(input_vars[i]);
+            uint32_t total_offset = 0;
+            for (const auto *var : input_vars) {
+                auto format = vk::Format(var->format);
+                vertex_info.attribute_descriptions.push_back({
+                    var->location,
+                    0,
+                    format,
+                    total_offset
+                });
+                total_offset += formatByteSize(format);
+            }
 
-            auto format = vk::Format(var.format);
-            vertex_info.attribute_descriptions.push_back({
-                var.location,
+            vertex_info.binding_descriptions.push_back({
                 0,
-                format,
-                total_offset
+                total_offset,
+                vk::VertexInputRate::eVertex
             });
-            auto offset = formatByteSize(vk::Format(var.format));
-            total_offset += offset;
         }
 
-        vertex_info.binding_descriptions.push_back({
-            0,
-            total_offset,
-            vk::VertexInputRate::eVertex
-        });
-    }
+        /* Descriptor bindings */
+        uint32_t binding_count = 0;
+        result = spvReflectEnumerateDescriptorBindings(&module, &binding_count, nullptr);
+        std::vector<SpvReflectDescriptorBinding *> bindings(binding_count);
+        if (result == SPV_REFLECT_RESULT_SUCCESS) {
+            result = spvReflectEnumerateDescriptorBindings(&module, &binding_count, bindings.data());
+        }
+        if (result != SPV_REFLECT_RESULT_SUCCESS) {
+            spdlog::warn("Failed to enumerate descriptor bindings");
+            bindings.clear();
+        }
 
+        for (const auto *binding : bindings) {
+            descriptor_bindings.push_back({
+                binding->set,
+                binding->binding,
+                static_cast<vk::DescriptorType>(binding->descriptor_type),
+                std::max(binding->count, 1u)
+            });
+        }
 
-    void ShaderReflection::computeDescriptorSetLayout() {
-        uint32_t desc_count = 0;
-        auto result = spvReflectEnumerateDescriptorSets(&module, &desc_count, nullptr);
+        /* Push constants */
+        uint32_t block_count = 0;
+        result = spvReflectEnumeratePushConstantBlocks(&module, &block_count, nullptr);
+        std::vector<SpvReflectBlockVariable *> blocks(block_count);
+        if (result == SPV_REFLECT_RESULT_SUCCESS) {
+            result = spvReflectEnumeratePushConstantBlocks(&module, &block_count, blocks.data());
+        }
         if (result != SPV_REFLECT_RESULT_SUCCESS) {
-            spdlog::warn("Failed to enumerate descriptor sets, returning early");
-            return;
+            spdlog::warn("Failed to enumerate push constant blocks");
+            blocks.clear();
         }
 
-        std::vector<SpvReflectDescriptorSet *> desc_sets(desc_count);
-        result = spvReflectEnumerateDescriptorSets(&module, &desc_count, desc_sets.data());
+        for (const auto *block : blocks) {
+            push_constant_ranges.push_back({stage, block->offset, block->size});
+        }
+
+        /* Specialization constants */
+        uint32_t constant_count = 0;
+        result = spvReflectEnumerateSpecializationConstants(&module, &constant_count, nullptr);
+        std::vector<SpvReflectSpecializationConstant *> constants(constant_count);
+        if (result == SPV_REFLECT_RESULT_SUCCESS) {
+            result = spvReflectEnumerateSpecializationConstants(&module, &constant_count, constants.data());
+        }
         if (result != SPV_REFLECT_RESULT_SUCCESS) {
-            spdlog::warn("Failed to enumerate descriptor sets, returning early");
-            return;
+            spdlog::warn("Failed to enumerate specialization constants");
+            constants.clear();
+        }
+
+        for (const auto *constant : constants) {
+            specialization_constants.push_back({constant->constant_id});
+        }
+
+        spvReflectDestroyShaderModule(&module);
+    }
+
+    bool ShaderReflection::readCache(const std::string &cache_path, uint64_t spirv_hash) {
+        std::ifstream file{cache_path, std::ios::binary};
+        if (!file.is_open()) {
+            return false;
+        }
+
+        CacheReader reader{file};
+
+        ReflectionCacheHeader header{};
+        if (!reader.read(header) || header.magic != ReflectionCacheHeader::MAGIC || header.version != ReflectionCacheHeader::VERSION || header.spirv_hash != spirv_hash) {
+            return false;
+        }
+
+        const bool complete = reader.read(stage)
+            && reader.readVector(vertex_info.attribute_descriptions)
+            && reader.readVector(vertex_info.binding_descriptions)
+            && reader.readVector(descriptor_bindings)
+            && reader.readVector(push_constant_ranges)
+            && reader.readVector(specialization_constants);
+
+        if (!complete) {
+            spdlog::warn("Truncated reflection cache {}, reflecting again", cache_path);
+            vertex_info = VertexInfo{};
+            descriptor_bindings.clear();
+            push_constant_ranges.clear();
+            specialization_constants.clear();
+            return false;
         }
 
-        for (int i = 0; i < desc_count; i++) {
-            spdlog::debug("Set location: {}", desc_sets[i]->set);
+        return true;
+    }
+
+    void ShaderReflection::writeCache(const std::string &cache_path, uint64_t spirv_hash) const {
+        /* Pipelines compile concurrently and may share a shader, each writer gets its own temp file */
+        const auto thread_hash = std::hash<std::thread::id>{}(std::this_thread::get_id());
+        const std::string temp_path = cache_path + ".tmp" + std::to_string(thread_hash);
+
+        {
+            std::ofstream file{temp_path, std::ios::binary | std::ios::trunc};
+            if (!file.is_open()) {
+                spdlog::debug("Could not write reflection cache {}", cache_path);
+                return;
+            }
+
+            CacheWriter writer{file};
+
+            ReflectionCacheHeader header{};
+            header.spirv_hash = spirv_hash;
+            writer.write(header);
+
+            writer.write(stage);
+            writer.writeVector(vertex_info.attribute_descriptions);
+            writer.writeVector(vertex_info.binding_descriptions);
+            writer.writeVector(descriptor_bindings);
+            writer.writeVector(push_constant_ranges);
+            writer.writeVector(specialization_constants);
 
-            for (int j = 0; j < desc_sets[i]->binding_count; j++) {
-                spdlog::debug("Binding location: {}", j);
-                spdlog::debug("Descriptor name: {}", desc_sets[i]->bindings[j]->name);
+            if (!file.good()) {
+                spdlog::debug("Could not write reflection cache {}", cache_path);
+                file.close();
+                std::remove(temp_path.c_str());
+                return;
             }
         }
+
+        if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+            std::remove(temp_path.c_str());
+        }
     }
+
 }
@@ -1,17 +1,22 @@
 #include "engine/vulkan/swapchain.hpp"
 
+#include <algorithm>
+
 #include <vulkan/vulkan.hpp>
 
 #include "utils/exitcode.hpp"
+#include "utils/profiler.hpp"
 
 
 namespace muon {
 
-    Swapchain::Swapchain(Device &device, vk::Extent2D window_extent) : device{device}, window_extent{window_extent} {
+    Swapchain::Swapchain(Device &device, vk::Extent2D window_extent, vk::PresentModeKHR present_mode)
+        : device{device}, window_extent{window_extent}, preferred_present_mode{present_mode} {
         init();
     }
 
-    Swapchain::Swapchain(Device &device, vk::Extent2D window_extent, std::shared_ptr<Swapchain> previous) : device{device}, window_extent{window_extent}, old_swapchain{previous} {
+    Swapchain::Swapchain(Device &device, vk::Extent2D window_extent, vk::PresentModeKHR present_mode, std::shared_ptr<Swapchain> previous)
+        : device{device}, window_extent{window_extent}, preferred_present_mode{present_mode}, old_swapchain{previous} {
         init();
         old_swapchain = nullptr;
     }
@@ -29,20 +34,15 @@ namespace muon {
 
         for (int i = 0; i < depth_images.size(); i++) {
             device.getDevice().destroyImageView(depth_image_views[i], nullptr);
-            device.getDevice().destroyImage(depth_images[i], nullptr);
-            device.getDevice().freeMemory(depth_image_memories[i], nullptr);
+            vmaDestroyImage(device.getAllocator(), depth_images[i], depth_image_allocations[i]);
         }
 
         for (auto framebuffer : swapchain_framebuffers) {
             device.getDevice().destroyFramebuffer(framebuffer, nullptr);
         }
 
-        device.getDevice().destroyRenderPass(render_pass, nullptr);
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            device.getDevice().destroySemaphore(render_finished_semaphores[i], nullptr);
-            device.getDevice().destroySemaphore(image_available_semaphores[i], nullptr);
-            device.getDevice().destroyFence(in_flight_fences[i], nullptr);
+        if (render_pass) {
+            device.getDevice().destroyRenderPass(render_pass, nullptr);
         }
     }
 
@@ -54,77 +54,35 @@ namespace muon {
         return device.findSupportedFormat(candidates, tiling, features);
     }
 
-    vk::Result Swapchain::acquireNextImage(uint32_t* image_index) {
-        auto result = device.getDevice().waitForFences(1, &in_flight_fences[current_frame], vk::True, std::numeric_limits<uint64_t>::max());
-        if (result != vk::Result::eSuccess) {
-            spdlog::warn("Failed to wait for fences");
-        }
-
-        result = device.getDevice().acquireNextImageKHR(
+    vk::Result Swapchain::acquireNextImage(vk::Semaphore image_available, uint32_t *image_index) {
+        /* Blocks when no image is free, mostly under FIFO */
+        MUON_PROFILE_SCOPE("Swapchain::acquireNextImage");
+        return device.getDevice().acquireNextImageKHR(
             swapchain,
             std::numeric_limits<uint64_t>::max(),
-            image_available_semaphores[current_frame],
+            image_available,
             nullptr,
             image_index
         );
-
-        return result;
     }
 
-    vk::Result Swapchain::submitCommandBuffers(const vk::CommandBuffer* buffers, uint32_t* image_index) {
-        if (images_in_flight[*image_index] != nullptr) {
-            auto result = device.getDevice().waitForFences(1, &images_in_flight[*image_index], vk::True, UINT64_MAX);
-            if (result != vk::Result::eSuccess) {
-                spdlog::warn("Failed to wait for fences");
-            }
-        }
-        images_in_flight[*image_index] = in_flight_fences[current_frame];
-
-        vk::SubmitInfo submitInfo = {};
-        submitInfo.sType = vk::StructureType::eSubmitInfo;
-
-        vk::Semaphore wait_semaphores[] = {image_available_semaphores[current_frame]};
-        vk::PipelineStageFlags wait_stages[] = {vk::PipelineStageFlagBits::eColorAttachmentOutput};
-        submitInfo.waitSemaphoreCount = 1;
-        submitInfo.pWaitSemaphores = wait_semaphores;
-        submitInfo.pWaitDstStageMask = wait_stages;
-
-        submitInfo.commandBufferCount = 1;
-        submitInfo.pCommandBuffers = buffers;
-
-        vk::Semaphore signal_semaphores[] = {render_finished_semaphores[current_frame]};
-        submitInfo.signalSemaphoreCount = 1;
-        submitInfo.pSignalSemaphores = signal_semaphores;
-
-        auto result = device.getDevice().resetFences(1, &in_flight_fences[current_frame]);
-        if (result != vk::Result::eSuccess) {
-            spdlog::warn("Failed to reset fences");
-        }
-        result = device.getGraphicsQueue().submit(1, &submitInfo, in_flight_fences[current_frame]);
-        if (result != vk::Result::eSuccess) {
-            spdlog::error("Failed to submit draw command buffer");
-            exit(exitcode::FAILURE);
-        }
-
+    vk::Result Swapchain::present(vk::Semaphore render_finished, uint32_t image_index) {
         vk::PresentInfoKHR present_info = {};
         present_info.sType = vk::StructureType::ePresentInfoKHR;
 
         present_info.waitSemaphoreCount = 1;
-        present_info.pWaitSemaphores = signal_semaphores;
+        present_info.pWaitSemaphores = &render_finished;
 
-        vk::SwapchainKHR swapchains[] = {swapchain};
         present_info.swapchainCount = 1;
-        present_info.pSwapchains = swapchains;
+        present_info.pSwapchains = &swapchain;
 
-        present_info.pImageIndices = image_index;
+        present_info.pImageIndices = &image_index;
 
-        result = device.getPresentQueue().presentKHR(&present_info);
+        const auto result = device.getPresentQueue().presentKHR(&present_info);
         if (result != vk::Result::eSuccess) {
             spdlog::warn("Failed to present swapchain");
         }
 
-        current_frame = (current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
-
         return result;
     }
 
@@ -137,16 +95,18 @@ namespace muon {
         createSwapchain();
         createImageViews();
         createDepthResources();
-        createRenderPass();
-        createFramebuffers();
-        createSyncObjects();
+        /* With dynamic rendering the renderer begins rendering on the image views directly */
+        if (!device.hasDynamicRendering()) {
+            createRenderPass();
+            createFramebuffers();
+        }
     }
 
     void Swapchain::createSwapchain() {
         SwapchainSupportDetails swapchain_support = device.getSwapchainSupport();
 
         vk::SurfaceFormatKHR surface_format = chooseSwapSurfaceFormat(swapchain_support.formats);
-        vk::PresentModeKHR present_mode = chooseSwapPresentMode(swapchain_support.present_modes);
+        present_mode = chooseSwapPresentMode(swapchain_support.present_modes);
         vk::Extent2D extent = chooseSwapExtent(swapchain_support.capabilities);
 
         uint32_t image_count = swapchain_support.capabilities.minImageCount + 1;
@@ -233,7 +193,7 @@ namespace muon {
         vk::Extent2D swapchain_extent = getSwapchainExtent();
 
         depth_images.resize(getImageCount());
-        depth_image_memories.resize(getImageCount());
+        depth_image_allocations.resize(getImageCount());
         depth_image_views.resize(getImageCount());
 
         for (int i = 0; i < depth_images.size(); i++) {
@@ -253,7 +213,7 @@ namespace muon {
             image_info.sharingMode = vk::SharingMode::eExclusive;
             image_info.flags = vk::ImageCreateFlags{};
 
-            device.createImageWithInfo(image_info, vk::MemoryPropertyFlagBits::eDeviceLocal, depth_images[i], depth_image_memories[i]);
+            device.createImageWithInfo(image_info, vk::MemoryPropertyFlagBits::eDeviceLocal, depth_images[i], depth_image_allocations[i]);
 
             vk::ImageViewCreateInfo view_info{};
             view_info.sType = vk::StructureType::eImageViewCreateInfo;
@@ -354,30 +314,6 @@ namespace muon {
         }
     }
 
-    void Swapchain::createSyncObjects() {
-        image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
-        images_in_flight.resize(getImageCount(), nullptr);
-
-        vk::SemaphoreCreateInfo semaphore_info = {};
-        semaphore_info.sType = vk::StructureType::eSemaphoreCreateInfo;
-
-        vk::FenceCreateInfo fence_info = {};
-        fence_info.sType = vk::StructureType::eFenceCreateInfo;
-        fence_info.flags = vk::FenceCreateFlagBits::eSignaled;
-
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            bool semaphore_result_a = device.getDevice().createSemaphore(&semaphore_info, nullptr, &image_available_semaphores[i]) != vk::Result::eSuccess;
-            bool semaphore_result_b = device.getDevice().createSemaphore(&semaphore_info, nullptr, &render_finished_semaphores[i]) != vk::Result::eSuccess;
-            bool fence_result = device.getDevice().createFence(&fence_info, nullptr, &in_flight_fences[i]) != vk::Result::eSuccess;
-            if (semaphore_result_a || semaphore_result_b || fence_result) {
-                spdlog::error("Failed to create synchronisation objects for a frame");
-                exit(exitcode::FAILURE);
-            }
-        }
-    }
-
     vk::SurfaceFormatKHR Swapchain::chooseSwapSurfaceFormat(const std::vector<vk::SurfaceFormatKHR> &available_formats) {
         for (const auto &available_format : available_formats) {
             bool correct_format = available_format.format == vk::Format::eB8G8R8A8Srgb;
@@ -391,14 +327,14 @@ namespace muon {
     }
 
     vk::PresentModeKHR Swapchain::chooseSwapPresentMode(const std::vector<vk::PresentModeKHR> &available_present_modes) {
-        // for (const auto &available_present_mode : available_present_modes) {
-        //     if (available_present_mode == vk::PresentModeKHR::eMailbox) {
-        //         spdlog::debug("Present mode: Mailbox");
-        //         return available_present_mode;
-        //     }
-        // }
-
-        spdlog::debug("Present mode: V-Sync");
+        const bool supported = std::find(available_present_modes.begin(), available_present_modes.end(), preferred_present_mode) != available_present_modes.end();
+        if (supported) {
+            spdlog::debug("Present mode: {}", vk::to_string(preferred_present_mode));
+            return preferred_present_mode;
+        }
+
+        /* FIFO is the one mode every surface has to support */
+        spdlog::warn("Present mode {} is not supported, falling back to Fifo", vk::to_string(preferred_present_mode));
         return vk::PresentModeKHR::eFifo;
     }
 
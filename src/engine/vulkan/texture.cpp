@@ -6,9 +6,8 @@
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_enums.hpp>
 
-#include "engine/vulkan/buffer.hpp"
-
-#include "utils/exitcode.hpp"
+#include "engine/vulkan/deletionqueue.hpp"
+#include "engine/vulkan/uploadqueue.hpp"
 
 namespace muon {
 
@@ -32,10 +31,13 @@ namespace muon {
     }
 
     Texture::~Texture() {
-        device.getDevice().destroyImage(image, nullptr);
-        device.getDevice().freeMemory(image_memory, nullptr);
-        device.getDevice().destroyImageView(image_view, nullptr);
-        device.getDevice().destroySampler(sampler, nullptr);
+        /* The slot is only reused once no frame in flight can still sample it */
+        device.getDeletionQueue().enqueue([&device = device, image = image, image_allocation = image_allocation, image_view = image_view, sampler = sampler, bindless_index = bindless_index]() {
+            device.getBindlessTable().removeTexture(bindless_index);
+            device.getDevice().destroyImageView(image_view, nullptr);
+            device.getDevice().destroySampler(sampler, nullptr);
+            vmaDestroyImage(device.getAllocator(), image, image_allocation);
+        });
     }
 
     vk::DescriptorImageInfo Texture::descriptorInfo() const {
@@ -48,17 +50,6 @@ namespace muon {
     }
 
     void Texture::createTexture(void *image_data) {
-        Buffer staging_buffer{
-            device,
-            instance_size,
-            width * height,
-            vk::BufferUsageFlagBits::eTransferSrc,
-            vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent,
-        };
-
-        staging_buffer.map();
-        staging_buffer.writeToBuffer(image_data);
-
         vk::ImageCreateInfo image_info{};
         image_info.sType = vk::StructureType::eImageCreateInfo;
         image_info.imageType = vk::ImageType::e2D;
@@ -74,13 +65,9 @@ namespace muon {
         image_info.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
         image_info.sharingMode = vk::SharingMode::eExclusive;
 
-        device.createImageWithInfo(image_info, vk::MemoryPropertyFlagBits::eDeviceLocal, image, image_memory);
-
-        transitionImageLayout(vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal);
-
-        device.copyBufferToImage(staging_buffer.getBuffer(), image, width, height, 1);
+        device.createImageWithInfo(image_info, vk::MemoryPropertyFlagBits::eDeviceLocal, image, image_allocation);
 
-        transitionImageLayout(vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eShaderReadOnlyOptimal);
+        device.getUploadQueue().uploadImage(image, image_data, width, height, instance_size);
 
         image_layout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
@@ -121,47 +108,8 @@ namespace muon {
         if (result != vk::Result::eSuccess) {
             spdlog::warn("Failed to create image view");
         }
-    }
-
-    void Texture::transitionImageLayout(vk::ImageLayout old_layout, vk::ImageLayout new_layout) {
-        vk::CommandBuffer command_buffer = device.beginSingleTimeCommands();
-
-        vk::ImageMemoryBarrier barrier{};
-        barrier.sType = vk::StructureType::eImageMemoryBarrier;
-        barrier.oldLayout = old_layout;
-        barrier.newLayout = new_layout;
-        barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
-        barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
-        barrier.image = image;
-        barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = 1;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-
-        vk::PipelineStageFlags source_stage;
-        vk::PipelineStageFlags destination_stage;
-
-        if (old_layout == vk::ImageLayout::eUndefined && new_layout == vk::ImageLayout::eTransferDstOptimal) {
-            barrier.srcAccessMask = vk::AccessFlags{};
-            barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
-
-            source_stage = vk::PipelineStageFlagBits::eTopOfPipe;
-            destination_stage = vk::PipelineStageFlagBits::eTransfer;
-        } else if (old_layout == vk::ImageLayout::eTransferDstOptimal && new_layout == vk::ImageLayout::eShaderReadOnlyOptimal) {
-            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-            barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-            source_stage = vk::PipelineStageFlagBits::eTransfer;
-            destination_stage = vk::PipelineStageFlagBits::eFragmentShader;
-        } else {
-            spdlog::error("Unsupported layout transition, exiting");
-            exit(exitcode::FAILURE);
-        }
-
-        command_buffer.pipelineBarrier(source_stage, destination_stage, vk::DependencyFlags{}, 0, nullptr, 0, nullptr, 1, &barrier);
 
-        device.endSingleTimeCommands(command_buffer);
+        bindless_index = device.getBindlessTable().addTexture(descriptorInfo());
     }
 
 }
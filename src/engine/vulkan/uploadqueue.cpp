@@ -0,0 +1,465 @@
+#include "engine/vulkan/uploadqueue.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#include <spdlog/spdlog.h>
+
+#include "engine/vulkan/buffer.hpp"
+
+#include "utils/exitcode.hpp"
+
+namespace muon {
+
+    UploadQueue::UploadQueue(Device &device) : device{device} {
+        QueueFamilyIndices indices = device.getPhysicalQueueFamilies();
+        graphics_family = indices.graphics_family;
+        transfer_family = indices.transfer_family;
+        use_transfer_queue = device.hasTransferQueue();
+
+        createCommandPool();
+    }
+
+    UploadQueue::~UploadQueue() {
+        submit();
+
+        for (auto &batch : in_flight) {
+            auto result = device.getDevice().waitForFences(1, &batch.fence, vk::True, std::numeric_limits<uint64_t>::max());
+            if (result != vk::Result::eSuccess) {
+                spdlog::warn("Failed to wait for upload fence");
+            }
+            destroyBatch(batch);
+        }
+        in_flight.clear();
+
+        for (auto &batch : free_batches) {
+            destroyBatch(batch);
+        }
+        free_batches.clear();
+
+        free_blocks.clear();
+        device.getDevice().destroyCommandPool(command_pool, nullptr);
+    }
+
+    UploadToken UploadQueue::uploadBuffer(Buffer &dst_buffer, const void *data, vk::DeviceSize size, vk::DeviceSize dst_offset) {
+        beginBatch();
+
+        auto staging = stage(data, size, 4);
+
+        vk::BufferCopy copy_region{};
+        copy_region.srcOffset = staging.offset;
+        copy_region.dstOffset = dst_offset;
+        copy_region.size = size;
+        copyCommandBuffer().copyBuffer(staging.buffer, dst_buffer.getBuffer(), 1, &copy_region);
+
+        if (transfersOwnership() && !dst_buffer.isShared()) {
+            vk::BufferMemoryBarrier barrier{};
+            barrier.sType = vk::StructureType::eBufferMemoryBarrier;
+            barrier.srcQueueFamilyIndex = transfer_family;
+            barrier.dstQueueFamilyIndex = graphics_family;
+            barrier.buffer = dst_buffer.getBuffer();
+            barrier.offset = dst_offset;
+            barrier.size = size;
+            barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+            barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead
+                                  | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead;
+            pending_buffer_barriers.push_back(barrier);
+        }
+
+        has_buffer_uploads = true;
+
+        return recording.token;
+    }
+
+    UploadToken UploadQueue::uploadImage(vk::Image image, const void *data, uint32_t width, uint32_t height, uint32_t texel_size, uint32_t layer_count) {
+        beginBatch();
+
+        vk::DeviceSize size = static_cast<vk::DeviceSize>(width) * height * texel_size * layer_count;
+        /* Copy offsets must be a multiple of both the texel size and 4 */
+        auto staging = stage(data, size, std::lcm(texel_size, 4u));
+
+        vk::ImageMemoryBarrier barrier{};
+        barrier.sType = vk::StructureType::eImageMemoryBarrier;
+        barrier.oldLayout = vk::ImageLayout::eUndefined;
+        barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.srcQueueFamilyIndex = vk::QueueFamilyIgnored;
+        barrier.dstQueueFamilyIndex = vk::QueueFamilyIgnored;
+        barrier.image = image;
+        barrier.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = layer_count;
+        barrier.srcAccessMask = vk::AccessFlags{};
+        barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+
+        copyCommandBuffer().pipelineBarrier(
+            vk::PipelineStageFlagBits::eTopOfPipe,
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::DependencyFlags{},
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+
+        vk::BufferImageCopy region{};
+        region.bufferOffset = staging.offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = layer_count;
+
+        region.setImageOffset({0, 0, 0});
+        region.setImageExtent({width, height, 1});
+
+        copyCommandBuffer().copyBufferToImage(staging.buffer, image, vk::ImageLayout::eTransferDstOptimal, 1, &region);
+
+        /* Transitions to shader read are batched into one barrier on submit */
+        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+        if (transfersOwnership()) {
+            barrier.srcQueueFamilyIndex = transfer_family;
+            barrier.dstQueueFamilyIndex = graphics_family;
+        }
+        pending_image_barriers.push_back(barrier);
+
+        return recording.token;
+    }
+
+    UploadToken UploadQueue::copyBuffer(vk::Buffer src_buffer, vk::Buffer dst_buffer, const std::vector<vk::BufferCopy> &regions) {
+        if (regions.empty()) {
+            return next_token - 1;
+        }
+
+        /*
+            Device local copies stay on the graphics queue, which owns both buffers.
+            Anything already recorded may write the source, so flush it first.
+        */
+        if (is_recording && (has_buffer_uploads || !pending_image_barriers.empty())) {
+            submit();
+        }
+        beginBatch();
+
+        vk::MemoryBarrier barrier{};
+        barrier.sType = vk::StructureType::eMemoryBarrier;
+        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+        recording.command_buffer.pipelineBarrier(
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::PipelineStageFlagBits::eTransfer,
+            vk::DependencyFlags{},
+            1, &barrier,
+            0, nullptr,
+            0, nullptr
+        );
+
+        recording.command_buffer.copyBuffer(src_buffer, dst_buffer, static_cast<uint32_t>(regions.size()), regions.data());
+
+        has_graphics_copies = true;
+
+        return recording.token;
+    }
+
+    UploadToken UploadQueue::submit() {
+        collect();
+
+        if (!is_recording) {
+            return next_token - 1;
+        }
+
+        if (use_transfer_queue) {
+            /* Release half of the ownership transfer, must match the acquire below */
+            if (transfersOwnership()) {
+                auto release_buffer_barriers = pending_buffer_barriers;
+                for (auto &barrier : release_buffer_barriers) {
+                    barrier.dstAccessMask = vk::AccessFlags{};
+                }
+                auto release_image_barriers = pending_image_barriers;
+                for (auto &barrier : release_image_barriers) {
+                    barrier.dstAccessMask = vk::AccessFlags{};
+                }
+
+                recording.transfer_command_buffer.pipelineBarrier(
+                    vk::PipelineStageFlagBits::eTransfer,
+                    vk::PipelineStageFlagBits::eBottomOfPipe,
+                    vk::DependencyFlags{},
+                    0, nullptr,
+                    static_cast<uint32_t>(release_buffer_barriers.size()), release_buffer_barriers.data(),
+                    static_cast<uint32_t>(release_image_barriers.size()), release_image_barriers.data()
+                );
+
+                for (auto &barrier : pending_buffer_barriers) {
+                    barrier.srcAccessMask = vk::AccessFlags{};
+                }
+                for (auto &barrier : pending_image_barriers) {
+                    barrier.srcAccessMask = vk::AccessFlags{};
+                }
+            }
+
+            recording.transfer_command_buffer.end();
+
+            vk::SubmitInfo transfer_submit_info{};
+            transfer_submit_info.sType = vk::StructureType::eSubmitInfo;
+            transfer_submit_info.commandBufferCount = 1;
+            transfer_submit_info.pCommandBuffers = &recording.transfer_command_buffer;
+            transfer_submit_info.signalSemaphoreCount = 1;
+            transfer_submit_info.pSignalSemaphores = &recording.transfer_semaphore;
+
+            auto result = device.getTransferQueue().submit(1, &transfer_submit_info, nullptr);
+            if (result != vk::Result::eSuccess) {
+                spdlog::error("Failed to submit upload batch to transfer queue, exiting");
+                exit(exitcode::FAILURE);
+            }
+        }
+
+        /*
+            Only the stages that read uploads wait on the copies, so later frames keep
+            running everything up to vertex input. Transfer is one of them, copyBuffer
+            reads arenas the transfer queue writes. The barrier starts from those same
+            stages to chain onto the semaphore wait.
+        */
+        const vk::PipelineStageFlags consumer_stages = vk::PipelineStageFlagBits::eTransfer
+                                                     | vk::PipelineStageFlagBits::eVertexInput
+                                                     | vk::PipelineStageFlagBits::eVertexShader
+                                                     | vk::PipelineStageFlagBits::eFragmentShader;
+        auto src_stage = use_transfer_queue ? consumer_stages : vk::PipelineStageFlags{vk::PipelineStageFlagBits::eTransfer};
+
+        vk::MemoryBarrier memory_barrier{};
+        memory_barrier.sType = vk::StructureType::eMemoryBarrier;
+        memory_barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+        memory_barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead | vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead
+                                     | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead;
+        bool use_memory_barrier = has_buffer_uploads || has_graphics_copies;
+
+        recording.command_buffer.pipelineBarrier(
+            src_stage,
+            consumer_stages,
+            vk::DependencyFlags{},
+            use_memory_barrier ? 1 : 0, &memory_barrier,
+            static_cast<uint32_t>(pending_buffer_barriers.size()), pending_buffer_barriers.data(),
+            static_cast<uint32_t>(pending_image_barriers.size()), pending_image_barriers.data()
+        );
+
+        recording.command_buffer.end();
+
+        vk::PipelineStageFlags wait_stage = consumer_stages;
+
+        vk::SubmitInfo submit_info{};
+        submit_info.sType = vk::StructureType::eSubmitInfo;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &recording.command_buffer;
+        if (use_transfer_queue) {
+            submit_info.waitSemaphoreCount = 1;
+            submit_info.pWaitSemaphores = &recording.transfer_semaphore;
+            submit_info.pWaitDstStageMask = &wait_stage;
+        }
+
+        auto result = device.getGraphicsQueue().submit(1, &submit_info, recording.fence);
+        if (result != vk::Result::eSuccess) {
+            spdlog::error("Failed to submit upload batch, exiting");
+            exit(exitcode::FAILURE);
+        }
+
+        UploadToken token = recording.token;
+        in_flight.push_back(std::move(recording));
+
+        recording = Batch{};
+        is_recording = false;
+        has_buffer_uploads = false;
+        has_graphics_copies = false;
+        pending_buffer_barriers.clear();
+        pending_image_barriers.clear();
+
+        return token;
+    }
+
+    bool UploadQueue::isComplete(UploadToken token) {
+        collect();
+        return token <= completed_token;
+    }
+
+    void UploadQueue::wait(UploadToken token) {
+        if (is_recording && token >= recording.token) {
+            submit();
+        }
+
+        for (auto &batch : in_flight) {
+            if (batch.token > token) {
+                break;
+            }
+
+            auto result = device.getDevice().waitForFences(1, &batch.fence, vk::True, std::numeric_limits<uint64_t>::max());
+            if (result != vk::Result::eSuccess) {
+                spdlog::warn("Failed to wait for upload fence");
+            }
+        }
+
+        collect();
+    }
+
+    void UploadQueue::createCommandPool() {
+        vk::CommandPoolCreateInfo pool_info = {};
+        pool_info.sType = vk::StructureType::eCommandPoolCreateInfo;
+        pool_info.queueFamilyIndex = graphics_family;
+        pool_info.flags = vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+
+        if (device.getDevice().createCommandPool(&pool_info, nullptr, &command_pool) != vk::Result::eSuccess) {
+            spdlog::error("Failed to create upload command pool, exiting");
+            exit(exitcode::FAILURE);
+        }
+    }
+
+    void UploadQueue::beginBatch() {
+        if (is_recording) {
+            return;
+        }
+
+        collect();
+
+        if (!free_batches.empty()) {
+            recording = std::move(free_batches.back());
+            free_batches.pop_back();
+        } else {
+            vk::CommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType = vk::StructureType::eCommandBufferAllocateInfo;
+            alloc_info.level = vk::CommandBufferLevel::ePrimary;
+            alloc_info.commandPool = command_pool;
+            alloc_info.commandBufferCount = 1;
+
+            if (device.getDevice().allocateCommandBuffers(&alloc_info, &recording.command_buffer) != vk::Result::eSuccess) {
+                spdlog::error("Failed to allocate upload command buffer, exiting");
+                exit(exitcode::FAILURE);
+            }
+
+            vk::FenceCreateInfo fence_info{};
+            fence_info.sType = vk::StructureType::eFenceCreateInfo;
+
+            if (device.getDevice().createFence(&fence_info, nullptr, &recording.fence) != vk::Result::eSuccess) {
+                spdlog::error("Failed to create upload fence, exiting");
+                exit(exitcode::FAILURE);
+            }
+
+            if (use_transfer_queue) {
+                alloc_info.commandPool = device.getTransferCommandPool();
+                if (device.getDevice().allocateCommandBuffers(&alloc_info, &recording.transfer_command_buffer) != vk::Result::eSuccess) {
+                    spdlog::error("Failed to allocate transfer command buffer, exiting");
+                    exit(exitcode::FAILURE);
+                }
+
+                vk::SemaphoreCreateInfo semaphore_info{};
+                semaphore_info.sType = vk::StructureType::eSemaphoreCreateInfo;
+
+                if (device.getDevice().createSemaphore(&semaphore_info, nullptr, &recording.transfer_semaphore) != vk::Result::eSuccess) {
+                    spdlog::error("Failed to create transfer semaphore, exiting");
+                    exit(exitcode::FAILURE);
+                }
+            }
+        }
+
+        recording.token = next_token++;
+
+        vk::CommandBufferBeginInfo begin_info{};
+        begin_info.sType = vk::StructureType::eCommandBufferBeginInfo;
+        begin_info.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+
+        if (recording.command_buffer.begin(&begin_info) != vk::Result::eSuccess) {
+            spdlog::error("Failed to begin upload command buffer, exiting");
+            exit(exitcode::FAILURE);
+        }
+
+        if (use_transfer_queue && recording.transfer_command_buffer.begin(&begin_info) != vk::Result::eSuccess) {
+            spdlog::error("Failed to begin transfer command buffer, exiting");
+            exit(exitcode::FAILURE);
+        }
+
+        is_recording = true;
+    }
+
+    void UploadQueue::destroyBatch(Batch &batch) {
+        device.getDevice().freeCommandBuffers(command_pool, 1, &batch.command_buffer);
+        device.getDevice().destroyFence(batch.fence, nullptr);
+
+        if (use_transfer_queue) {
+            device.getDevice().freeCommandBuffers(device.getTransferCommandPool(), 1, &batch.transfer_command_buffer);
+            device.getDevice().destroySemaphore(batch.transfer_semaphore, nullptr);
+        }
+    }
+
+    void UploadQueue::collect() {
+        while (!in_flight.empty()) {
+            auto &batch = in_flight.front();
+            if (device.getDevice().getFenceStatus(batch.fence) != vk::Result::eSuccess) {
+                break;
+            }
+
+            auto result = device.getDevice().resetFences(1, &batch.fence);
+            if (result != vk::Result::eSuccess) {
+                spdlog::warn("Failed to reset upload fence");
+            }
+
+            /* Oversized blocks are released rather than kept in the pool */
+            for (auto &block : batch.staging_blocks) {
+                if (block.buffer->getBufferSize() == STAGING_BLOCK_SIZE) {
+                    block.used = 0;
+                    free_blocks.push_back(std::move(block));
+                }
+            }
+            batch.staging_blocks.clear();
+
+            completed_token = batch.token;
+            free_batches.push_back(std::move(batch));
+            in_flight.pop_front();
+        }
+    }
+
+    vk::CommandBuffer UploadQueue::copyCommandBuffer() const {
+        return use_transfer_queue ? recording.transfer_command_buffer : recording.command_buffer;
+    }
+
+    UploadQueue::StagingAllocation UploadQueue::stage(const void *data, vk::DeviceSize size, vk::DeviceSize alignment) {
+        StagingBlock *block = nullptr;
+        vk::DeviceSize offset = 0;
+
+        if (!recording.staging_blocks.empty()) {
+            auto &current = recording.staging_blocks.back();
+            offset = (current.used + alignment - 1) / alignment * alignment;
+            if (offset + size <= current.buffer->getBufferSize()) {
+                block = &current;
+            }
+        }
+
+        if (block == nullptr) {
+            offset = 0;
+
+            if (size <= STAGING_BLOCK_SIZE && !free_blocks.empty()) {
+                recording.staging_blocks.push_back(std::move(free_blocks.back()));
+                free_blocks.pop_back();
+            } else {
+                StagingBlock new_block{};
+                new_block.buffer = std::make_unique<Buffer>(
+                    device,
+                    std::max(size, STAGING_BLOCK_SIZE),
+                    1,
+                    vk::BufferUsageFlagBits::eTransferSrc,
+                    vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent
+                );
+                recording.staging_blocks.push_back(std::move(new_block));
+            }
+
+            block = &recording.staging_blocks.back();
+        }
+
+        block->buffer->writeToBuffer(const_cast<void *>(data), size, offset);
+        block->used = offset + size;
+
+        return {block->buffer->getBuffer(), offset, static_cast<char *>(block->buffer->getMappedMemory()) + offset};
+    }
+
+}
@@ -7,6 +7,7 @@
 #include <spdlog/spdlog.h>
 
 #include "utils/exitcode.hpp"
+#include "utils/profiler.hpp"
 
 namespace muon {
 
@@ -21,6 +22,8 @@ namespace muon {
     }
 
     void Window::pollEvents() {
+        MUON_PROFILE_SCOPE("Window::pollEvents");
+
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             if (input_manager != nullptr) {
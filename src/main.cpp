@@ -1,12 +1,18 @@
 #include <cstdint>
+#include <cstdlib>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 
 #include <spdlog/spdlog.h>
 #include <toml++/toml.hpp>
 
 #include "engine/window/window.hpp"
+#include "engine/vulkan/renderer.hpp"
 #include "app.hpp"
+#include "utils/defaults.hpp"
+#include "utils/exitcode.hpp"
+#include "utils/profiler.hpp"
 
 void loadWindowProperties(muon::WindowProperties &window_properties) {
     auto config = toml::parse_file("config.toml");
@@ -24,13 +30,130 @@ void loadWindowProperties(muon::WindowProperties &window_properties) {
     }
 }
 
-int main() {
+void loadRendererProperties(muon::RendererProperties &renderer_properties) {
+    auto config = toml::parse_file("config.toml");
+
+    if (auto value = config["renderer"]["present_mode"].value<std::string_view>()) {
+        static const std::unordered_map<std::string_view, vk::PresentModeKHR> present_modes{
+            {"fifo", vk::PresentModeKHR::eFifo},
+            {"fifo_relaxed", vk::PresentModeKHR::eFifoRelaxed},
+            {"mailbox", vk::PresentModeKHR::eMailbox},
+            {"immediate", vk::PresentModeKHR::eImmediate},
+        };
+
+        if (auto it = present_modes.find(*value); it != present_modes.end()) {
+            renderer_properties.present_mode = it->second;
+        } else {
+            spdlog::warn("Unknown present mode: {}, using fifo", *value);
+        }
+    }
+
+    /* Range checked by the renderer */
+    if (auto value = config["renderer"]["frames_in_flight"].value<uint32_t>()) {
+        renderer_properties.frames_in_flight = *value;
+    }
+
+    if (auto value = config["renderer"]["max_fps"].value<uint32_t>()) {
+        renderer_properties.max_fps = *value;
+    }
+
+    if (auto value = config["renderer"]["parallel_record_threshold"].value<uint32_t>()) {
+        renderer_properties.parallel_record_threshold = *value;
+    }
+}
+
+/* --headless N renders N frames offscreen without a window or display server */
+uint32_t parseHeadlessFrames(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view{argv[i]} != "--headless") {
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            spdlog::error("--headless expects a frame count");
+            exit(muon::exitcode::FAILURE);
+        }
+
+        char *end = nullptr;
+        const auto frames = std::strtoul(argv[i + 1], &end, 10);
+        if (*end != '\0' || frames == 0 || frames > UINT32_MAX) {
+            spdlog::error("Invalid headless frame count: {}", argv[i + 1]);
+            exit(muon::exitcode::FAILURE);
+        }
+
+        return static_cast<uint32_t>(frames);
+    }
+
+    return 0;
+}
+
+/* --stress-draws N adds N transparent cubes, each its own draw, to compare inline and parallel recording */
+uint32_t parseStressDraws(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view{argv[i]} != "--stress-draws") {
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            spdlog::error("--stress-draws expects a draw count");
+            exit(muon::exitcode::FAILURE);
+        }
+
+        char *end = nullptr;
+        const auto draws = std::strtoul(argv[i + 1], &end, 10);
+        if (*end != '\0' || draws > UINT32_MAX) {
+            spdlog::error("Invalid stress draw count: {}", argv[i + 1]);
+            exit(muon::exitcode::FAILURE);
+        }
+
+        return static_cast<uint32_t>(draws);
+    }
+
+    return 0;
+}
+
+/* --trace FILE writes the last frames as a Chrome trace on exit, needs a MUON_PROFILE build */
+std::string parseTracePath(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (std::string_view{argv[i]} != "--trace") {
+            continue;
+        }
+
+        if (i + 1 >= argc) {
+            spdlog::error("--trace expects a file path");
+            exit(muon::exitcode::FAILURE);
+        }
+
+        return argv[i + 1];
+    }
+
+    return {};
+}
+
+int main(int argc, char *argv[]) {
     spdlog::set_level(spdlog::level::debug);
 
+    const uint32_t headless_frames = parseHeadlessFrames(argc, argv);
+    uint32_t stress_draws = parseStressDraws(argc, argv);
+    if (stress_draws > 0 && headless_frames == 0) {
+        spdlog::warn("--stress-draws ignored, only headless runs report recording times");
+        stress_draws = 0;
+    }
+    const std::string trace_path = parseTracePath(argc, argv);
+    if (!trace_path.empty() && !muon::profiler::ENABLED) {
+        spdlog::warn("--trace ignored, built without MUON_PROFILE");
+    }
 
     muon::WindowProperties window_properties{};
     loadWindowProperties(window_properties);
 
-    muon::App app{window_properties};
+    muon::RendererProperties renderer_properties{};
+    loadRendererProperties(renderer_properties);
+
+    muon::App app{window_properties, renderer_properties, headless_frames, stress_draws};
     app.run();
+
+    if (!trace_path.empty() && muon::profiler::ENABLED) {
+        muon::profiler::writeTrace(trace_path, muon::defaults::profiler::TRACE_FRAMES);
+    }
 }
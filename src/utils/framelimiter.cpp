@@ -0,0 +1,67 @@
+#include "utils/framelimiter.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace muon {
+
+    namespace {
+
+        /* Keeps the estimate responsive to changes in scheduler behaviour */
+        constexpr uint64_t MAX_SLEEP_SAMPLES = 256;
+
+    }
+
+    FrameLimiter::FrameLimiter(uint32_t max_fps) {
+        setMaxFps(max_fps);
+    }
+
+    void FrameLimiter::setMaxFps(uint32_t max_fps) {
+        frame_period = max_fps > 0 ? std::chrono::nanoseconds{1'000'000'000 / max_fps} : std::chrono::nanoseconds{0};
+        next_frame = {};
+    }
+
+    void FrameLimiter::wait() {
+        if (!isEnabled()) {
+            return;
+        }
+
+        const auto now = Clock::now();
+        if (now - next_frame > frame_period) {
+            next_frame = now;
+        } else {
+            sleepUntil(next_frame);
+        }
+
+        next_frame += frame_period;
+    }
+
+    void FrameLimiter::sleepUntil(Clock::time_point deadline) {
+        using namespace std::chrono_literals;
+
+        while (static_cast<double>((deadline - Clock::now()).count()) > sleepEstimate()) {
+            const auto start = Clock::now();
+            std::this_thread::sleep_for(1ms);
+            const auto observed = static_cast<double>(std::chrono::nanoseconds{Clock::now() - start}.count());
+
+            /* Welford's update, with the sample count capped so old samples decay */
+            sleep_samples = std::min(sleep_samples + 1, MAX_SLEEP_SAMPLES);
+            const double delta = observed - sleep_mean_ns;
+            sleep_mean_ns += delta / static_cast<double>(sleep_samples);
+            sleep_m2 += delta * (observed - sleep_mean_ns);
+            if (sleep_samples == MAX_SLEEP_SAMPLES) {
+                sleep_m2 *= static_cast<double>(MAX_SLEEP_SAMPLES - 1) / static_cast<double>(MAX_SLEEP_SAMPLES);
+            }
+        }
+
+        while (Clock::now() < deadline) {
+        }
+    }
+
+    double FrameLimiter::sleepEstimate() const {
+        const double variance = sleep_samples > 1 ? sleep_m2 / static_cast<double>(sleep_samples - 1) : 0.0;
+        return sleep_mean_ns + std::sqrt(variance);
+    }
+
+}
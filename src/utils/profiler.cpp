@@ -0,0 +1,151 @@
+#include "utils/profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include "json.hpp"
+
+namespace muon::profiler {
+
+    namespace {
+
+        /* Roughly a few hundred frames of a busy thread, 1.5 MiB each */
+        constexpr uint64_t EVENTS_PER_THREAD = 1 << 16;
+        constexpr uint64_t MAX_FRAMES = 1024;
+
+        struct Event {
+            const char *name;
+            uint64_t start_ns;
+            uint64_t end_ns;
+        };
+
+        /* Written only by its thread, outlives it so late dumps still see its zones */
+        struct ThreadBuffer {
+            uint32_t id{0};
+            std::string name{};
+            std::unique_ptr<Event[]> events{std::make_unique<Event[]>(EVENTS_PER_THREAD)};
+            std::atomic<uint64_t> count{0};
+        };
+
+        struct Registry {
+            std::mutex mutex{};
+            std::vector<std::unique_ptr<ThreadBuffer>> threads{};
+            std::array<uint64_t, MAX_FRAMES> frame_starts{};
+            std::atomic<uint64_t> frame_count{0};
+        };
+
+        Registry &registry() {
+            static Registry instance{};
+            return instance;
+        }
+
+        ThreadBuffer &threadBuffer() {
+            thread_local ThreadBuffer *buffer = []() {
+                auto &reg = registry();
+                std::lock_guard lock{reg.mutex};
+
+                auto &thread = reg.threads.emplace_back(std::make_unique<ThreadBuffer>());
+                thread->id = static_cast<uint32_t>(reg.threads.size() - 1);
+                thread->name = "thread " + std::to_string(thread->id);
+                return thread.get();
+            }();
+            return *buffer;
+        }
+
+        double toMicroseconds(uint64_t ns) {
+            return static_cast<double>(ns) / 1000.0;
+        }
+
+    }
+
+    void record(const char *name, uint64_t start_ns, uint64_t end_ns) {
+        auto &buffer = threadBuffer();
+        const uint64_t index = buffer.count.load(std::memory_order_relaxed);
+        buffer.events[index % EVENTS_PER_THREAD] = {name, start_ns, end_ns};
+        buffer.count.store(index + 1, std::memory_order_release);
+    }
+
+    void markFrame() {
+        auto &reg = registry();
+        const uint64_t index = reg.frame_count.load(std::memory_order_relaxed);
+        reg.frame_starts[index % MAX_FRAMES] = now();
+        reg.frame_count.store(index + 1, std::memory_order_release);
+    }
+
+    void setThreadName(const std::string &name) {
+        auto &buffer = threadBuffer();
+        std::lock_guard lock{registry().mutex};
+        buffer.name = name;
+    }
+
+    bool writeTrace(const std::string &path, uint32_t frame_count) {
+        auto &reg = registry();
+        std::lock_guard lock{reg.mutex};
+
+        /* Frame marks older than the ring are gone, so are the bounds of frames before them */
+        const uint64_t frames = reg.frame_count.load(std::memory_order_acquire);
+        const uint64_t exported = std::min<uint64_t>({frame_count, frames, MAX_FRAMES});
+        const uint64_t cutoff_ns = frames > exported ? reg.frame_starts[(frames - exported) % MAX_FRAMES] : 0;
+
+        std::vector<std::pair<uint32_t, Event>> events{};
+        uint64_t origin_ns = UINT64_MAX;
+        for (const auto &thread : reg.threads) {
+            const uint64_t count = thread->count.load(std::memory_order_acquire);
+            const uint64_t first = count > EVENTS_PER_THREAD ? count - EVENTS_PER_THREAD : 0;
+            for (uint64_t i = first; i < count; i++) {
+                const auto &event = thread->events[i % EVENTS_PER_THREAD];
+                if (event.start_ns < cutoff_ns) {
+                    continue;
+                }
+                events.emplace_back(thread->id, event);
+                origin_ns = std::min(origin_ns, event.start_ns);
+            }
+        }
+
+        for (uint64_t i = frames - exported; i < frames; i++) {
+            origin_ns = std::min(origin_ns, reg.frame_starts[i % MAX_FRAMES]);
+        }
+
+        nlohmann::json trace_events = nlohmann::json::array();
+        for (const auto &thread : reg.threads) {
+            trace_events.push_back({
+                {"name", "thread_name"}, {"ph", "M"}, {"pid", 0}, {"tid", thread->id},
+                {"args", {{"name", thread->name}}},
+            });
+        }
+
+        for (const auto &[thread_id, event] : events) {
+            trace_events.push_back({
+                {"name", event.name}, {"ph", "X"}, {"pid", 0}, {"tid", thread_id},
+                {"ts", toMicroseconds(event.start_ns - origin_ns)},
+                {"dur", toMicroseconds(event.end_ns - event.start_ns)},
+            });
+        }
+
+        for (uint64_t i = frames - exported; i < frames; i++) {
+            const uint64_t frame_start = reg.frame_starts[i % MAX_FRAMES];
+            trace_events.push_back({
+                {"name", "frame " + std::to_string(i)}, {"ph", "i"}, {"s", "g"}, {"pid", 0}, {"tid", 0},
+                {"ts", toMicroseconds(frame_start - origin_ns)},
+            });
+        }
+
+        std::ofstream file{path};
+        if (!file) {
+            spdlog::warn("Failed to open trace file: {}", path);
+            return false;
+        }
+
+        file << nlohmann::json{{"traceEvents", trace_events}, {"displayTimeUnit", "ms"}}.dump();
+        spdlog::info("Wrote {} zones from the last {} frames to {}", events.size(), exported, path);
+        return true;
+    }
+
+}
@@ -0,0 +1,56 @@
+#include "utils/threadpool.hpp"
+
+#include <algorithm>
+
+#include "utils/profiler.hpp"
+
+namespace muon {
+
+    ThreadPool::ThreadPool(uint32_t thread_count) {
+        workers.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; i++) {
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock{mutex};
+            stopping = true;
+        }
+        condition.notify_all();
+
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    uint32_t ThreadPool::defaultThreadCount() {
+        const uint32_t hardware_threads = std::thread::hardware_concurrency();
+        return std::max(hardware_threads, 2u) - 1;
+    }
+
+    void ThreadPool::workerLoop() {
+        MUON_PROFILE_THREAD("worker");
+
+        while (true) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock lock{mutex};
+                condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+                /* Drain the queue before exiting so no future is left unsatisfied */
+                if (tasks.empty()) {
+                    return;
+                }
+
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            task();
+        }
+    }
+
+}